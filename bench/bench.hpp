@@ -0,0 +1,184 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <format>
+#include <functional>
+#include <numeric>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace chip8::bench {
+
+/// keeps the compiler from deleting a computation whose result is unused
+template <typename T>
+inline void do_not_optimize(const T &value) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+  asm volatile("" : : "r,m"(value) : "memory");
+#else
+  static volatile const T *sink;
+  sink = &value;
+#endif
+}
+
+/// runs the body n times, the only signature a benchmark needs
+using Body = std::function<void(std::uint64_t n)>;
+
+struct Stats {
+  std::string name;
+  std::uint64_t iterations{0}; // per sample
+  std::size_t samples{0};
+  double mean_ns{0.0}; // all per operation
+  double median_ns{0.0};
+  double stddev_ns{0.0};
+  double ci95_ns{0.0}; // half width of the 95% interval around the mean
+  double min_ns{0.0};
+};
+
+struct Settings {
+  std::size_t samples{30};
+  std::chrono::nanoseconds sample_time{std::chrono::milliseconds{5}};
+  std::string filter; // substring, empty runs everything
+};
+
+/// two sided 95% student t for small sample counts, normal beyond
+[[nodiscard]] inline double t_critical(std::size_t degrees) noexcept {
+  static constexpr std::array<double, 30> TABLE{
+      12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+      2.201,  2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+      2.080,  2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042};
+  if (degrees == 0)
+    return 0.0;
+  return degrees <= TABLE.size() ? TABLE[degrees - 1] : 1.960;
+}
+
+[[nodiscard]] inline Stats summarize(std::string name,
+                                     std::uint64_t iterations,
+                                     std::vector<double> per_op) {
+  Stats stats{.name = std::move(name),
+              .iterations = iterations,
+              .samples = per_op.size()};
+  if (per_op.empty())
+    return stats;
+
+  std::ranges::sort(per_op);
+  const auto n{static_cast<double>(per_op.size())};
+  stats.min_ns = per_op.front();
+  stats.median_ns = per_op.size() % 2
+                        ? per_op[per_op.size() / 2]
+                        : (per_op[per_op.size() / 2 - 1] +
+                           per_op[per_op.size() / 2]) / 2.0;
+  stats.mean_ns = std::accumulate(per_op.begin(), per_op.end(), 0.0) / n;
+  if (per_op.size() > 1) {
+    double sum{0.0};
+    for (const double x : per_op)
+      sum += (x - stats.mean_ns) * (x - stats.mean_ns);
+    stats.stddev_ns = std::sqrt(sum / (n - 1.0));
+    stats.ci95_ns = t_critical(per_op.size() - 1) * stats.stddev_ns /
+                    std::sqrt(n);
+  }
+  return stats;
+}
+
+/// collects named benchmarks and times them. the iteration count per sample
+/// is calibrated so one sample takes about Settings::sample_time, then one
+/// warmup sample is thrown away and Settings::samples are kept
+class Registry {
+public:
+  void add(std::string name, Body body) {
+    m_Benchmarks.push_back({std::move(name), std::move(body)});
+  }
+
+  [[nodiscard]] std::vector<Stats> run(
+      const Settings &settings,
+      const std::function<void(const Stats &)> &on_result = {}) const {
+    std::vector<Stats> results;
+    for (const auto &[name, body] : m_Benchmarks) {
+      if (!settings.filter.empty() &&
+          name.find(settings.filter) == std::string::npos)
+        continue;
+
+      const auto iterations{calibrate(body, settings.sample_time)};
+      (void)time(body, iterations);
+
+      std::vector<double> per_op;
+      per_op.reserve(settings.samples);
+      for (std::size_t s{0}; s < settings.samples; ++s)
+        per_op.push_back(static_cast<double>(time(body, iterations).count()) /
+                         static_cast<double>(iterations));
+
+      results.push_back(summarize(name, iterations, std::move(per_op)));
+      if (on_result)
+        on_result(results.back());
+    }
+    return results;
+  }
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  static std::chrono::nanoseconds time(const Body &body, std::uint64_t n) {
+    const auto start{Clock::now()};
+    body(n);
+    return Clock::now() - start;
+  }
+
+  static std::uint64_t calibrate(const Body &body,
+                                 std::chrono::nanoseconds target) {
+    std::uint64_t n{1};
+    for (;;) {
+      const auto elapsed{time(body, n)};
+      if (elapsed >= target / 10 || n >= (1ull << 40)) {
+        const double scale{static_cast<double>(target.count()) /
+                           std::max<double>(1.0, static_cast<double>(
+                                                     elapsed.count()))};
+        return std::max<std::uint64_t>(
+            1, static_cast<std::uint64_t>(static_cast<double>(n) * scale));
+      }
+      n *= 10;
+    }
+  }
+
+  struct Entry {
+    std::string name;
+    Body body;
+  };
+  std::vector<Entry> m_Benchmarks;
+};
+
+[[nodiscard]] inline std::string json_escape(std::string_view text) {
+  std::string out;
+  for (const char c : text) {
+    if (c == '"' || c == '\\')
+      out += '\\';
+    if (static_cast<unsigned char>(c) < 0x20)
+      out += std::format("\\u{:04x}", static_cast<int>(c));
+    else
+      out += c;
+  }
+  return out;
+}
+
+/// stable, diffable output for tracking results from commit to commit
+[[nodiscard]] inline std::string to_json(const std::vector<Stats> &results,
+                                         std::string_view context) {
+  std::string out{"{\n  \"context\": "};
+  out += context;
+  out += ",\n  \"benchmarks\": [";
+  for (std::size_t i{0}; i < results.size(); ++i) {
+    const auto &r{results[i]};
+    out += std::format(
+        "{}\n    {{\"name\": \"{}\", \"ns_per_op\": {:.3f}, "
+        "\"median_ns\": {:.3f}, \"stddev_ns\": {:.3f}, \"ci95_ns\": {:.3f}, "
+        "\"min_ns\": {:.3f}, \"samples\": {}, \"iterations\": {}}}",
+        i ? "," : "", json_escape(r.name), r.mean_ns, r.median_ns,
+        r.stddev_ns, r.ci95_ns, r.min_ns, r.samples, r.iterations);
+  }
+  out += "\n  ]\n}\n";
+  return out;
+}
+
+}
@@ -0,0 +1,628 @@
+#include "bench.hpp"
+
+#include "core/batch_env.hpp"
+#include "core/emulator.hpp"
+#include "core/instruction.hpp"
+#include "core/machine.hpp"
+#include "input/input_script.hpp"
+#include "input/keyboard.hpp"
+#include "utils/quirk_db.hpp"
+#include "mocks/mock_key_provider.hpp"
+
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <functional>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// micro benchmarks for the interpreter hot paths, or with --roms whole roms
+// run headless and uncapped
+// usage: chip8_bench [--filter <text>] [--samples <N>] [--json <file>]
+//        chip8_bench --roms <dir> [--frames <N>] [--frequency <hz>]
+//                    [--filter <text>] [--json <file>]
+//   a rom's input is read from <name>.input next to it when there is one
+//   (see InputScript::parse), otherwise every key is tapped in turn
+//        chip8_bench --latency [--events <N>] [--run-ahead <N>] [--json <file>]
+//   opens a window and presses keys into a rom that redraws on every key,
+//   timing each press from the key provider to the end of the frame
+//        chip8_bench --batch <rom> [--envs <N>] [--steps <N>] [--json <file>]
+//   steps a BatchEnv on this thread and reports environment steps per
+//   second, the rl throughput of one core
+
+namespace {
+
+using namespace chip8;
+using bench::do_not_optimize;
+
+// the program fills memory up to here, BCD and store write above it
+constexpr Word PROGRAM_END{0xF00};
+constexpr Word SCRATCH{0xF00};
+
+std::vector<Opcode> random_opcodes(std::size_t count) {
+  std::vector<Opcode> opcodes;
+  opcodes.reserve(count);
+  std::uint32_t x{0x2545F491};
+  for (std::size_t i{0}; i < count; ++i) {
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    opcodes.emplace_back(static_cast<std::uint16_t>(x >> 16));
+  }
+  return opcodes;
+}
+
+/// one opcode over the whole program area. the pc wraps back to the start
+/// before it reaches the scratch bytes
+bench::Body cpu_step(std::vector<Word> pattern, CpuConfig config = {}) {
+  auto machine{std::make_shared<Machine>(config)};
+  std::vector<Byte> rom;
+  for (std::size_t i{0}; rom.size() < PROGRAM_END - constants::PROGRAM_START;
+       ++i) {
+    const Word op{pattern[i % pattern.size()]};
+    rom.push_back(static_cast<Byte>(op >> 8));
+    rom.push_back(static_cast<Byte>(op));
+  }
+  (void)machine->load_rom(rom);
+  machine->seed(1);
+
+  return [machine](std::uint64_t n) {
+    auto &cpu{machine->cpu()};
+    cpu.set_index(Address{SCRATCH});
+    for (std::uint64_t i{0}; i < n; ++i) {
+      if (cpu.state().program_counter.get() >= PROGRAM_END) {
+        cpu.set_pc(Address{constants::PROGRAM_START});
+        cpu.set_index(Address{SCRATCH});
+      }
+      do_not_optimize(cpu.step());
+    }
+  };
+}
+
+bench::Body draw_sprite(Byte x, Byte y) {
+  auto display{std::make_shared<Display>()};
+  static constexpr std::array<Byte, 15> SPRITE{
+      0xFF, 0x81, 0xBD, 0xA5, 0xA5, 0xBD, 0x81, 0xFF,
+      0x3C, 0x42, 0x99, 0xA5, 0x99, 0x42, 0x3C};
+  return [display, x, y](std::uint64_t n) {
+    for (std::uint64_t i{0}; i < n; ++i)
+      do_not_optimize(display->draw_sprite(x, y, SPRITE));
+  };
+}
+
+/// cycles through every key one press at a time, like a player would
+class SweepKeyProvider : public IKeyStateProvider {
+public:
+  void advance() noexcept { ++m_Frame; }
+
+  bool is_key_down(Key key) const override {
+    return DEFAULT_KEY_MAP[(m_Frame / 4) % DEFAULT_KEY_MAP.size()]
+               .platform_key == key;
+  }
+  bool is_key_pressed(Key key) const override { return is_key_down(key); }
+  void wait_time(double) const override {}
+  bool should_quit() const override { return false; }
+
+private:
+  std::uint64_t m_Frame{0};
+};
+
+bench::Registry micro_benchmarks() {
+  bench::Registry registry;
+
+  registry.add("decode/random", [opcodes{random_opcodes(4096)}](
+                                    std::uint64_t n) {
+    for (std::uint64_t i{0}; i < n; ++i)
+      do_not_optimize(decode(opcodes[i & 4095]));
+  });
+
+  registry.add("memory/read_opcode", [memory{std::make_shared<Memory>()}](
+                                         std::uint64_t n) {
+    for (std::uint64_t i{0}; i < n; ++i)
+      do_not_optimize(memory->read_opcode(Address{static_cast<Word>(
+          constants::PROGRAM_START + ((i << 1) & 0xDFE))}));
+  });
+
+  registry.add("cpu/load_6XNN", cpu_step({0x6A42}));
+  registry.add("cpu/add_7XNN", cpu_step({0x7A01}));
+  registry.add("cpu/alu_8XY4", cpu_step({0x8AB4}));
+  registry.add("cpu/shift_8XY6", cpu_step({0x8AB6}));
+  registry.add("cpu/skip_3XNN", cpu_step({0x3AFF}));
+  registry.add("cpu/index_ANNN", cpu_step({0xAF00}));
+  registry.add("cpu/jump_1NNN", cpu_step({0x1200}));
+  // call the return at 0x206, then jump back to the call
+  registry.add("cpu/call_ret", cpu_step({0x2206, 0x1200, 0x0000, 0x00EE}));
+  registry.add("cpu/rand_CXNN", cpu_step({0xCAFF}));
+  registry.add("cpu/draw_DXYN", cpu_step({0xD125}));
+  registry.add("cpu/bcd_FX33", cpu_step({0xF033}));
+  registry.add("cpu/store_FX55", cpu_step({0xF755},
+                                          {.load_store_quirk = true}));
+  registry.add("cpu/load_FX65", cpu_step({0xF765},
+                                         {.load_store_quirk = true}));
+  registry.add("cpu/timer_FX15", cpu_step({0xF015}));
+
+  registry.add("display/draw_sprite_aligned", draw_sprite(8, 0));
+  registry.add("display/draw_sprite_unaligned", draw_sprite(13, 5));
+  registry.add("display/draw_sprite_wrapping", draw_sprite(60, 25));
+
+  registry.add("timers/update", [timers{std::make_shared<Timers>()}](
+                                    std::uint64_t n) {
+    for (std::uint64_t i{0}; i < n; ++i) {
+      timers->set_delay(0xFF);
+      do_not_optimize(timers->update());
+    }
+  });
+
+  {
+    auto provider{std::make_shared<SweepKeyProvider>()};
+    auto keyboard{std::make_shared<Keyboard>(provider)};
+    registry.add("keyboard/update", [provider, keyboard](std::uint64_t n) {
+      for (std::uint64_t i{0}; i < n; ++i) {
+        provider->advance();
+        keyboard->update();
+        do_not_optimize(keyboard->get_key_state());
+      }
+    });
+  }
+
+  return registry;
+}
+
+struct MacroSettings {
+  std::filesystem::path roms;
+  std::uint64_t frames{36'000}; // 10 emulated minutes
+  double frequency_hz{700.0};
+};
+
+struct MacroResult {
+  std::string name;
+  std::uint64_t frames{0};
+  std::uint64_t instructions{0};
+  double seconds{0.0};
+  FrameTiming timing;
+  bool faulted{false};
+
+  [[nodiscard]] double ips() const noexcept { return instructions / seconds; }
+  [[nodiscard]] double fps() const noexcept { return frames / seconds; }
+  [[nodiscard]] double share(FrameTiming::Clock::duration part) const {
+    const auto total{timing.total().count()};
+    return total > 0 ? 100.0 * static_cast<double>(part.count()) /
+                           static_cast<double>(total)
+                     : 0.0;
+  }
+};
+
+Result<MacroResult> run_rom(const std::filesystem::path &path,
+                            std::string name, const MacroSettings &settings) {
+  using R = Result<MacroResult>;
+  auto file{MappedFile::open(path)};
+  if (!file)
+    return R{file.error()};
+
+  CpuConfig config{.frequency_hz = settings.frequency_hz};
+  bool clip{false};
+  if (const auto *known{find_quirks(rom_hash(file->bytes()))}) {
+    config.shift_quirk = known->profile.shift_quirk;
+    config.load_store_quirk = known->profile.load_store_quirk;
+    config.jump_quirk = known->profile.jump_quirk;
+    clip = known->profile.clip_sprites;
+  }
+
+  auto input{InputScript::key_sweep(settings.frames)};
+  if (auto recorded{path};
+      std::filesystem::exists(recorded.replace_extension(".input"))) {
+    auto loaded{InputScript::load(recorded)};
+    if (!loaded)
+      return R{loaded.error()};
+    input = std::move(loaded.value());
+  }
+
+  Machine machine{config, clip};
+  if (auto result{machine.load_rom(file->bytes())}; !result)
+    return R{result.error()};
+  machine.seed(0xC8C8C8C8);
+
+  MacroResult result{.name = std::move(name)};
+  machine.set_frame_timing(&result.timing);
+  const auto start{std::chrono::steady_clock::now()};
+  for (std::uint64_t frame{0}; frame < settings.frames; ++frame) {
+    machine.set_keys(input.keys_at(frame));
+    if (!machine.run_frame()) {
+      result.faulted = true;
+      break;
+    }
+  }
+  result.seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+  result.frames = machine.frame_count();
+  result.instructions = machine.cycle_count();
+  return R{std::move(result)};
+}
+
+std::vector<MacroResult> run_macro(const MacroSettings &settings,
+                                   const std::string &filter) {
+  std::vector<std::pair<std::filesystem::path, std::string>> roms;
+  std::error_code ec;
+  for (const auto &entry :
+       std::filesystem::recursive_directory_iterator(settings.roms, ec)) {
+    auto name{entry.path().lexically_relative(settings.roms).generic_string()};
+    if (entry.is_regular_file() && entry.path().extension() == ".ch8" &&
+        (filter.empty() || name.find(filter) != std::string::npos))
+      roms.emplace_back(entry.path(), std::move(name));
+  }
+  std::ranges::sort(roms, {}, &std::pair<std::filesystem::path,
+                                         std::string>::second);
+
+  std::cout << std::format("{:<48}{:>10}{:>10}{:>8}{:>9}{:>8}\n", "rom",
+                           "MIPS", "kFPS", "cpu %", "display", "timers");
+  std::vector<MacroResult> results;
+  for (const auto &[path, name] : roms) {
+    auto result{run_rom(path, name, settings)};
+    if (!result) {
+      std::cerr << std::format("{}: {}\n", name, result.error().message());
+      continue;
+    }
+    const auto &r{results.emplace_back(std::move(result.value()))};
+    std::cout << std::format(
+        "{:<48}{:>10.2f}{:>10.1f}{:>8.1f}{:>9.1f}{:>8.1f}{}\n",
+        r.name.substr(0, 47), r.ips() / 1e6, r.fps() / 1e3,
+        r.share(r.timing.cpu), r.share(r.timing.display),
+        r.share(r.timing.timers),
+        r.faulted ? std::format("  (fault at frame {})", r.frames) : "");
+  }
+  return results;
+}
+
+/// geometric mean, so no single fast or slow rom dominates
+template <typename Projection>
+double geometric_mean(const std::vector<MacroResult> &results,
+                      Projection projection) {
+  double log_sum{0.0};
+  std::size_t count{0};
+  for (const auto &r : results) {
+    const double value{std::invoke(projection, r)};
+    if (value > 0.0) {
+      log_sum += std::log(value);
+      ++count;
+    }
+  }
+  return count ? std::exp(log_sum / static_cast<double>(count)) : 0.0;
+}
+
+std::string macro_json(const std::vector<MacroResult> &results,
+                       const MacroSettings &settings, double ips, double fps,
+                       std::string_view context) {
+  std::string out{std::format(
+      "{{\n  \"context\": {},\n  \"frames\": {}, \"frequency_hz\": {},\n"
+      "  \"geomean\": {{\"ips\": {:.0f}, \"fps\": {:.1f}}},\n  \"roms\": [",
+      context, settings.frames, settings.frequency_hz, ips, fps)};
+  for (std::size_t i{0}; i < results.size(); ++i) {
+    const auto &r{results[i]};
+    out += std::format(
+        "{}\n    {{\"name\": \"{}\", \"ips\": {:.0f}, \"fps\": {:.1f}, "
+        "\"frames\": {}, \"instructions\": {}, \"cpu_pct\": {:.2f}, "
+        "\"display_pct\": {:.2f}, \"timers_pct\": {:.2f}, \"faulted\": {}}}",
+        i ? "," : "", bench::json_escape(r.name), r.ips(), r.fps(), r.frames,
+        r.instructions, r.share(r.timing.cpu), r.share(r.timing.display),
+        r.share(r.timing.timers), r.faulted);
+  }
+  out += "\n  ]\n}\n";
+  return out;
+}
+
+struct LatencySettings {
+  std::size_t events{200};
+  int run_ahead{0};
+};
+
+/// waits for a key, draws its font glyph, repeat. every press changes the
+/// screen as long as consecutive keys differ
+constexpr std::array<Byte, 10> ECHO_ROM{
+    0xF0, 0x0A, // LD V0, K
+    0x00, 0xE0, // CLS
+    0xF0, 0x29, // LD F, V0
+    0xD0, 0x05, // DRW V0, V0, 5
+    0x12, 0x00 // JP 200
+};
+
+Result<LatencyProbe> run_latency(const LatencySettings &settings) {
+  using R = Result<LatencyProbe>;
+  Config config;
+  config.audio_enabled = false;
+  config.use_quirk_db = false;
+  config.run_ahead = settings.run_ahead;
+
+  auto keys{std::make_shared<test::MockKeyProvider>()};
+  Emulator emulator{config,
+                    std::make_unique<RaylibRenderer>(config.display_scale),
+                    keys};
+  if (auto result{emulator.initialize()}; !result)
+    return R{result.error()};
+  if (auto result{emulator.load_rom(ECHO_ROM, "latency echo")}; !result)
+    return R{result.error()};
+  emulator.run();
+
+  LatencyProbe probe{settings.events};
+  emulator.set_latency_probe(&probe);
+  constexpr int MAX_FRAMES_PER_EVENT{30};
+
+  for (std::size_t i{0}; i < settings.events && !emulator.should_quit();
+       ++i) {
+    // presses land anywhere in a frame, not just right after vsync
+    std::this_thread::sleep_for(std::chrono::microseconds{(i * 3'697) %
+                                                          16'667});
+    const auto key{DEFAULT_KEY_MAP[i % DEFAULT_KEY_MAP.size()].platform_key};
+    keys->set_key_down(key, true);
+    probe.begin();
+    for (int f{0}; f < MAX_FRAMES_PER_EVENT && probe.pending(); ++f)
+      if (auto result{emulator.update()}; !result)
+        return R{result.error()};
+    if (probe.pending())
+      probe.abandon();
+
+    keys->set_key_down(key, false);
+    for (int f{0}; f < 2; ++f)
+      (void)emulator.update();
+  }
+  emulator.set_latency_probe(nullptr);
+  return R{std::move(probe)};
+}
+
+std::string latency_json(const LatencyProbe &probe,
+                         const LatencySettings &settings,
+                         std::string_view context) {
+  std::string out{std::format(
+      "{{\n  \"context\": {},\n  \"run_ahead\": {}, \"events\": {}, "
+      "\"dropped\": {},\n  \"stages\": [",
+      context, settings.run_ahead, probe.samples(), probe.dropped())};
+  for (std::size_t s{0}; s < LATENCY_STAGE_COUNT; ++s) {
+    const auto stage{static_cast<LatencyStage>(s)};
+    out += std::format(
+        "{}\n    {{\"name\": \"{}\", \"p50_ms\": {:.3f}, \"p90_ms\": {:.3f}, "
+        "\"p99_ms\": {:.3f}, \"max_ms\": {:.3f}}}",
+        s ? "," : "", LATENCY_STAGE_NAMES[s],
+        probe.percentile(stage, 50).count(),
+        probe.percentile(stage, 90).count(),
+        probe.percentile(stage, 99).count(),
+        probe.percentile(stage, 100).count());
+  }
+  out += "\n  ]\n}\n";
+  return out;
+}
+
+struct BatchSettings {
+  std::filesystem::path rom;
+  std::size_t envs{16};
+  std::uint64_t steps{1'000'000}; // over all environments
+};
+
+struct BatchResult {
+  std::uint64_t steps{0};
+  std::uint64_t frames{0}; // emulated, frame skip included
+  double seconds{0.0};
+  bool known_reward{false};
+
+  [[nodiscard]] double steps_per_second() const noexcept {
+    return steps / seconds;
+  }
+  [[nodiscard]] double fps() const noexcept { return frames / seconds; }
+};
+
+Result<BatchResult> run_batch(const BatchSettings &settings) {
+  using R = Result<BatchResult>;
+  auto file{MappedFile::open(settings.rom)};
+  if (!file)
+    return R{file.error()};
+
+  const auto hash{rom_hash(file->bytes())};
+  BatchEnvConfig config{.envs = settings.envs};
+  if (const auto *known{find_quirks(hash)}) {
+    config.cpu.shift_quirk = known->profile.shift_quirk;
+    config.cpu.load_store_quirk = known->profile.load_store_quirk;
+    config.cpu.jump_quirk = known->profile.jump_quirk;
+    config.clip_sprites = known->profile.clip_sprites;
+  }
+  const auto *reward{find_reward(hash)};
+
+  auto env{BatchEnv::create(file->bytes(), config,
+                            reward ? reward->spec : RewardSpec{})};
+  if (!env)
+    return R{env.error()};
+  auto &batch{*env.value()};
+
+  const auto n{batch.size()};
+  std::vector<Byte> observations(n * BatchEnv::OBSERVATION_BYTES);
+  std::vector<KeyMask> actions(n);
+  std::vector<float> rewards(n);
+  std::vector<std::uint8_t> dones(n);
+  if (auto result{batch.reset(observations)}; !result)
+    return R{result.error()};
+
+  const auto start{std::chrono::steady_clock::now()};
+  for (std::uint64_t step{0}; batch.steps() < settings.steps; ++step) {
+    // every environment holds a different key, a new one every 8 steps
+    for (std::size_t i{0}; i < n; ++i)
+      actions[i] = static_cast<KeyMask>(1u << ((step / 8 + i) % 16));
+    if (auto result{batch.step(actions, observations, rewards, dones)};
+        !result)
+      return R{result.error()};
+  }
+  const auto seconds{std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start)
+                         .count()};
+
+  return R{BatchResult{.steps = batch.steps(),
+                       .frames = batch.steps() * config.frame_skip,
+                       .seconds = seconds,
+                       .known_reward = reward != nullptr}};
+}
+
+std::string batch_json(const BatchResult &result,
+                       const BatchSettings &settings,
+                       std::string_view context) {
+  return std::format(
+      "{{\n  \"context\": {},\n  \"rom\": \"{}\", \"envs\": {}, "
+      "\"known_reward\": {},\n  \"steps\": {}, \"seconds\": {:.3f}, "
+      "\"steps_per_second\": {:.0f}, \"fps\": {:.0f}\n}}\n",
+      context, bench::json_escape(settings.rom.generic_string()),
+      settings.envs, result.known_reward, result.steps, result.seconds,
+      result.steps_per_second(), result.fps());
+}
+
+std::string build_context() {
+#ifdef NDEBUG
+  constexpr std::string_view BUILD{"release"};
+#else
+  constexpr std::string_view BUILD{"debug"};
+#endif
+#if defined(__clang__)
+  const auto compiler{std::format("clang {}.{}.{}", __clang_major__,
+                                  __clang_minor__, __clang_patchlevel__)};
+#elif defined(__GNUC__)
+  const auto compiler{std::format("gcc {}.{}.{}", __GNUC__, __GNUC_MINOR__,
+                                  __GNUC_PATCHLEVEL__)};
+#elif defined(_MSC_VER)
+  const auto compiler{std::format("msvc {}", _MSC_VER)};
+#else
+  const std::string compiler{"unknown"};
+#endif
+  const auto now{std::chrono::floor<std::chrono::seconds>(
+      std::chrono::system_clock::now())};
+  const auto day{std::chrono::floor<std::chrono::days>(now)};
+  const std::chrono::year_month_day date{day};
+  const std::chrono::hh_mm_ss time{now - day};
+  return std::format("{{\"date\": \"{:04}-{:02}-{:02}T{:02}:{:02}:{:02}Z\", "
+                     "\"compiler\": \"{}\", \"build\": \"{}\"}}",
+                     static_cast<int>(date.year()),
+                     static_cast<unsigned>(date.month()),
+                     static_cast<unsigned>(date.day()), time.hours().count(),
+                     time.minutes().count(), time.seconds().count(), compiler,
+                     BUILD);
+}
+
+}
+
+int main(int argc, char *argv[]) {
+  bench::Settings settings;
+  MacroSettings macro;
+  LatencySettings latency;
+  BatchSettings batch;
+  bool latency_mode{false};
+  std::string json_path;
+
+  for (int i{1}; i < argc; ++i) {
+    const std::string_view arg{argv[i]};
+    if (i + 1 < argc && arg == "--filter") {
+      settings.filter = argv[++i];
+    } else if (i + 1 < argc && arg == "--samples") {
+      settings.samples = std::max<std::size_t>(
+          2, std::strtoull(argv[++i], nullptr, 10));
+    } else if (i + 1 < argc && arg == "--json") {
+      json_path = argv[++i];
+    } else if (arg == "--latency") {
+      latency_mode = true;
+    } else if (i + 1 < argc && arg == "--events") {
+      latency.events = std::max<std::size_t>(
+          1, std::strtoull(argv[++i], nullptr, 10));
+    } else if (i + 1 < argc && arg == "--run-ahead") {
+      latency.run_ahead = std::atoi(argv[++i]);
+    } else if (i + 1 < argc && arg == "--batch") {
+      batch.rom = argv[++i];
+    } else if (i + 1 < argc && arg == "--envs") {
+      batch.envs = std::max<std::size_t>(
+          1, std::strtoull(argv[++i], nullptr, 10));
+    } else if (i + 1 < argc && arg == "--steps") {
+      batch.steps = std::max<std::uint64_t>(
+          1, std::strtoull(argv[++i], nullptr, 10));
+    } else if (i + 1 < argc && arg == "--roms") {
+      macro.roms = argv[++i];
+    } else if (i + 1 < argc && arg == "--frames") {
+      macro.frames = std::max<std::uint64_t>(
+          1, std::strtoull(argv[++i], nullptr, 10));
+    } else if (i + 1 < argc && arg == "--frequency") {
+      macro.frequency_hz = std::max(60.0, std::strtod(argv[++i], nullptr));
+    } else {
+      std::cerr << "usage: chip8_bench [--filter <text>] [--samples <N>] "
+                   "[--json <file>]\n"
+                   "       chip8_bench --roms <dir> [--frames <N>] "
+                   "[--frequency <hz>] [--filter <text>] [--json <file>]\n"
+                   "       chip8_bench --latency [--events <N>] "
+                   "[--run-ahead <N>] [--json <file>]\n"
+                   "       chip8_bench --batch <rom> [--envs <N>] "
+                   "[--steps <N>] [--json <file>]\n";
+      return EXIT_FAILURE;
+    }
+  }
+
+  std::string json;
+  if (latency_mode) {
+    const auto probe{run_latency(latency)};
+    if (!probe) {
+      std::cerr << probe.error().message() << '\n';
+      return EXIT_FAILURE;
+    }
+    std::cout << std::format("{} presses, {} dropped, run-ahead {}\n",
+                             probe->samples(), probe->dropped(),
+                             latency.run_ahead);
+    std::cout << std::format("{:<14}{:>10}{:>10}{:>10}{:>10}\n",
+                             "input to (ms)", "p50", "p90", "p99", "max");
+    for (std::size_t s{0}; s < LATENCY_STAGE_COUNT; ++s) {
+      const auto stage{static_cast<LatencyStage>(s)};
+      std::cout << std::format("{:<14}{:>10.3f}{:>10.3f}{:>10.3f}{:>10.3f}\n",
+                               LATENCY_STAGE_NAMES[s],
+                               probe->percentile(stage, 50).count(),
+                               probe->percentile(stage, 90).count(),
+                               probe->percentile(stage, 99).count(),
+                               probe->percentile(stage, 100).count());
+    }
+    json = latency_json(*probe, latency, build_context());
+  } else if (!batch.rom.empty()) {
+    const auto result{run_batch(batch)};
+    if (!result) {
+      std::cerr << result.error().message() << '\n';
+      return EXIT_FAILURE;
+    }
+    std::cout << std::format(
+        "{} envs, {} steps in {:.3f} s{}\n{:.0f} steps/s per core, "
+        "{:.0f} emulated frames/s\n",
+        batch.envs, result->steps, result->seconds,
+        result->known_reward ? "" : " (no known reward spec)",
+        result->steps_per_second(), result->fps());
+    json = batch_json(*result, batch, build_context());
+  } else if (!macro.roms.empty()) {
+    const auto results{run_macro(macro, settings.filter)};
+    if (results.empty()) {
+      std::cerr << "no roms found under " << macro.roms.string() << '\n';
+      return EXIT_FAILURE;
+    }
+    const auto ips{geometric_mean(results, &MacroResult::ips)};
+    const auto fps{geometric_mean(results, &MacroResult::fps)};
+    std::cout << std::format("{:<48}{:>10.2f}{:>10.1f}\n", "geometric mean",
+                             ips / 1e6, fps / 1e3);
+    json = macro_json(results, macro, ips, fps, build_context());
+  } else {
+    std::cout << std::format("{:<34}{:>12}{:>12}{:>12}\n", "benchmark",
+                             "ns/op", "+/- 95%", "median");
+    const auto results{micro_benchmarks().run(
+        settings, [](const bench::Stats &s) {
+          std::cout << std::format("{:<34}{:>12.2f}{:>12.2f}{:>12.2f}\n",
+                                   s.name, s.mean_ns, s.ci95_ns,
+                                   s.median_ns);
+        })};
+    json = bench::to_json(results, build_context());
+  }
+
+  if (!json_path.empty()) {
+    std::ofstream file(json_path, std::ios::trunc);
+    file << json;
+    if (!file) {
+      std::cerr << "Failed to write " << json_path << '\n';
+      return EXIT_FAILURE;
+    }
+  }
+  return EXIT_SUCCESS;
+}
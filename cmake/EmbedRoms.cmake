@@ -0,0 +1,47 @@
+# chip8_embed_roms(<output> <rom>...)
+#
+# writes a header fragment with one constexpr byte array per rom and an
+# EMBEDDED_ROMS table naming them. roms are given relative to roms/, the
+# fragment is only rewritten when its contents change and cmake re-runs
+# when any of the roms does
+function(chip8_embed_roms output)
+    if (NOT ARGN)
+        message(FATAL_ERROR "CHIP8_EMBED_ROMS is on but no roms were listed")
+    endif ()
+
+    set(roms ${ARGN})
+    list(SORT roms)
+
+    set(arrays "")
+    set(table "")
+    set(index 0)
+    foreach (rom IN LISTS roms)
+        set(path ${CMAKE_SOURCE_DIR}/roms/${rom})
+        if (NOT EXISTS ${path})
+            message(FATAL_ERROR "Embedded rom not found: ${path}")
+        endif ()
+        set_property(DIRECTORY APPEND PROPERTY CMAKE_CONFIGURE_DEPENDS ${path})
+
+        file(READ ${path} hex HEX)
+        string(LENGTH "${hex}" hex_length)
+        math(EXPR size "${hex_length} / 2")
+        if (size EQUAL 0)
+            message(FATAL_ERROR "Embedded rom is empty: ${path}")
+        endif ()
+        string(REGEX REPLACE "([0-9a-f][0-9a-f])" "0x\\1," bytes "${hex}")
+
+        string(REPLACE "\\" "\\\\" name "${rom}")
+        string(REPLACE "\"" "\\\"" name "${name}")
+
+        string(APPEND arrays
+                "inline constexpr std::array<Byte, ${size}> ROM_${index}{${bytes}};\n")
+        string(APPEND table "    EmbeddedRom{\"${name}\", ROM_${index}},\n")
+        math(EXPR index "${index} + 1")
+    endforeach ()
+
+    set(content "// generated by cmake/EmbedRoms.cmake, do not edit\n\n")
+    string(APPEND content "${arrays}\n")
+    string(APPEND content "inline constexpr std::array<EmbeddedRom, ${index}> EMBEDDED_ROMS{{\n")
+    string(APPEND content "${table}}};\n")
+    file(CONFIGURE OUTPUT ${output} CONTENT "${content}" @ONLY)
+endfunction()
@@ -1,5 +1,6 @@
 #pragma once
 #include "i_audio.hpp"
+#include "profiling/zones.hpp"
 #include "raylib.h"
 
 #include <array>
@@ -88,6 +89,7 @@ public:
   }
 
   void update() {
+    CHIP8_ZONE("Beeper::update");
     if (!m_Initialized || !m_Playing)
       return;
 
@@ -0,0 +1,279 @@
+#pragma once
+#include "machine.hpp"
+#include "reset_pool.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <format>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace chip8 {
+
+/// where a rom keeps its score, read after every frame
+struct RewardSpec {
+  enum class Format {
+    Binary, // big endian unsigned integer
+    Digits // one decimal digit per byte, as written by FX33
+  };
+
+  std::optional<Address> score; // no score = reward is always 0
+  Byte score_bytes{1};
+  Format format{Format::Binary};
+  std::optional<Address> lives; // episode ends when this byte reaches 0
+
+  [[nodiscard]] std::int64_t read_score(const Memory &memory) const {
+    if (!score)
+      return 0;
+    std::int64_t value{0};
+    for (Byte i{0}; i < score_bytes; ++i) {
+      const Byte b{memory.read(Address{
+          static_cast<Word>(score->get() + i)})};
+      value = format == Format::Digits ? value * 10 + b % 10
+                                       : (value << 8) | b;
+    }
+    return value;
+  }
+
+  [[nodiscard]] bool out_of_lives(const Memory &memory) const {
+    return lives && memory.read(*lives) == 0;
+  }
+
+  /// every address read above is inside memory
+  [[nodiscard]] bool valid() const noexcept {
+    return (!score || (score_bytes > 0 && score->get() + score_bytes <=
+                                              constants::MEMORY_SIZE)) &&
+           (!lives || lives->get() < constants::MEMORY_SIZE);
+  }
+};
+
+struct RewardDbEntry {
+  std::uint64_t hash; // xxh64 of the rom, see rom_hash()
+  std::string_view name;
+  RewardSpec spec;
+};
+
+// roms under roms/ whose score lives in memory. the Brix family keeps it
+// in V5 and FX33s it to 0x314 for drawing, lives stay in VE, so episodes
+// end on max_episode_frames
+inline constexpr std::array KNOWN_REWARDS{
+    RewardDbEntry{0x2F50095261D7C24DULL, "Brix [Andreas Gustafsson, 1990]",
+                  {.score = Address{0x314},
+                   .score_bytes = 3,
+                   .format = RewardSpec::Format::Digits}},
+    RewardDbEntry{0x78163EF9606B9FEEULL, "Brick (Brix hack, 1990)",
+                  {.score = Address{0x314},
+                   .score_bytes = 3,
+                   .format = RewardSpec::Format::Digits}},
+    RewardDbEntry{0x6C36E18EF09B2102ULL,
+                  "Breakout (Brix hack) [David Winter, 1997]",
+                  {.score = Address{0x314},
+                   .score_bytes = 3,
+                   .format = RewardSpec::Format::Digits}},
+};
+
+[[nodiscard]] constexpr const RewardDbEntry *find_reward(
+    std::uint64_t rom_hash) noexcept {
+  const auto found{std::ranges::find(KNOWN_REWARDS, rom_hash,
+                                     &RewardDbEntry::hash)};
+  return found != KNOWN_REWARDS.end() ? &*found : nullptr;
+}
+
+struct BatchEnvConfig {
+  std::size_t envs{16};
+  CpuConfig cpu{.frequency_hz = 600.0};
+  bool clip_sprites{false};
+  unsigned frame_skip{4}; // frames per step, the action is held for all
+  float sticky_actions{0.25f}; // chance per frame to keep the last action
+  std::uint64_t max_episode_frames{18'000}; // 5 minutes, 0 = unlimited
+  std::uint64_t warmup_frames{0}; // run once per rom, before the pool image
+  std::uint32_t seed{0};
+};
+
+/// N headless machines stepped in lockstep for reinforcement learning. one
+/// instance is meant to be driven by one thread, run one per core and share
+/// the reset pool between them. finished episodes reset automatically and
+/// report the first observation of the next episode
+class BatchEnv {
+public:
+  static constexpr std::size_t OBSERVATION_BYTES{constants::DISPLAY_PIXELS / 8};
+
+  static Result<std::unique_ptr<BatchEnv>> create(
+      std::span<const Byte> rom, const BatchEnvConfig &config,
+      const RewardSpec &reward = {},
+      std::shared_ptr<ResetPool> pool = nullptr) {
+    using R = Result<std::unique_ptr<BatchEnv>>;
+    if (config.envs == 0)
+      return R{Error::config("batch needs at least one environment")};
+    if (config.frame_skip == 0)
+      return R{Error::config("frame skip must be at least 1")};
+    if (config.sticky_actions < 0.0f || config.sticky_actions > 1.0f)
+      return R{Error::config("sticky action chance must be in [0, 1]")};
+    if (!reward.valid())
+      return R{Error::config("reward addresses must be inside memory")};
+
+    if (!pool)
+      pool = std::make_shared<ResetPool>(config.warmup_frames, KeyMask{0},
+                                         config.seed);
+    std::unique_ptr<BatchEnv> env{
+        new BatchEnv{config, reward, std::move(pool)}};
+    for (std::size_t i{0}; i < config.envs; ++i) {
+      auto &slot{env->m_Envs.emplace_back(config)};
+      if (auto loaded{slot.machine.load_rom(rom)}; !loaded)
+        return R{loaded.error()};
+    }
+    return R{std::move(env)};
+  }
+
+  BatchEnv(const BatchEnv &) = delete;
+  BatchEnv &operator=(const BatchEnv &) = delete;
+
+  [[nodiscard]] std::size_t size() const noexcept { return m_Envs.size(); }
+
+  /// environment steps so far, for steps per second
+  [[nodiscard]] std::uint64_t steps() const noexcept { return m_Steps; }
+
+  /// starts a new episode everywhere, observations is size() *
+  /// OBSERVATION_BYTES
+  Result<void> reset(std::span<Byte> observations) {
+    if (observations.size() != size() * OBSERVATION_BYTES)
+      return Error::runtime("observation buffer has the wrong size");
+
+    for (std::size_t i{0}; i < size(); ++i) {
+      begin_episode(m_Envs[i]);
+      write_observation(m_Envs[i].machine, observation(observations, i));
+    }
+    return Ok();
+  }
+
+  /// one step of every environment. actions are held key masks, the other
+  /// spans have one entry per environment. a rom fault stops the step and
+  /// is returned, the faulting machine is left as is for inspection and
+  /// reset() starts over
+  Result<void> step(std::span<const KeyMask> actions,
+                    std::span<Byte> observations, std::span<float> rewards,
+                    std::span<std::uint8_t> dones) {
+    if (actions.size() != size() || rewards.size() != size() ||
+        dones.size() != size() ||
+        observations.size() != size() * OBSERVATION_BYTES)
+      return Error::runtime("batch buffers have the wrong size");
+
+    for (std::size_t i{0}; i < size(); ++i) {
+      auto &env{m_Envs[i]};
+      float reward{0.0f};
+      bool done{false};
+
+      for (unsigned f{0}; f < m_Config.frame_skip && !done; ++f) {
+        if (!sticky(env))
+          env.action = actions[i];
+        env.machine.set_keys(env.action);
+
+        if (auto result{env.machine.run_frame()}; !result)
+          return result;
+        const auto score{m_Reward.read_score(env.machine.memory())};
+        reward += static_cast<float>(score - env.score);
+        env.score = score;
+
+        done = m_Reward.out_of_lives(env.machine.memory()) ||
+               (m_Config.max_episode_frames != 0 &&
+                env.machine.frame_count() >= m_Config.max_episode_frames);
+      }
+
+      if (done)
+        begin_episode(env);
+      write_observation(env.machine, observation(observations, i));
+      rewards[i] = reward;
+      dones[i] = done;
+    }
+    m_Steps += size();
+    return Ok();
+  }
+
+  [[nodiscard]] const Machine &machine(std::size_t i) const {
+    return m_Envs.at(i).machine;
+  }
+
+  /// 1 bit per pixel, row major, most significant bit leftmost, the same
+  /// layout as chip8 sprites
+  static void write_observation(const Machine &machine,
+                                std::span<Byte> out) noexcept {
+    const auto &pixels{machine.display().buffer()};
+    for (std::size_t i{0}; i < OBSERVATION_BYTES; ++i) {
+      const bool *p{pixels.data() + i * 8};
+      out[i] = static_cast<Byte>(p[0] << 7 | p[1] << 6 | p[2] << 5 |
+                                 p[3] << 4 | p[4] << 3 | p[5] << 2 |
+                                 p[6] << 1 | p[7]);
+    }
+  }
+
+private:
+  struct Env {
+    explicit Env(const BatchEnvConfig &config)
+      : machine{config.cpu, config.clip_sprites} {
+    }
+
+    Machine machine;
+    KeyMask action{0};
+    std::int64_t score{0};
+    std::uint32_t rng{0};
+  };
+
+  BatchEnv(const BatchEnvConfig &config, const RewardSpec &reward,
+           std::shared_ptr<ResetPool> pool)
+    : m_Config{config},
+      m_Reward{reward},
+      m_Pool{std::move(pool)} {
+  }
+
+  void begin_episode(Env &env) {
+    m_Pool->reset(env.machine);
+    // a fresh seed per episode, the pool image carries the same rng state
+    const auto episode{m_Episodes++};
+    env.machine.seed(m_Config.seed ^ static_cast<std::uint32_t>(
+                         episode * 0x9E3779B9u));
+    // sticky actions get their own stream, independent of CXNN
+    env.rng = mix(m_Config.seed ^ static_cast<std::uint32_t>(episode) ^
+                  0x5F3759DFu);
+    env.action = 0;
+    env.score = m_Reward.read_score(env.machine.memory());
+  }
+
+  // ale style: with sticky_actions chance the previous action repeats
+  bool sticky(Env &env) const noexcept {
+    if (m_Config.sticky_actions <= 0.0f)
+      return false;
+    auto &x{env.rng};
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return static_cast<float>(x >> 8) * 0x1p-24f < m_Config.sticky_actions;
+  }
+
+  /// murmur3 finalizer, never 0 so xorshift can't get stuck
+  static std::uint32_t mix(std::uint32_t x) noexcept {
+    x ^= x >> 16;
+    x *= 0x85EBCA6B;
+    x ^= x >> 13;
+    x *= 0xC2B2AE35;
+    x ^= x >> 16;
+    return x != 0 ? x : 1;
+  }
+
+  static std::span<Byte> observation(std::span<Byte> all, std::size_t i) {
+    return all.subspan(i * OBSERVATION_BYTES, OBSERVATION_BYTES);
+  }
+
+  BatchEnvConfig m_Config;
+  RewardSpec m_Reward;
+  std::shared_ptr<ResetPool> m_Pool;
+  std::deque<Env> m_Envs; // machines can't move
+  std::uint64_t m_Steps{0};
+  std::uint64_t m_Episodes{0};
+};
+
+}
@@ -4,6 +4,9 @@
 #include "memory.hpp"
 #include "timers.hpp"
 #include "types.hpp"
+#include "profiling/call_profiler.hpp"
+#include "profiling/trace.hpp"
+#include "profiling/zones.hpp"
 #include "utils/logger.hpp"
 
 #include <random>
@@ -18,6 +21,7 @@ struct CpuState {
   Byte stack_pointer{0}; // SP
   bool waiting_for_key{false};
   RegisterIndex key_register{0};
+  std::uint32_t rng{0x2545F491}; // CXNN xorshift state, survives reset
 };
 
 struct CpuConfig {
@@ -38,9 +42,8 @@ public:
   explicit Cpu(Memory &memory, Timers &timers, CpuConfig config = {})
     : m_Memory{memory},
       m_Timers{timers},
-      m_Config{config},
-      m_Rng{std::random_device{}()},
-      m_Dist{0, 255} {
+      m_Config{config} {
+    seed(std::random_device{}());
   }
 
   [[nodiscard]] RegisterValue reg(RegisterIndex idx) const {
@@ -68,7 +71,9 @@ public:
   }
 
   [[nodiscard]] const CpuState &state() const noexcept { return m_State; }
+  void set_state(const CpuState &state) noexcept { m_State = state; }
   [[nodiscard]] const CpuConfig &config() const noexcept { return m_Config; }
+  void set_config(const CpuConfig &config) noexcept { m_Config = config; }
 
   // callback registration
   void set_key_check(KeyCheckFn fn) { m_Key_check = std::move(fn); }
@@ -76,9 +81,35 @@ public:
   void set_draw(DrawFn fn) { m_Draw = std::move(fn); }
   void set_clear_display(ClearDisplayFn fn) { m_Clear_display = std::move(fn); }
 
+  // instrumentation, profiler is not owned and may be null
+  void set_call_profiler(CallProfiler *profiler) noexcept {
+    m_Call_profiler = profiler;
+  }
+  [[nodiscard]] CallProfiler *call_profiler() const noexcept {
+    return m_Call_profiler;
+  }
+
+  // instruction trace, ring is not owned and may be null
+  void set_trace(TraceRing *trace) noexcept { m_Trace = trace; }
+  [[nodiscard]] TraceRing *trace() const noexcept { return m_Trace; }
+
+  /// make CXNN reproducible, e.g. for headless runs
+  void seed(std::uint32_t seed) noexcept {
+    // murmur3 finalizer so nearby seeds diverge, xorshift must not be 0
+    seed ^= seed >> 16;
+    seed *= 0x85EBCA6B;
+    seed ^= seed >> 13;
+    seed *= 0xC2B2AE35;
+    seed ^= seed >> 16;
+    m_State.rng = seed != 0 ? seed : CpuState{}.rng;
+  }
+
 
   // execution
-  Result<void> step() {
+  StepResult step() {
+    if (m_Call_profiler)
+      m_Call_profiler->on_step();
+
     if (m_State.waiting_for_key) {
       if (m_Key_wait) {
         if (auto key{m_Key_wait()}) {
@@ -90,23 +121,30 @@ public:
           return Ok(); // no instruction
         }
       } else {
-        return Error::runtime("No key wait handler registered");
+        return Fault::no_key_wait_handler();
       }
     }
 
-    const Opcode opcode{m_Memory.read_opcode(m_State.program_counter)};
-    LOG_DEBUG("PC: ${:04X}  OP: ${:04X}", m_State.program_counter.get(), opcode.get());
-
+    // only this instruction's accesses count, not ones other code made
+    m_Memory.clear_fault();
+    const Address pc{m_State.program_counter};
+    const Opcode opcode{m_Memory.read_opcode(pc)};
     const Instruction instr{decode(opcode)};
 
     // advance PC
-    m_State.program_counter = Address{
-        static_cast<Word>(m_State.program_counter.get() + 2)};
+    m_State.program_counter = Address{static_cast<Word>(pc.get() + 2)};
+
+    if (!m_Trace)
+      return checked(execute(instr), pc);
 
-    return execute(instr);
+    const RegisterFile before{m_State.registers};
+    auto result{execute(instr)};
+    m_Trace->record(pc, opcode, m_State.index, before, m_State.registers);
+    return checked(result, pc);
   }
 
-  Result<void> run(int cycles) {
+  StepResult run(int cycles) {
+    CHIP8_ZONE("Cpu::run");
     for (int i{0}; i < cycles; ++i) {
       auto result{step()};
       if (!result)
@@ -116,119 +154,137 @@ public:
   }
 
   void reset() noexcept {
-    m_State = CpuState{};
+    m_State = CpuState{.rng = m_State.rng};
     m_State.program_counter = Address{constants::PROGRAM_START};
+    if (m_Call_profiler)
+      m_Call_profiler->reset_stack();
   }
 
 private:
-  Result<void> execute(const Instruction &instr) {
-    return std::visit([this](const auto &i) -> Result<void> {
+  /// an out of range access during the instruction fails it
+  StepResult checked(StepResult result, Address pc) noexcept {
+    if (m_Memory.has_fault()) [[unlikely]]
+      return m_Memory.take_fault(pc);
+    return result;
+  }
+
+  StepResult execute(const Instruction &instr) {
+    return std::visit([this](const auto &i) -> StepResult {
       return execute_impl(i);
     }, instr);
   }
 
   /// 00E0 Clear display
-  Result<void> execute_impl(const instructions::ClearDisplay &) {
+  StepResult execute_impl(const instructions::ClearDisplay &) {
     if (m_Clear_display)
       m_Clear_display();
     return Ok();
   }
 
+  /// the pc has already moved past the instruction being executed
+  [[nodiscard]] Word instruction_address() const noexcept {
+    return static_cast<Word>(m_State.program_counter.get() - 2);
+  }
+
   /// 00EE Return from subroutine
-  Result<void> execute_impl(const instructions::Return &) {
+  StepResult execute_impl(const instructions::Return &) {
     if (m_State.stack_pointer == 0)
-      return Error::stack("Stack underflow on RET");
+      return Fault::stack_underflow(instruction_address());
 
     --m_State.stack_pointer;
     m_State.program_counter = m_State.stack[m_State.stack_pointer];
+    if (m_Call_profiler)
+      m_Call_profiler->on_return();
     return Ok();
   }
 
   /// 0NNN system call (mostly ignored on modern hw)
-  Result<void> execute_impl(const instructions::SysCall &) {
+  StepResult execute_impl(const instructions::SysCall &) {
     return Ok();
   }
 
   /// 1NNN jump to address
-  Result<void> execute_impl(const instructions::Jump &i) {
+  StepResult execute_impl(const instructions::Jump &i) {
     m_State.program_counter = i.address;
     return Ok();
   }
 
   /// 2NNN call subroutine
-  Result<void> execute_impl(const instructions::Call &i) {
+  StepResult execute_impl(const instructions::Call &i) {
     if (m_State.stack_pointer >= constants::STACK_SIZE)
-      return Error::stack("Stack overflow on CALL");
+      return Fault::stack_overflow(instruction_address());
 
     m_State.stack[m_State.stack_pointer] = m_State.program_counter;
     ++m_State.stack_pointer;
     m_State.program_counter = i.address;
+    if (m_Call_profiler)
+      m_Call_profiler->on_call(i.address);
     return Ok();
   }
 
   /// 3XNN skip if VX equals NN
-  Result<void> execute_impl(const instructions::SkipIfEqual &i) {
+  StepResult execute_impl(const instructions::SkipIfEqual &i) {
     if (reg(i.reg).get() == i.value)
       skip_instruction();
     return Ok();
   }
 
   /// 4XNN skip if VX not equals NN
-  Result<void> execute_impl(const instructions::SkipIfNotEqual &i) {
+  StepResult execute_impl(const instructions::SkipIfNotEqual &i) {
     if (reg(i.reg).get() != i.value)
       skip_instruction();
     return Ok();
   }
 
   // 5XY0 skip if VX equals VY
-  Result<void> execute_impl(const instructions::SkipIfRegistersEqual &i) {
+  StepResult execute_impl(const instructions::SkipIfRegistersEqual &i) {
     if (reg(i.x).get() == reg(i.y).get())
       skip_instruction();
     return Ok();
   }
 
   // 6XNN load immediate value into VX
-  Result<void> execute_impl(const instructions::LoadImmediate &i) {
+  StepResult execute_impl(const instructions::LoadImmediate &i) {
     set_reg(i.reg, i.value);
     return Ok();
   }
 
   /// 7XNN add immediate value to VX, no carry
-  Result<void> execute_impl(const instructions::AddImmediate &i) {
+  StepResult execute_impl(const instructions::AddImmediate &i) {
     const auto result{static_cast<Byte>(reg(i.reg).get() + i.value)};
     set_reg(i.reg, result);
     return Ok();
   }
 
   /// 8XY0 load VY into VX
-  Result<void> execute_impl(const instructions::LoadRegister &i) {
+  StepResult execute_impl(const instructions::LoadRegister &i) {
     set_reg(i.x, reg(i.y));
     return Ok();
   }
 
   /// 8XY1 VX=VX OR VY
-  Result<void> execute_impl(const instructions::Or &i) {
+  StepResult execute_impl(const instructions::Or &i) {
     set_reg(i.x, static_cast<Byte>(reg(i.x).get() | reg(i.y).get()));
     set_vf(0);
     return Ok();
   }
 
   /// 8XY2 VX=VX AND VY
-  Result<void> execute_impl(const instructions::And &i) {
+  StepResult execute_impl(const instructions::And &i) {
     set_reg(i.x, static_cast<Byte>(reg(i.x).get() & reg(i.y).get()));
     set_vf(0);
     return Ok();
   }
 
   /// 8XY3 VX=VX XOR VY
-  Result<void> execute_impl(const instructions::Xor &i) {
+  StepResult execute_impl(const instructions::Xor &i) {
     set_reg(i.x, static_cast<Byte>(reg(i.x).get() ^ reg(i.y).get()));
     set_vf(0);
     return Ok();
   }
 
   /// 8XY4 VX=VX+VY, VF=carry
-  Result<void> execute_impl(const instructions::AddRegisters &i) {
+  StepResult execute_impl(const instructions::AddRegisters &i) {
     const int sum{reg(i.x).get() + reg(i.y).get()};
     const Byte carry{(sum > 255) ? 1 : 0};
     set_reg(i.x, static_cast<Byte>(sum & 0xFF));
@@ -237,7 +293,7 @@ private:
   }
 
   /// 8XY5 VX=VX-VY, VF=not borrow
-  Result<void> execute_impl(const instructions::SubRegisters &i) {
+  StepResult execute_impl(const instructions::SubRegisters &i) {
     const Byte vx{reg(i.x).get()};
     const Byte vy{reg(i.y).get()};
     const Byte no_borrow{(vx >= vy) ? 1 : 0};
@@ -247,7 +303,7 @@ private:
   }
 
   /// 8XY6 shift right
-  Result<void> execute_impl(const instructions::ShiftRight &i) {
+  StepResult execute_impl(const instructions::ShiftRight &i) {
     const Byte value{m_Config.shift_quirk ? reg(i.x).get() : reg(i.y).get()};
     const Byte lsb{value & 0x01};
     set_reg(i.x, static_cast<Byte>(value >> 1));
@@ -256,7 +312,7 @@ private:
   }
 
   /// 8XY7 VX=VY - VX, VF=not borrow
-  Result<void> execute_impl(const instructions::SubRegistersReverse &i) {
+  StepResult execute_impl(const instructions::SubRegistersReverse &i) {
     const Byte vx{reg(i.x).get()};
     const Byte vy{reg(i.y).get()};
     const Byte no_borrow{(vy >= vx) ? 1 : 0};
@@ -266,7 +322,7 @@ private:
   }
 
   /// 8XYE shift left
-  Result<void> execute_impl(const instructions::ShiftLeft &i) {
+  StepResult execute_impl(const instructions::ShiftLeft &i) {
     const Byte value{m_Config.shift_quirk ? reg(i.x).get() : reg(i.y).get()};
     const Byte msb{(value >> 7) & 0x01};
     set_reg(i.x, static_cast<Byte>(value << 1));
@@ -275,7 +331,7 @@ private:
   }
 
   /// 9XY0 skip if VX not equals VY
-  Result<void> execute_impl(const instructions::SkipIfRegistersNotEqual &i) {
+  StepResult execute_impl(const instructions::SkipIfRegistersNotEqual &i) {
     if (reg(i.x).get() != reg(i.y).get())
       skip_instruction();
 
@@ -283,13 +339,13 @@ private:
   }
 
   /// ANNN set index register
-  Result<void> execute_impl(const instructions::LoadIndex &i) {
+  StepResult execute_impl(const instructions::LoadIndex &i) {
     m_State.index = i.address;
     return Ok();
   }
 
   /// BNNN jump with offset
-  Result<void> execute_impl(const instructions::JumpOffset &i) {
+  StepResult execute_impl(const instructions::JumpOffset &i) {
     const Word offset{
         m_Config.jump_quirk
           ? reg(opcode_bits::x_reg(Opcode{i.address.get()})).get()
@@ -302,16 +358,21 @@ private:
   }
 
   /// CXNN random number
-  Result<void> execute_impl(const instructions::Random &i) {
-    const Byte random_value{static_cast<Byte>(m_Dist(m_Rng))};
+  StepResult execute_impl(const instructions::Random &i) {
+    // xorshift32, four bytes of state fit in CpuState and save states
+    auto &x{m_State.rng};
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    const Byte random_value{static_cast<Byte>(x >> 24)};
     set_reg(i.reg, static_cast<Byte>(random_value & i.mask));
     return Ok();
   }
 
   /// DXYN draw sprite
-  Result<void> execute_impl(const instructions::Draw &i) {
+  StepResult execute_impl(const instructions::Draw &i) {
     if (!m_Draw)
-      return Error::runtime("No draw handler registered");
+      return Fault::no_draw_handler();
 
     const Byte x{reg(i.x).get()};
     const Byte y{reg(i.y).get()};
@@ -323,7 +384,7 @@ private:
   }
 
   /// EX9E skip if key pressed
-  Result<void> execute_impl(const instructions::SkipIfKeyPressed &i) {
+  StepResult execute_impl(const instructions::SkipIfKeyPressed &i) {
     if (m_Key_check) {
       const KeyIndex key{static_cast<Byte>(reg(i.reg).get() & 0x0F)};
       if (m_Key_check(key))
@@ -333,7 +394,7 @@ private:
   }
 
   /// EXA1 skip if key not pressed
-  Result<void> execute_impl(const instructions::SkipIfKeyNotPressed &i) {
+  StepResult execute_impl(const instructions::SkipIfKeyNotPressed &i) {
     if (m_Key_check) {
       const KeyIndex key{static_cast<Byte>(reg(i.reg).get() & 0x0F)};
       if (!m_Key_check(key))
@@ -345,46 +406,46 @@ private:
   }
 
   /// FX07 load delay timer value
-  Result<void> execute_impl(const instructions::LoadDelayTimer &i) {
+  StepResult execute_impl(const instructions::LoadDelayTimer &i) {
     set_reg(i.reg, m_Timers.delay());
     return Ok();
   }
 
   /// FX0A wait for key press
-  Result<void> execute_impl(const instructions::WaitForKey &i) {
+  StepResult execute_impl(const instructions::WaitForKey &i) {
     m_State.waiting_for_key = true;
     m_State.key_register = i.reg;
     return Ok();
   }
 
   /// FX15 set delay timer
-  Result<void> execute_impl(const instructions::SetDelayTimer &i) {
+  StepResult execute_impl(const instructions::SetDelayTimer &i) {
     m_Timers.set_delay(reg(i.reg).get());
     return Ok();
   }
 
   /// FX18 set sound timer
-  Result<void> execute_impl(const instructions::SetSoundTimer &i) {
+  StepResult execute_impl(const instructions::SetSoundTimer &i) {
     m_Timers.set_sound(reg(i.reg).get());
     return Ok();
   }
 
   /// FX1E add to index
-  Result<void> execute_impl(const instructions::AddToIndex &i) {
+  StepResult execute_impl(const instructions::AddToIndex &i) {
     const Word new_index{m_State.index.get() + reg(i.reg).get()};
     m_State.index = Address{new_index};
     return Ok();
   }
 
   /// FX29 set index to font sprite
-  Result<void> execute_impl(const instructions::LoadFontSprite &i) {
+  StepResult execute_impl(const instructions::LoadFontSprite &i) {
     const Byte digit{reg(i.reg).get() & 0x0F};
     m_State.index = Memory::font_sprite_address(digit);
     return Ok();
   }
 
   /// FX33 store BCD representation
-  Result<void> execute_impl(const instructions::StoreBCD &i) {
+  StepResult execute_impl(const instructions::StoreBCD &i) {
     const Byte value{reg(i.reg).get()};
     m_Memory.write(m_State.index, static_cast<Byte>(value / 100));
     m_Memory.write(Address{static_cast<Word>(m_State.index.get() + 1)},
@@ -397,7 +458,7 @@ private:
   }
 
   /// FX55 store registers V0-VX
-  Result<void> execute_impl(const instructions::StoreRegisters &i) {
+  StepResult execute_impl(const instructions::StoreRegisters &i) {
     for (Byte reg_idx{0}; reg_idx <= i.max_reg.get(); ++reg_idx) {
       m_Memory.write(Address{static_cast<Word>(m_State.index.get() + reg_idx)},
                      m_State.registers[reg_idx].get());
@@ -411,7 +472,7 @@ private:
   }
 
   /// FX65 load registers V0-VX
-  Result<void> execute_impl(const instructions::LoadRegisters &i) {
+  StepResult execute_impl(const instructions::LoadRegisters &i) {
     for (Byte reg_idx{0}; reg_idx <= i.max_reg.get(); ++reg_idx) {
       m_State.registers[reg_idx] = RegisterValue{
           m_Memory.read(
@@ -427,9 +488,8 @@ private:
 
 
   /// Unknown instruction
-  Result<void> execute_impl(const instructions::Unknown &i) {
-    return Error::opcode(std::format("Unknown opcode: ${:04X}",
-                                     i.opcode.get()));
+  StepResult execute_impl(const instructions::Unknown &i) {
+    return Fault::unknown_opcode(i.opcode.get(), instruction_address());
   }
 
 
@@ -444,14 +504,14 @@ private:
   CpuConfig m_Config;
   CpuState m_State;
 
-  std::mt19937 m_Rng;
-  std::uniform_int_distribution<int> m_Dist;
-
   // callbacks
   KeyCheckFn m_Key_check;
   KeyWaitFn m_Key_wait;
   DrawFn m_Draw;
   ClearDisplayFn m_Clear_display;
+
+  CallProfiler *m_Call_profiler{nullptr};
+  TraceRing *m_Trace{nullptr};
 };
 
 
@@ -0,0 +1,85 @@
+#pragma once
+#include "machine.hpp"
+#include "state_hash.hpp"
+
+#include <array>
+#include <cstdint>
+#include <optional>
+
+namespace chip8 {
+
+/// spots a machine coming back to a state it was in before. with the same
+/// input from there on it will loop forever, so a batch run can stop it or
+/// skip ahead. seen states go in a small direct mapped table, long periods
+/// can be missed but a reported one is exact. takes over the memory dirty
+/// page mask, nothing else should clear it between checks
+class CycleDetector {
+public:
+  static constexpr std::size_t HISTORY{256};
+
+  struct Cycle {
+    std::uint64_t start; // first frame of the loop
+    std::uint64_t period; // frames per loop
+  };
+
+  /// call once per frame, after run_frame()
+  std::optional<Cycle> check(Machine &machine) {
+    auto &memory{machine.memory()};
+    const auto hash{m_Hasher.hash(machine, memory.dirty_pages())};
+    memory.clear_dirty_pages();
+
+    const auto frame{machine.frame_count()};
+    auto &slot{m_History[hash % HISTORY]};
+    if (slot.frame != NONE && slot.hash == hash && slot.frame < frame)
+      return Cycle{slot.frame, frame - slot.frame};
+
+    slot = Entry{hash, frame};
+    return std::nullopt;
+  }
+
+  void reset() noexcept {
+    m_History.fill(Entry{});
+    m_Hasher.invalidate();
+  }
+
+private:
+  static constexpr std::uint64_t NONE{UINT64_MAX};
+
+  struct Entry {
+    std::uint64_t hash{0};
+    std::uint64_t frame{NONE};
+  };
+
+  StateHasher m_Hasher;
+  std::array<Entry, HISTORY> m_History{};
+};
+
+struct RunSummary {
+  std::uint64_t frames_emulated{0}; // the rest were skipped
+  std::optional<CycleDetector::Cycle> cycle;
+};
+
+/// runs until frame_count() == frame with the current keys held. once a
+/// cycle shows up the remaining whole loops are skipped, the machine ends
+/// in exactly the state a full run would have left it in
+inline Result<RunSummary> run_until(Machine &machine, std::uint64_t frame,
+                                    CycleDetector &detector) {
+  RunSummary summary;
+  machine.memory().mark_dirty_pages(Memory::ALL_PAGES);
+  while (machine.frame_count() < frame) {
+    if (auto result{machine.run_frame()}; !result)
+      return Result<RunSummary>{result.error()};
+    ++summary.frames_emulated;
+
+    if (summary.cycle)
+      continue;
+    summary.cycle = detector.check(machine);
+    if (summary.cycle) {
+      const auto left{frame - machine.frame_count()};
+      machine.skip_frames(left - left % summary.cycle->period);
+    }
+  }
+  return Result<RunSummary>{summary};
+}
+
+}
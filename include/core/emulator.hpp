@@ -1,17 +1,26 @@
 #pragma once
-#include "cpu.hpp"
-#include "memory.hpp"
-#include "timers.hpp"
+#include "machine.hpp"
+#include "quirk_detector.hpp"
+#include "run_ahead.hpp"
+#include "save_state.hpp"
 #include "audio/beeper.hpp"
-#include "graphics/Display.hpp"
 #include "graphics/renderer.hpp"
 #include "input/keyboard.hpp"
 #include "input/raylib_key_provider.hpp"
+#include "profiling/latency_probe.hpp"
+#include "profiling/perf_counters.hpp"
+#include "utils/alloc_counter.hpp"
 #include "utils/config.hpp"
+#include "utils/hash.hpp"
+#include "utils/quirk_db.hpp"
+#include "utils/quirk_profiles.hpp"
 #include "utils/rom_loader.hpp"
 
 #include <chrono>
 #include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
 
 namespace chip8 {
 
@@ -30,6 +39,20 @@ struct EmulatorStats {
   double average_fps{0.0};
   double cpu_utilization{0.0};
   std::chrono::steady_clock::time_point start_time;
+
+  // key press until the first changed frame is on screen
+  uint64_t latency_samples{0};
+  std::chrono::duration<double, std::milli> latency_total{0.0};
+
+  // heap allocations made by update() on the emulation thread, stays 0
+  // unless the binary installs the counter, see utils/alloc_counter.hpp
+  uint64_t update_allocations{0};
+
+  [[nodiscard]] double average_latency_ms() const noexcept {
+    return latency_samples == 0
+               ? 0.0
+               : latency_total.count() / static_cast<double>(latency_samples);
+  }
 };
 
 class Emulator {
@@ -38,16 +61,20 @@ public:
   using Duration = std::chrono::duration<double>;
 
   explicit Emulator(const Config &config = {})
+    : Emulator{config,
+               std::make_unique<RaylibRenderer>(config.display_scale),
+               std::make_shared<RaylibKeyProvider>()} {
+  }
+
+  /// bring your own window and input, e.g. scripted keys for benchmarks
+  Emulator(const Config &config, std::unique_ptr<IRenderer> renderer,
+           std::shared_ptr<IKeyStateProvider> keys)
     : m_Config{config},
-      m_Memory{},
-      m_Timers{},
-      m_Display{},
-      m_Cpu{m_Memory, m_Timers,
-            make_cpu_config(config)},
-      m_Renderer{
-          config.display_scale},
+      m_Machine{make_cpu_config(config), config.clip_sprites},
+      m_Run_ahead{config.run_ahead},
+      m_Renderer{std::move(renderer)},
       m_Audio{},
-      m_Keyboard{std::make_shared<RaylibKeyProvider>()} {
+      m_Keyboard{std::move(keys)} {
     setup_callbacks();
   }
 
@@ -65,7 +92,7 @@ public:
       return Ok();
     LOG_INFO("Initializing CHIP-8 interpreter");
 
-    if (!m_Renderer.initialize()) {
+    if (!m_Renderer->initialize()) {
       m_State = EmulatorState::Error;
       return Error::graphics("Failed to initialize renderer");
     }
@@ -92,31 +119,44 @@ public:
     LOG_INFO("Shutting down");
     m_State = EmulatorState::Stopped;
     m_Audio.shutdown();
-    m_Renderer.shutdown();
+    m_Renderer->shutdown();
 
     m_State = EmulatorState::Uninitialized;
   }
 
 
   Result<void> load_rom(const std::filesystem::path &path) {
+    if (const auto embedded{RomLoader::find_embedded(path)}) {
+      LOG_INFO("Loading embedded ROM: {}", embedded->name);
+      return load_rom(embedded->data, path);
+    }
+
     LOG_INFO("Loading ROM: {}", path.string());
 
     auto rom_result{RomLoader::load(path)};
     if (!rom_result)
       return Error::io(rom_result.error().message());
 
-    auto load_result{m_Memory.load_rom(rom_result->as_span())};
+    return load_rom(rom_result->as_span(), path);
+  }
+
+  /// load from memory that is already in place, e.g. a rom pack mapping.
+  /// name is only used for logging
+  Result<void> load_rom(std::span<const Byte> rom,
+                        const std::filesystem::path &name) {
+    // the machine keeps its own copy for reset, a mapping would fault if
+    // the file got truncated on disk while we run
+    auto load_result{m_Machine.load_rom(rom)};
     if (!load_result)
       return load_result;
 
-    m_Cpu.reset();
-    m_Display.clear();
-    m_Timers.reset();
+    m_Rom_hash = rom_hash(rom);
+    apply_quirks(rom);
 
-    m_Current_ROM_path = path;
+    m_Current_ROM_path = name;
     m_State = EmulatorState::Ready;
 
-    LOG_INFO("ROM loaded: {} bytes", rom_result->size());
+    LOG_INFO("ROM loaded: {} bytes", rom.size());
 
     return Ok();
   }
@@ -162,52 +202,21 @@ public:
   }
 
   void reset() {
-    m_Cpu.reset();
-    m_Display.clear();
-    m_Timers.reset();
+    // restores the program from the cached image, no disk access
+    m_Machine.reset();
     m_Audio.stop_beep();
 
-    if (!m_Current_ROM_path.empty()) {
-      m_Memory.clear_program_area();
-      auto rom_result{RomLoader::load(m_Current_ROM_path)};
-      if (rom_result)
-        m_Memory.load_rom(rom_result->as_span());
-    }
-
     m_State = EmulatorState::Ready;
     LOG_INFO("Emulator reset");
   }
 
+  /// one frame: input, emulation, present. allocation free once running
   Result<void> update() {
-    if (m_Renderer.should_close()) {
-      m_State = EmulatorState::Stopped;
-      return Ok();
-    }
-
-    handle_input();
-
-    if (m_State == EmulatorState::Running) {
-      const int cycles_per_frame{
-          static_cast<int>(m_Config.cpu_frequency / 60.0)};
-
-      for (int i{0}; i < cycles_per_frame; ++i) {
-        auto result{m_Cpu.step()};
-        if (!result) {
-          LOG_ERROR("CPU Error: {}", result.error().message());
-          m_State = EmulatorState::Paused;
-          return result;
-        }
-        ++m_Stats.total_cycles;
-      }
-
-      m_Timers.update();
-      update_audio(); // update audio based on sound timer
-    }
-    m_Audio.update(); // update audio stream
-    m_Renderer.render_frame(m_Display.buffer());
-    ++m_Stats.frames_rendered;
-
-    return Ok();
+    CHIP8_ZONE("Emulator::update");
+    const AllocScope allocations;
+    auto result{update_frame()};
+    m_Stats.update_allocations += allocations.allocations();
+    return result;
   }
 
 
@@ -221,31 +230,109 @@ public:
 
   const EmulatorStats &stats() const noexcept { return m_Stats; }
   const Config &config() const noexcept { return m_Config; }
-  const CpuState &cpu_state() const noexcept { return m_Cpu.state(); }
+  const CpuState &cpu_state() const noexcept {
+    return m_Machine.cpu().state();
+  }
 
   const DisplayBuffer &display_buffer() const noexcept {
-    return m_Display.buffer();
+    return m_Machine.display().buffer();
+  }
+
+  void toggle_fullscreen() { m_Renderer->toggle_fullscreen(); }
+
+  /// attach memory access instrumentation, pass nullptr to detach
+  void set_heatmap(AccessHeatmap *heatmap) noexcept {
+    m_Machine.memory().set_heatmap(heatmap);
+  }
+
+  /// attach subroutine profiling, pass nullptr to detach
+  void set_call_profiler(CallProfiler *profiler) noexcept {
+    m_Machine.cpu().set_call_profiler(profiler);
   }
 
-  void toggle_fullscreen() { m_Renderer.toggle_fullscreen(); }
+  /// attach an instruction trace ring, pass nullptr to detach
+  void set_trace(TraceRing *trace) noexcept {
+    m_Machine.cpu().set_trace(trace);
+  }
+
+  /// attach input to screen stage timing, pass nullptr to detach
+  void set_latency_probe(LatencyProbe *probe) noexcept {
+    m_Latency_probe = probe;
+  }
+
+  /// attach hardware counters split into cpu, display and render phases,
+  /// pass nullptr to detach. must be opened on the thread calling update()
+  void set_perf_counters(PerfCounters *counters) noexcept {
+    m_Perf = counters;
+    m_Machine.set_perf_counters(counters);
+  }
 
 private:
-  void setup_callbacks() {
-    m_Cpu.set_draw([this](Byte x, Byte y, MemoryView sprite) -> bool {
-      return m_Display.draw_sprite(x, y, sprite);
-    });
+  static constexpr std::chrono::milliseconds LATENCY_TIMEOUT{500};
 
-    m_Cpu.set_clear_display([this]() { m_Display.clear(); });
+  Result<void> update_frame() {
+    if (m_Renderer->should_close()) {
+      m_State = EmulatorState::Stopped;
+      return Ok();
+    }
 
-    m_Cpu.set_key_check([this](KeyIndex key) -> bool {
-      return m_Keyboard.is_key_pressed(key);
-    });
+    handle_input();
 
-    m_Cpu.set_key_wait([this]() -> std::optional<KeyIndex> {
-      return m_Keyboard.poll_key_press();
-    });
+    const auto cycles_before{m_Machine.cycle_count()};
+    if (m_State == EmulatorState::Running) {
+      // one frame per vsync, timers tick once per frame
+      const auto keys{key_mask()};
+      if ((keys & ~m_Machine.keys()) != 0) {
+        if (!m_Press_time)
+          m_Press_time = std::chrono::steady_clock::now();
+        probe(LatencyStage::KeyboardUpdate);
+      }
+      m_Machine.set_keys(keys);
+
+      perf(PerfPhase::Cpu);
+      auto result{m_Run_ahead.run_frame(m_Machine)};
+      perf(PerfPhase::Idle);
+      m_Stats.total_cycles += m_Machine.cycle_count() - cycles_before;
+      if (!result) {
+        LOG_ERROR("CPU Error: {}", result.error().message());
+        m_State = EmulatorState::Paused;
+        return result;
+      }
+      probe(LatencyStage::CpuExecute);
+
+      update_audio(); // update audio based on sound timer
+    }
+    m_Audio.update(); // update audio stream
+    const auto &frame{m_Run_ahead.presented()};
+    if (m_Latency_probe && frame != m_Last_frame)
+      probe(LatencyStage::DisplayChange);
+    perf(PerfPhase::Render);
+    m_Renderer->begin_frame();
+    m_Renderer->render(frame);
+    probe(LatencyStage::Render);
+    m_Renderer->end_frame();
+    probe(LatencyStage::EndDrawing);
+    perf(PerfPhase::Idle);
+    if (m_Perf)
+      m_Perf->end_frame(m_Machine.cycle_count() - cycles_before);
+    ++m_Stats.frames_rendered;
+    record_latency(frame);
+
+    return Ok();
+  }
+
+  void probe(LatencyStage stage) {
+    if (m_Latency_probe)
+      m_Latency_probe->mark(stage);
+  }
 
-    m_Timers.set_sound_callback([this](bool playing) {
+  void perf(PerfPhase phase) {
+    if (m_Perf)
+      m_Perf->switch_to(phase);
+  }
+
+  void setup_callbacks() {
+    m_Machine.timers().set_sound_callback([this](bool playing) {
       if (playing)
         m_Audio.start_beep();
       else
@@ -254,6 +341,80 @@ private:
   }
 
 
+  /// built-in database first, then a stored profile, then detection if
+  /// enabled. anything else goes back to the config. quirks forced on the
+  /// command line stay on whatever the profile says
+  void apply_quirks(std::span<const Byte> rom) {
+    auto cpu_config{make_cpu_config(m_Config)};
+    bool clip{m_Config.clip_sprites};
+
+    if (const auto profile{find_profile(rom)}) {
+      const auto &forced{m_Config.forced_quirks};
+      const auto pick{[](bool forced_on, bool profile_value,
+                         std::string_view flag) {
+        if (forced_on && !profile_value)
+          LOG_WARNING("{} overrides the quirk profile", flag);
+        return forced_on || profile_value;
+      }};
+      cpu_config.shift_quirk = pick(forced.shift, profile->shift_quirk,
+                                    "--shift-quirk");
+      cpu_config.load_store_quirk = pick(
+          forced.load_store, profile->load_store_quirk, "--load-store-quirk");
+      cpu_config.jump_quirk = pick(forced.jump, profile->jump_quirk,
+                                   "--jump-quirk");
+      if (profile->frequency_hz > 0.0)
+        cpu_config.frequency_hz = profile->frequency_hz;
+      clip = pick(forced.clip, profile->clip_sprites, "--clip");
+    }
+
+    m_Machine.cpu().set_config(cpu_config);
+    m_Machine.display().set_clip_sprites(clip);
+  }
+
+  std::optional<QuirkProfile> find_profile(std::span<const Byte> rom) const {
+    if (!m_Config.use_quirk_db)
+      return std::nullopt;
+
+    const auto hash{rom_hash(rom)};
+    if (const auto *entry{find_quirks(hash)}) {
+      LOG_INFO("Quirk profile: {}", entry->name);
+      return entry->profile;
+    }
+
+    const QuirkProfileStore store{m_Config.profile_directory};
+    if (auto stored{store.load(hash)}) {
+      LOG_INFO("Quirk profile: {}", store.path_for(hash).string());
+      return stored;
+    }
+
+    if (!m_Config.detect_quirks)
+      return std::nullopt;
+
+    const auto start{std::chrono::steady_clock::now()};
+    const QuirkDetector detector{QuirkDetectorConfig{
+        .frequency_hz = m_Config.cpu_frequency}};
+    const auto detected{detector.detect(rom)};
+    LOG_INFO("Quirks detected in {:.0f} ms: shift={} load_store={} jump={} "
+             "clip={}",
+             std::chrono::duration<double, std::milli>(
+                 std::chrono::steady_clock::now() - start).count(),
+             detected.shift_quirk, detected.load_store_quirk,
+             detected.jump_quirk, detected.clip_sprites);
+
+    if (auto saved{store.save(hash, detected)}; !saved)
+      LOG_WARNING("Quirk profile not saved: {}", saved.error().message());
+    return detected;
+  }
+
+  KeyMask key_mask() const {
+    KeyMask mask{0};
+    const auto &state{m_Keyboard.get_key_state()};
+    for (std::size_t key{0}; key < state.size(); ++key)
+      if (state[key])
+        mask |= static_cast<KeyMask>(1u << key);
+    return mask;
+  }
+
   void handle_input() {
     m_Keyboard.update();
 
@@ -267,10 +428,67 @@ private:
       run();
     } else if (m_Keyboard.is_fullscreen_pressed())
       toggle_fullscreen();
+    else if (m_Keyboard.is_save_state_pressed())
+      save_state();
+    else if (m_Keyboard.is_load_state_pressed())
+      (void)load_state();
+  }
+
+  std::filesystem::path state_path() const {
+    return m_Config.save_directory / std::format("{:016X}.state", m_Rom_hash);
+  }
+
+  /// snapshot now, the file is written on the save thread
+  void save_state() {
+    if (m_State == EmulatorState::Uninitialized)
+      return;
+    m_Save_writer.submit(state_path(), m_Machine.snapshot(), m_Rom_hash);
+    LOG_INFO("State saved: {}", state_path().string());
+  }
+
+  Result<void> load_state() {
+    if (m_State == EmulatorState::Uninitialized)
+      return Error::runtime("No ROM loaded");
+
+    // a save still in flight would race the read
+    m_Save_writer.wait_idle();
+    auto state{SaveState::load(state_path())};
+    if (!state) {
+      LOG_WARNING("State not loaded: {}", state.error().message());
+      return state.error();
+    }
+    if (state->rom_hash != m_Rom_hash) {
+      LOG_WARNING("State belongs to another ROM");
+      return Error::io("State belongs to another ROM");
+    }
+
+    m_Machine.restore(state->snapshot);
+    update_audio();
+    LOG_INFO("State loaded: {}", state_path().string());
+    return Ok();
+  }
+
+  /// the renderer blocks on vsync, so returning from render_frame is as
+  /// close to the photons as we get
+  void record_latency(const DisplayBuffer &frame) {
+    if (!m_Press_time) {
+      m_Last_frame = frame;
+      return;
+    }
+    if (frame != m_Last_frame) {
+      ++m_Stats.latency_samples;
+      m_Stats.latency_total += std::chrono::steady_clock::now() -
+                               *m_Press_time;
+      m_Press_time.reset();
+    } else if (std::chrono::steady_clock::now() - *m_Press_time >
+               LATENCY_TIMEOUT) {
+      m_Press_time.reset(); // a press with nothing to show for it
+    }
+    m_Last_frame = frame;
   }
 
   void update_audio() {
-    if (m_Timers.is_sound_playing()) {
+    if (m_Machine.timers().is_sound_playing()) {
       if (!m_Audio.is_playing())
         m_Audio.start_beep();
     } else {
@@ -290,18 +508,22 @@ private:
 
 
   Config m_Config;
-  Memory m_Memory;
-  Timers m_Timers;
-  Display m_Display;
-  Cpu m_Cpu;
+  Machine m_Machine;
+  RunAhead m_Run_ahead;
 
-  RaylibRenderer m_Renderer;
+  std::unique_ptr<IRenderer> m_Renderer;
   Beeper m_Audio;
   Keyboard m_Keyboard;
 
   EmulatorState m_State{EmulatorState::Uninitialized};
   EmulatorStats m_Stats;
+  std::optional<std::chrono::steady_clock::time_point> m_Press_time;
+  DisplayBuffer m_Last_frame{};
   std::filesystem::path m_Current_ROM_path;
+  std::uint64_t m_Rom_hash{0};
+  SaveStateWriter m_Save_writer;
+  LatencyProbe *m_Latency_probe{nullptr};
+  PerfCounters *m_Perf{nullptr};
 };
 
 
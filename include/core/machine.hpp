@@ -0,0 +1,285 @@
+#pragma once
+#include "cpu.hpp"
+#include "memory.hpp"
+#include "timers.hpp"
+#include "graphics/Display.hpp"
+#include "profiling/perf_counters.hpp"
+#include "utils/hash.hpp"
+
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace chip8 {
+
+/// bit n set = chip8 key n held
+using KeyMask = std::uint16_t;
+
+/// everything a run depends on besides rom and config, plain data so it can
+/// be copied, compared and serialized
+struct MachineSnapshot {
+  CpuState cpu;
+  TimerState timers;
+  MemoryBuffer memory;
+  DisplayBuffer display;
+  KeyMask keys{0};
+  KeyMask previous_keys{0};
+  std::uint64_t frames{0};
+  std::uint64_t cycles{0};
+};
+
+/// host time spent per part of a frame, summed over every timed frame
+struct FrameTiming {
+  using Clock = std::chrono::steady_clock;
+
+  Clock::duration cpu{}; // instruction execution, display time excluded
+  Clock::duration display{}; // DXYN and 00E0
+  Clock::duration timers{};
+
+  [[nodiscard]] Clock::duration total() const noexcept {
+    return cpu + display + timers;
+  }
+};
+
+/// headless interpreter core, memory, cpu, timers, display and keypad wired
+/// together without renderer, audio or a wall clock. a frame is a fixed
+/// number of cycles followed by one 60 Hz timer tick, so a run is fully
+/// determined by rom, config, seed and input
+class Machine {
+public:
+  static constexpr double FRAME_RATE{60.0};
+
+  explicit Machine(const CpuConfig &config = {}, bool clip_sprites = false)
+    : m_Cpu{m_Memory, m_Timers, config} {
+    m_Display.set_clip_sprites(clip_sprites);
+    setup_callbacks();
+  }
+
+  // the cpu holds references and the callbacks capture this
+  Machine(const Machine &) = delete;
+  Machine &operator=(const Machine &) = delete;
+  Machine(Machine &&) = delete;
+  Machine &operator=(Machine &&) = delete;
+
+  /// copies the rom into memory and keeps the image for reset
+  Result<void> load_rom(std::span<const Byte> rom) {
+    if (auto result{m_Memory.load_rom(rom)}; !result)
+      return result;
+    m_Rom.assign(rom.begin(), rom.end());
+    m_Rom_hash = chip8::rom_hash(rom);
+    reset();
+    return Ok();
+  }
+
+  /// power cycle, the program is restored from the cached rom image
+  void reset() {
+    if (!m_Rom.empty())
+      (void)m_Memory.load_rom(m_Rom);
+    m_Cpu.reset();
+    m_Timers.reset();
+    m_Display.clear();
+    m_Keys = 0;
+    m_Previous_keys = 0;
+    m_Frames = 0;
+    m_Cycles = 0;
+  }
+
+  void seed(std::uint32_t seed) { m_Cpu.seed(seed); }
+
+  /// content hash of the loaded rom, 0 before the first load
+  [[nodiscard]] std::uint64_t rom_hash() const noexcept { return m_Rom_hash; }
+
+  void set_keys(KeyMask keys) noexcept { m_Keys = keys; }
+  [[nodiscard]] KeyMask keys() const noexcept { return m_Keys; }
+  /// keys held during the last frame, FX0A waits for a change from these
+  [[nodiscard]] KeyMask previous_keys() const noexcept {
+    return m_Previous_keys;
+  }
+
+  [[nodiscard]] int cycles_per_frame() const noexcept {
+    return std::max(1, static_cast<int>(m_Cpu.config().frequency_hz /
+                                        FRAME_RATE));
+  }
+
+  /// cycles_per_frame() instructions, then one timer tick. stops at the
+  /// first fault, memory faults included
+  StepResult run_frame() {
+    CHIP8_ZONE("Machine::run_frame");
+    const auto outer{m_Perf ? m_Perf->switch_to(PerfPhase::Cpu)
+                            : PerfPhase::Idle};
+    auto result{run_timed_frame()};
+    if (m_Perf)
+      m_Perf->switch_to(outer);
+    return result;
+  }
+
+  [[nodiscard]] MachineSnapshot snapshot() const {
+    return MachineSnapshot{
+        .cpu = m_Cpu.state(),
+        .timers = m_Timers.state(),
+        .memory = m_Memory.data(),
+        .display = m_Display.buffer(),
+        .keys = m_Keys,
+        .previous_keys = m_Previous_keys,
+        .frames = m_Frames,
+        .cycles = m_Cycles};
+  }
+
+  /// the rom image kept for reset is left alone
+  void restore(const MachineSnapshot &snapshot) {
+    m_Cpu.set_state(snapshot.cpu);
+    m_Timers.set_state(snapshot.timers);
+    m_Memory.restore(snapshot.memory);
+    m_Display.set_buffer(snapshot.display);
+    m_Keys = snapshot.keys;
+    m_Previous_keys = snapshot.previous_keys;
+    m_Frames = snapshot.frames;
+    m_Cycles = snapshot.cycles;
+  }
+
+  /// restore() for a machine that was at snapshot and has written only the
+  /// given pages since, the rest of memory is left alone
+  void restore(const MachineSnapshot &snapshot, Memory::PageMask pages) {
+    m_Cpu.set_state(snapshot.cpu);
+    m_Timers.set_state(snapshot.timers);
+    m_Memory.restore_pages(snapshot.memory, pages);
+    m_Display.set_buffer(snapshot.display);
+    m_Keys = snapshot.keys;
+    m_Previous_keys = snapshot.previous_keys;
+    m_Frames = snapshot.frames;
+    m_Cycles = snapshot.cycles;
+  }
+
+  /// count frames as run without running them, for a machine known to be
+  /// in a loop whose length divides frames
+  void skip_frames(std::uint64_t frames) noexcept {
+    m_Frames += frames;
+    m_Cycles += frames * static_cast<std::uint64_t>(cycles_per_frame());
+  }
+
+  /// splits host time between cpu, display and timers from now on, null
+  /// turns it off. costs a clock read per draw
+  void set_frame_timing(FrameTiming *timing) noexcept { m_Timing = timing; }
+
+  /// charges hardware counters to the cpu and display phases of each frame,
+  /// null turns it off. costs two counter reads per draw
+  void set_perf_counters(PerfCounters *counters) noexcept {
+    m_Perf = counters;
+  }
+  [[nodiscard]] PerfCounters *perf_counters() const noexcept { return m_Perf; }
+
+  [[nodiscard]] std::uint64_t frame_count() const noexcept { return m_Frames; }
+  [[nodiscard]] std::uint64_t cycle_count() const noexcept { return m_Cycles; }
+
+  [[nodiscard]] Memory &memory() noexcept { return m_Memory; }
+  [[nodiscard]] const Memory &memory() const noexcept { return m_Memory; }
+  [[nodiscard]] Cpu &cpu() noexcept { return m_Cpu; }
+  [[nodiscard]] const Cpu &cpu() const noexcept { return m_Cpu; }
+  [[nodiscard]] Timers &timers() noexcept { return m_Timers; }
+  [[nodiscard]] const Timers &timers() const noexcept { return m_Timers; }
+  [[nodiscard]] Display &display() noexcept { return m_Display; }
+  [[nodiscard]] const Display &display() const noexcept { return m_Display; }
+
+private:
+  StepResult run_timed_frame() {
+    if (!m_Timing) {
+      if (auto result{run_cycles(cycles_per_frame())}; !result)
+        return result;
+      m_Timers.tick();
+    } else {
+      const auto display{m_Timing->display};
+      const auto start{FrameTiming::Clock::now()};
+      auto result{run_cycles(cycles_per_frame())};
+      const auto cpu_done{FrameTiming::Clock::now()};
+      m_Timing->cpu += (cpu_done - start) - (m_Timing->display - display);
+      if (!result)
+        return result;
+      m_Timers.tick();
+      m_Timing->timers += FrameTiming::Clock::now() - cpu_done;
+    }
+
+    m_Previous_keys = m_Keys;
+    ++m_Frames;
+    return Ok();
+  }
+
+  StepResult run_cycles(int cycles) {
+    for (int i{0}; i < cycles; ++i) {
+      auto result{m_Cpu.step()};
+      ++m_Cycles;
+      if (!result)
+        return result;
+    }
+    return Ok();
+  }
+
+  void setup_callbacks() {
+    m_Cpu.set_draw([this](Byte x, Byte y, MemoryView sprite) -> bool {
+      if (!m_Timing && !m_Perf)
+        return m_Display.draw_sprite(x, y, sprite);
+      const auto scope{enter_display()};
+      const bool collision{m_Display.draw_sprite(x, y, sprite)};
+      leave_display(scope);
+      return collision;
+    });
+
+    m_Cpu.set_clear_display([this]() {
+      if (!m_Timing && !m_Perf)
+        return m_Display.clear();
+      const auto scope{enter_display()};
+      m_Display.clear();
+      leave_display(scope);
+    });
+
+    m_Cpu.set_key_check([this](KeyIndex key) -> bool {
+      return key.get() < constants::NUM_KEYS && (m_Keys >> key.get()) & 1;
+    });
+
+    // FX0A completes on a key that went down this frame, lowest key wins
+    m_Cpu.set_key_wait([this]() -> std::optional<KeyIndex> {
+      const KeyMask pressed{static_cast<KeyMask>(m_Keys & ~m_Previous_keys)};
+      if (pressed == 0)
+        return std::nullopt;
+      return KeyIndex{static_cast<std::uint8_t>(std::countr_zero(pressed))};
+    });
+  }
+
+  /// where a display operation started, to split it off the cpu time
+  struct DisplayScope {
+    PerfPhase outer;
+    FrameTiming::Clock::time_point start;
+  };
+
+  DisplayScope enter_display() noexcept {
+    return DisplayScope{
+        .outer = m_Perf ? m_Perf->switch_to(PerfPhase::Display)
+                        : PerfPhase::Idle,
+        .start = FrameTiming::Clock::now()};
+  }
+
+  void leave_display(const DisplayScope &scope) noexcept {
+    if (m_Timing)
+      m_Timing->display += FrameTiming::Clock::now() - scope.start;
+    if (m_Perf)
+      m_Perf->switch_to(scope.outer);
+  }
+
+  Memory m_Memory;
+  Timers m_Timers;
+  Display m_Display;
+  Cpu m_Cpu;
+
+  std::vector<Byte> m_Rom;
+  std::uint64_t m_Rom_hash{0};
+  KeyMask m_Keys{0};
+  KeyMask m_Previous_keys{0};
+  std::uint64_t m_Frames{0};
+  std::uint64_t m_Cycles{0};
+  FrameTiming *m_Timing{nullptr};
+  PerfCounters *m_Perf{nullptr};
+};
+
+}
@@ -1,9 +1,13 @@
 #pragma once
 #include "types.hpp"
+#include "profiling/heatmap.hpp"
 #include "utils/result.hpp"
 
+#include <algorithm>
+#include <bit>
+#include <cstdint>
 #include <format>
-#include <stdexcept>
+#include <span>
 #include <bits/ranges_algobase.h>
 
 
@@ -11,47 +15,80 @@ namespace chip8 {
 
 class Memory {
 public:
+  /// dirty tracking granularity, bit n of dirty_pages() covers
+  /// [n * PAGE_SIZE, (n + 1) * PAGE_SIZE)
+  static constexpr std::size_t PAGE_SIZE{256};
+  static constexpr std::size_t PAGE_COUNT{constants::MEMORY_SIZE / PAGE_SIZE};
+  using PageMask = std::uint16_t;
+  static constexpr PageMask ALL_PAGES{0xFFFF};
+  static_assert(PAGE_COUNT == 16, "PageMask has one bit per page");
+
   Memory() noexcept {
     clear();
     load_font();
   }
 
+  // an access outside memory does nothing, reads give 0, and is kept as
+  // the fault until take_fault(). the cpu checks once per instruction
+
   // read operations
-  [[nodiscard]] Byte read(Address addr) const {
-    validate_address(addr);
+  [[nodiscard]] Byte read(Address addr) const noexcept {
+    if (!validate_address(addr))
+      return 0;
+    if (m_Heatmap)
+      m_Heatmap->record_read(addr);
     return m_Data[addr.get()];
   }
 
-  [[nodiscard]] Word read_word(Address addr) const {
-    validate_address(addr);
-    validate_address(Address{static_cast<Word>(addr.get() + 1)});
+  [[nodiscard]] Word read_word(Address addr) const noexcept {
+    if (!validate_range(addr, 2))
+      return 0;
 
     return bits::combine(m_Data[addr.get()], m_Data[addr.get() + 1]);
   }
 
-  [[nodiscard]] Opcode read_opcode(Address addr) const {
-    return Opcode{read_word(addr)};
+  [[nodiscard]] Opcode read_opcode(Address addr) const noexcept {
+    const Opcode opcode{read_word(addr)};
+    if (m_Heatmap && !has_fault())
+      m_Heatmap->record_fetch(addr);
+    return opcode;
   }
 
 
-  [[nodiscard]] MemoryView view(Address addr, std::size_t length) const {
-    validate_range(addr, length);
+  /// empty if the range leaves memory
+  [[nodiscard]] MemoryView view(Address addr,
+                                std::size_t length) const noexcept {
+    if (!validate_range(addr, length))
+      return {};
     return MemoryView{m_Data.data() + addr.get(), length};
   }
 
-  [[nodiscard]] MemoryView sprite_data(Address addr, Byte height) const {
-    return view(addr, height);
+  [[nodiscard]] MemoryView sprite_data(Address addr,
+                                       Byte height) const noexcept {
+    const auto sprite{view(addr, height)};
+    if (m_Heatmap && sprite.size() == height)
+      m_Heatmap->record_read_range(addr, height);
+    return sprite;
   }
 
   // write operations
-  void write(Address addr, Byte value) {
-    validate_address(addr);
+  void write(Address addr, Byte value) noexcept {
+    if (!validate_address(addr))
+      return;
+    if (m_Heatmap)
+      m_Heatmap->record_write(addr);
     m_Data[addr.get()] = value;
+    m_Dirty_pages |= static_cast<PageMask>(1u << (addr.get() / PAGE_SIZE));
   }
 
-  void write_range(Address addr, std::span<const Byte> data) {
-    validate_range(addr, data.size());
+  void write_range(Address addr, std::span<const Byte> data) noexcept {
+    if (!validate_range(addr, data.size()))
+      return;
+    if (m_Heatmap)
+      m_Heatmap->record_write_range(addr, data.size());
     std::ranges::copy(data, m_Data.begin() + addr.get());
+    if (!data.empty())
+      m_Dirty_pages |= pages_of(addr.get(), data.size());
   }
 
   // rom loading
@@ -66,10 +103,11 @@ public:
           "ROM too large: {} bytes (max: {} bytes)",
           rom_data.size(), max_rom_size));
 
-    // clear program area
-    std::fill(m_Data.begin() + constants::PROGRAM_START, m_Data.end(), Byte{0});
-    // copy rom to program memory
-    std::ranges::copy(rom_data, m_Data.begin() + constants::PROGRAM_START);
+    // copy rom to program memory, then clear whatever is left after it
+    const auto rom_end{std::ranges::copy(
+        rom_data, m_Data.begin() + constants::PROGRAM_START).out};
+    std::fill(rom_end, m_Data.end(), Byte{0});
+    m_Dirty_pages = ALL_PAGES;
 
     m_Rom_size = rom_data.size();
     return Ok();
@@ -80,12 +118,15 @@ public:
   void clear() {
     m_Data.fill(0);
     load_font();
+    m_Dirty_pages = ALL_PAGES;
     m_Rom_size = 0;
+    m_Fault = NO_FAULT;
   }
 
   /// Clear only the program area, preserve font
   void clear_program_area() noexcept {
     std::fill(m_Data.begin() + constants::PROGRAM_START, m_Data.end(), Byte{0});
+    m_Dirty_pages = ALL_PAGES;
     m_Rom_size = 0;
   }
 
@@ -97,6 +138,37 @@ public:
     return m_Rom_size;
   }
 
+  /// whole address space, for snapshots
+  [[nodiscard]] const MemoryBuffer &data() const noexcept { return m_Data; }
+
+  /// overwrite the whole address space, not recorded in the heatmap
+  void restore(const MemoryBuffer &data) noexcept {
+    m_Data = data;
+    m_Dirty_pages = ALL_PAGES;
+    m_Fault = NO_FAULT;
+  }
+
+  /// copy back only the given pages, e.g. the ones a frame dirtied
+  void restore_pages(const MemoryBuffer &data, PageMask pages) noexcept {
+    m_Dirty_pages |= pages;
+    m_Fault = NO_FAULT;
+    for (; pages != 0; pages &= static_cast<PageMask>(pages - 1)) {
+      const auto offset{std::countr_zero(pages) * PAGE_SIZE};
+      std::copy_n(data.begin() + offset, PAGE_SIZE, m_Data.begin() + offset);
+    }
+  }
+
+  [[nodiscard]] std::span<const Byte, PAGE_SIZE> page(
+      std::size_t index) const noexcept {
+    return std::span<const Byte, PAGE_SIZE>{m_Data.data() + index * PAGE_SIZE,
+                                            PAGE_SIZE};
+  }
+
+  /// pages written since the last clear_dirty_pages()
+  [[nodiscard]] PageMask dirty_pages() const noexcept { return m_Dirty_pages; }
+  void clear_dirty_pages() noexcept { m_Dirty_pages = 0; }
+  void mark_dirty_pages(PageMask pages) noexcept { m_Dirty_pages |= pages; }
+
   // font access
   static constexpr Address font_sprite_address(Byte digit) noexcept {
     // each sprite is 5bytes
@@ -105,34 +177,62 @@ public:
     return Address{static_cast<Word>(constants::FONT_START + offset)};
   }
 
+  // instrumentation, heatmap is not owned and may be null
+  void set_heatmap(AccessHeatmap *heatmap) noexcept { m_Heatmap = heatmap; }
+  [[nodiscard]] AccessHeatmap *heatmap() const noexcept { return m_Heatmap; }
+
   static bool is_valid_range(Address addr, std::size_t length) noexcept {
     const auto end{static_cast<std::size_t>(addr.get() + length)};
     return end <= constants::MEMORY_SIZE;
   }
 
+  [[nodiscard]] bool has_fault() const noexcept {
+    return m_Fault != NO_FAULT;
+  }
+
+  /// forgets out of range accesses made so far, e.g. by a debugger view
+  void clear_fault() noexcept { m_Fault = NO_FAULT; }
+
+  /// the first out of range access since the last clear_fault() or call as
+  /// an error raised at pc, Ok if there was none
+  StepResult take_fault(Address pc) noexcept {
+    if (!has_fault())
+      return Ok();
+    const auto address{static_cast<std::uint16_t>(m_Fault)};
+    m_Fault = NO_FAULT;
+    return Fault::memory_out_of_range(address, pc.get());
+  }
+
 private:
   void load_font() {
     std::ranges::copy(constants::FONT_SET,
                       m_Data.begin() + constants::FONT_START);
   }
 
-  static void validate_address(Address addr) {
-    if (addr.get() >= constants::MEMORY_SIZE)
-      throw std::out_of_range(std::format(
-          "Memory access out of bounds: ${:03X} (max: ${:03X})", addr.get(),
-          constants::MEMORY_SIZE - 1));
+  static PageMask pages_of(std::size_t addr, std::size_t length) noexcept {
+    const auto first{addr / PAGE_SIZE};
+    const auto last{(addr + length - 1) / PAGE_SIZE};
+    return static_cast<PageMask>(((2u << last) - 1) & ~((1u << first) - 1));
   }
 
-  static void validate_range(Address addr, std::size_t length) {
-    if (!is_valid_range(addr, length))
-      throw std::out_of_range(
-          std::format(
-              "Memory range out of bounds: ${:03X}-${:03X} (max: ${:03})",
-              addr.get(), addr.get() + length - 1, constants::MEMORY_SIZE - 1));
+  static constexpr std::uint32_t NO_FAULT{0x10000};
+
+  bool validate_address(Address addr) const noexcept {
+    return validate_range(addr, 1);
+  }
 
+  bool validate_range(Address addr, std::size_t length) const noexcept {
+    if (is_valid_range(addr, length)) [[likely]]
+      return true;
+    if (!has_fault())
+      m_Fault = std::max<std::uint32_t>(addr.get(), constants::MEMORY_SIZE);
+    return false;
   }
 
   MemoryBuffer m_Data{};
   std::size_t m_Rom_size{0};
+  PageMask m_Dirty_pages{ALL_PAGES};
+  mutable std::uint32_t m_Fault{NO_FAULT}; // address, reads fault too
+  AccessHeatmap *m_Heatmap{nullptr};
 };
 }
\ No newline at end of file
@@ -0,0 +1,148 @@
+#pragma once
+#include "machine.hpp"
+#include "input/input_script.hpp"
+#include "utils/hash.hpp"
+#include "utils/quirk_db.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <thread>
+#include <vector>
+
+namespace chip8 {
+
+struct QuirkDetectorConfig {
+  std::uint64_t frames{300}; // 5 s of emulated time
+  double frequency_hz{700.0};
+  std::uint32_t seed{0xC8C8C8C8};
+  unsigned threads{0}; // 0 = hardware concurrency
+};
+
+struct QuirkScore {
+  QuirkProfile profile;
+  std::int64_t score{0};
+  std::uint64_t frames_run{0};
+  std::uint64_t distinct_frames{0};
+  std::optional<Error::Category> fault; // set if the run died
+};
+
+/// guesses the quirks of an unknown rom by running one headless machine per
+/// combination of shift / load-store / jump / clip with the same scripted
+/// input. a run that faults (bad opcode, stack, memory) loses to any run
+/// that does not, otherwise the run that shows more distinct frames wins and
+/// fewer quirks break ties
+class QuirkDetector {
+public:
+  static constexpr std::size_t COMBINATIONS{16};
+
+  explicit QuirkDetector(QuirkDetectorConfig config = {})
+    : m_Config{config},
+      m_Input{InputScript::key_sweep(config.frames)} {
+  }
+
+  /// bit 0 shift, bit 1 load-store, bit 2 jump, bit 3 clip
+  [[nodiscard]] static constexpr QuirkProfile combination(
+      std::size_t i) noexcept {
+    return QuirkProfile{
+        .shift_quirk = (i & 1) != 0,
+        .load_store_quirk = (i & 2) != 0,
+        .jump_quirk = (i & 4) != 0,
+        .clip_sprites = (i & 8) != 0};
+  }
+
+  [[nodiscard]] std::array<QuirkScore, COMBINATIONS> score_all(
+      std::span<const Byte> rom) const {
+    std::array<QuirkScore, COMBINATIONS> scores{};
+
+    unsigned threads{m_Config.threads};
+    if (threads == 0)
+      threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = std::min<unsigned>(threads, COMBINATIONS);
+
+    std::atomic<std::size_t> next{0};
+    const auto worker{[&] {
+      for (std::size_t i{next.fetch_add(1, std::memory_order_relaxed)};
+           i < COMBINATIONS;
+           i = next.fetch_add(1, std::memory_order_relaxed))
+        scores[i] = run(rom, combination(i));
+    }};
+
+    {
+      std::vector<std::jthread> pool;
+      pool.reserve(threads - 1);
+      for (unsigned t{1}; t < threads; ++t)
+        pool.emplace_back(worker);
+      worker();
+    }
+    return scores;
+  }
+
+  [[nodiscard]] QuirkProfile detect(std::span<const Byte> rom) const {
+    const auto scores{score_all(rom)};
+    // max_element keeps the first of equal scores, combination 0 is the
+    // plain interpreter
+    return std::ranges::max_element(scores, {}, &QuirkScore::score)->profile;
+  }
+
+private:
+  static constexpr std::int64_t FAULT_PENALTY{1'000'000};
+
+  [[nodiscard]] QuirkScore run(std::span<const Byte> rom,
+                               const QuirkProfile &profile) const {
+    QuirkScore result{.profile = profile};
+
+    Machine machine{
+        CpuConfig{
+            .shift_quirk = profile.shift_quirk,
+            .load_store_quirk = profile.load_store_quirk,
+            .jump_quirk = profile.jump_quirk,
+            .frequency_hz = m_Config.frequency_hz},
+        profile.clip_sprites};
+    machine.seed(m_Config.seed);
+    if (auto loaded{machine.load_rom(rom)}; !loaded) {
+      result.fault = loaded.error().category();
+      result.score = -FAULT_PENALTY;
+      return result;
+    }
+
+    std::vector<std::uint64_t> frames;
+    frames.reserve(m_Config.frames);
+    for (std::uint64_t frame{0}; frame < m_Config.frames; ++frame) {
+      machine.set_keys(m_Input.keys_at(frame));
+      if (auto stepped{machine.run_frame()}; !stepped) {
+        result.fault = stepped.error().category();
+        break;
+      }
+      frames.push_back(display_hash(machine.display().buffer()));
+    }
+
+    result.frames_run = frames.size();
+    std::ranges::sort(frames);
+    const auto duplicates{std::ranges::unique(frames)};
+    result.distinct_frames = frames.size() - duplicates.size();
+
+    const int quirk_count{profile.shift_quirk + profile.load_store_quirk +
+                          profile.jump_quirk + profile.clip_sprites};
+    if (result.fault)
+      result.score = static_cast<std::int64_t>(result.frames_run) -
+                     FAULT_PENALTY;
+    else
+      result.score = static_cast<std::int64_t>(result.distinct_frames) *
+                     static_cast<std::int64_t>(COMBINATIONS) - quirk_count;
+    return result;
+  }
+
+  static std::uint64_t display_hash(const DisplayBuffer &buffer) noexcept {
+    return Xxh64::hash(std::span<const Byte>{
+        reinterpret_cast<const Byte *>(buffer.data()), buffer.size()});
+  }
+
+  QuirkDetectorConfig m_Config;
+  InputScript m_Input;
+};
+
+}
@@ -0,0 +1,86 @@
+#pragma once
+#include "machine.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+
+namespace chip8 {
+
+/// pristine machine images, one per rom. the first reset of a rom powers
+/// the machine on, seeds it, runs the warm-up frames and keeps the result,
+/// every later reset is one restore of that image instead of a reload.
+/// shared between threads, all machines using a pool must run the same
+/// config. the rng state is part of the image, reseed after reset for
+/// episodes that shouldn't repeat
+class ResetPool {
+public:
+  explicit ResetPool(std::uint64_t warmup_frames = 0, KeyMask warmup_keys = 0,
+                     std::uint32_t warmup_seed = 0)
+    : m_Warmup_frames{warmup_frames},
+      m_Warmup_keys{warmup_keys},
+      m_Warmup_seed{warmup_seed} {
+  }
+
+  ResetPool(const ResetPool &) = delete;
+  ResetPool &operator=(const ResetPool &) = delete;
+
+  /// the machine must have its rom loaded
+  void reset(Machine &machine) {
+    machine.restore(image(machine));
+  }
+
+  /// the image reset() restores, captured from this machine if it is the
+  /// first one seen for its rom. the warm-up runs unlocked, threads racing
+  /// on a new rom each capture it and the first insert wins
+  const MachineSnapshot &image(Machine &machine) {
+    const auto hash{machine.rom_hash()};
+    {
+      const std::shared_lock lock{m_Mutex};
+      if (const auto it{m_Images.find(hash)}; it != m_Images.end())
+        return *it->second;
+    }
+
+    auto captured{std::make_unique<MachineSnapshot>(capture(machine))};
+    const std::unique_lock lock{m_Mutex};
+    return *m_Images.try_emplace(hash, std::move(captured)).first->second;
+  }
+
+  [[nodiscard]] std::size_t size() const {
+    const std::shared_lock lock{m_Mutex};
+    return m_Images.size();
+  }
+
+  [[nodiscard]] std::uint64_t warmup_frames() const noexcept {
+    return m_Warmup_frames;
+  }
+
+private:
+  MachineSnapshot capture(Machine &machine) const {
+    machine.reset();
+    // the same image every run, whatever seed the machine was built with
+    machine.seed(m_Warmup_seed);
+    machine.set_keys(m_Warmup_keys);
+    for (std::uint64_t frame{0}; frame < m_Warmup_frames; ++frame)
+      if (!machine.run_frame())
+        break; // a rom that faults this early resets into the fault
+    auto snapshot{machine.snapshot()};
+    snapshot.keys = 0;
+    snapshot.previous_keys = 0;
+    return snapshot;
+  }
+
+  std::uint64_t m_Warmup_frames;
+  KeyMask m_Warmup_keys;
+  std::uint32_t m_Warmup_seed;
+
+  mutable std::shared_mutex m_Mutex;
+  // snapshots are 6 KB, boxed so rehashing never moves them and
+  // references handed out stay valid
+  std::unordered_map<std::uint64_t, std::unique_ptr<MachineSnapshot>>
+  m_Images;
+};
+
+}
@@ -0,0 +1,84 @@
+#pragma once
+#include "machine.hpp"
+
+#include <algorithm>
+
+namespace chip8 {
+
+/// hides the frame of input lag most games have. after the real frame the
+/// machine runs a few more frames with the same keys, that future display
+/// is what gets presented, then everything rolls back. only the memory
+/// pages the extra frames wrote are copied back. the extra frames are
+/// muted and invisible to the heatmap, call profiler, trace and perf
+/// counters
+class RunAhead {
+public:
+  static constexpr int MAX_FRAMES{2};
+
+  explicit RunAhead(int frames = 1) { set_frames(frames); }
+
+  [[nodiscard]] int frames() const noexcept { return m_Frames; }
+  void set_frames(int frames) noexcept {
+    m_Frames = std::clamp(frames, 0, MAX_FRAMES);
+  }
+
+  /// one real frame plus frames() speculative ones
+  StepResult run_frame(Machine &machine) {
+    if (auto result{machine.run_frame()}; !result)
+      return result;
+
+    if (m_Frames == 0) {
+      m_Presented = machine.display().buffer();
+      return Ok();
+    }
+
+    auto &memory{machine.memory()};
+    auto &cpu{machine.cpu()};
+    auto &timers{machine.timers()};
+    auto *const heatmap{memory.heatmap()};
+    auto *const profiler{cpu.call_profiler()};
+    auto *const trace{cpu.trace()};
+    auto *const perf{machine.perf_counters()};
+    const bool muted{timers.is_muted()};
+
+    m_Snapshot = machine.snapshot();
+    const auto dirty{memory.dirty_pages()};
+    memory.clear_dirty_pages();
+    memory.set_heatmap(nullptr);
+    cpu.set_call_profiler(nullptr);
+    cpu.set_trace(nullptr);
+    machine.set_perf_counters(nullptr);
+    const auto phase{perf ? perf->switch_to(PerfPhase::Idle) : PerfPhase::Idle};
+    timers.set_muted(true);
+
+    // a fault ahead is ignored, the real frame will report it
+    for (int i{0}; i < m_Frames; ++i)
+      if (!machine.run_frame())
+        break;
+    m_Presented = machine.display().buffer();
+
+    machine.restore(m_Snapshot, memory.dirty_pages());
+    memory.clear_dirty_pages();
+    memory.mark_dirty_pages(dirty);
+    memory.set_heatmap(heatmap);
+    cpu.set_call_profiler(profiler);
+    cpu.set_trace(trace);
+    if (perf)
+      perf->switch_to(phase);
+    machine.set_perf_counters(perf);
+    timers.set_muted(muted);
+    return Ok();
+  }
+
+  /// the display to show for the last run_frame()
+  [[nodiscard]] const DisplayBuffer &presented() const noexcept {
+    return m_Presented;
+  }
+
+private:
+  int m_Frames{1};
+  MachineSnapshot m_Snapshot{};
+  DisplayBuffer m_Presented{};
+};
+
+}
@@ -0,0 +1,277 @@
+#pragma once
+#include "machine.hpp"
+#include "utils/hash.hpp"
+#include "utils/mapped_file.hpp"
+#include "utils/result.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <mutex>
+#include <span>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+namespace chip8 {
+
+// on disk layout, all integers little endian:
+//   magic "C8ST", u32 version, u32 payload size, u32 reserved,
+//   u64 rom hash, u64 xxh64 of the payload
+//   payload, fields written one by one so the format doesn't depend on
+//   struct padding. the display is packed 8 pixels per byte
+struct SaveState {
+  static constexpr char MAGIC[4]{'C', '8', 'S', 'T'};
+  static constexpr std::uint32_t VERSION{1};
+  static constexpr std::size_t HEADER_SIZE{32};
+  static constexpr std::size_t PAYLOAD_SIZE{
+      constants::NUM_REGISTERS + 2 + 2 + constants::STACK_SIZE * 2 + 3 + 4 +
+      2 + 2 + 2 + 8 + 8 + constants::MEMORY_SIZE +
+      constants::DISPLAY_PIXELS / 8};
+
+  std::uint64_t rom_hash{0};
+  MachineSnapshot snapshot{};
+
+  [[nodiscard]] static std::vector<Byte> serialize(
+      const MachineSnapshot &snapshot, std::uint64_t rom_hash) {
+    std::vector<Byte> out(HEADER_SIZE + PAYLOAD_SIZE);
+    Byte *p{out.data() + HEADER_SIZE};
+
+    const auto &cpu{snapshot.cpu};
+    for (const auto reg : cpu.registers)
+      p = put(p, reg.get());
+    p = put(p, cpu.index.get());
+    p = put(p, cpu.program_counter.get());
+    for (const auto addr : cpu.stack)
+      p = put(p, addr.get());
+    p = put(p, cpu.stack_pointer);
+    p = put(p, static_cast<Byte>(cpu.waiting_for_key));
+    p = put(p, cpu.key_register.get());
+    p = put(p, cpu.rng);
+
+    p = put(p, snapshot.timers.delay_timer);
+    p = put(p, snapshot.timers.sound_timer);
+    p = put(p, snapshot.keys);
+    p = put(p, snapshot.previous_keys);
+    p = put(p, snapshot.frames);
+    p = put(p, snapshot.cycles);
+
+    std::memcpy(p, snapshot.memory.data(), snapshot.memory.size());
+    p += snapshot.memory.size();
+    for (std::size_t i{0}; i < snapshot.display.size(); i += 8) {
+      Byte packed{0};
+      for (std::size_t bit{0}; bit < 8; ++bit)
+        packed |= static_cast<Byte>(snapshot.display[i + bit] << bit);
+      *p++ = packed;
+    }
+
+    const std::span<const Byte> payload{out.data() + HEADER_SIZE,
+                                        PAYLOAD_SIZE};
+    Byte *h{out.data()};
+    std::memcpy(h, MAGIC, sizeof(MAGIC));
+    h = put(h + sizeof(MAGIC), VERSION);
+    h = put(h, static_cast<std::uint32_t>(PAYLOAD_SIZE));
+    h = put(h, std::uint32_t{0});
+    h = put(h, rom_hash);
+    put(h, Xxh64::hash(payload));
+    return out;
+  }
+
+  [[nodiscard]] static Result<SaveState> parse(std::span<const Byte> bytes) {
+    if (bytes.size() < HEADER_SIZE ||
+        std::memcmp(bytes.data(), MAGIC, sizeof(MAGIC)) != 0)
+      return Result<SaveState>{Error::io("not a save state")};
+
+    const Byte *h{bytes.data() + sizeof(MAGIC)};
+    const auto version{get<std::uint32_t>(h)};
+    const auto payload_size{get<std::uint32_t>(h)};
+    get<std::uint32_t>(h); // reserved
+    SaveState state;
+    state.rom_hash = get<std::uint64_t>(h);
+    const auto checksum{get<std::uint64_t>(h)};
+
+    if (version != VERSION)
+      return Result<SaveState>{Error::io(
+          std::format("unsupported save state version {}", version))};
+    if (payload_size != PAYLOAD_SIZE ||
+        bytes.size() != HEADER_SIZE + PAYLOAD_SIZE)
+      return Result<SaveState>{Error::io("save state is truncated")};
+
+    const auto payload{bytes.subspan(HEADER_SIZE)};
+    if (Xxh64::hash(payload) != checksum)
+      return Result<SaveState>{Error::io("save state checksum mismatch")};
+
+    const Byte *p{payload.data()};
+    auto &snapshot{state.snapshot};
+    auto &cpu{snapshot.cpu};
+    for (auto &reg : cpu.registers)
+      reg = RegisterValue{get<Byte>(p)};
+    cpu.index = Address{get<Word>(p)};
+    cpu.program_counter = Address{get<Word>(p)};
+    for (auto &addr : cpu.stack)
+      addr = Address{get<Word>(p)};
+    cpu.stack_pointer = get<Byte>(p);
+    cpu.waiting_for_key = get<Byte>(p) != 0;
+    cpu.key_register = RegisterIndex{get<Byte>(p)};
+    cpu.rng = get<std::uint32_t>(p);
+
+    snapshot.timers.delay_timer = get<Byte>(p);
+    snapshot.timers.sound_timer = get<Byte>(p);
+    snapshot.keys = get<KeyMask>(p);
+    snapshot.previous_keys = get<KeyMask>(p);
+    snapshot.frames = get<std::uint64_t>(p);
+    snapshot.cycles = get<std::uint64_t>(p);
+
+    std::memcpy(snapshot.memory.data(), p, snapshot.memory.size());
+    p += snapshot.memory.size();
+    for (std::size_t i{0}; i < snapshot.display.size(); i += 8) {
+      const Byte packed{*p++};
+      for (std::size_t bit{0}; bit < 8; ++bit)
+        snapshot.display[i + bit] = (packed >> bit) & 1;
+    }
+
+    // reject states the cpu could not have produced
+    if (cpu.stack_pointer > constants::STACK_SIZE ||
+        cpu.program_counter.get() >= constants::MEMORY_SIZE ||
+        cpu.key_register.get() >= constants::NUM_REGISTERS)
+      return Result<SaveState>{Error::io("save state is corrupt")};
+    return Result<SaveState>{state};
+  }
+
+  /// the file is mapped, parsed in place and unmapped again
+  [[nodiscard]] static Result<SaveState> load(
+      const std::filesystem::path &path) {
+    auto file{MappedFile::open(path)};
+    if (!file)
+      return Result<SaveState>{file.error()};
+
+    auto state{parse(file->bytes())};
+    if (!state)
+      return Result<SaveState>{Error::io(std::format(
+          "{}: {}", path.string(), state.error().message()))};
+    return state;
+  }
+
+  /// written next to the target and renamed, a crash never leaves a
+  /// half written state behind
+  static Result<void> write(const std::filesystem::path &path,
+                            std::span<const Byte> bytes) {
+    std::error_code ec;
+    if (path.has_parent_path())
+      std::filesystem::create_directories(path.parent_path(), ec);
+
+    auto tmp{path};
+    tmp += ".tmp";
+    {
+      std::ofstream file(tmp, std::ios::binary | std::ios::trunc);
+      if (!file)
+        return Error::io(std::format("Failed to open file: {}", tmp.string()));
+      file.write(reinterpret_cast<const char *>(bytes.data()),
+                 static_cast<std::streamsize>(bytes.size()));
+      if (!file)
+        return Error::io(std::format("Failed to write {}", tmp.string()));
+    }
+
+    std::filesystem::rename(tmp, path, ec);
+    if (ec)
+      return Error::io(std::format("Failed to rename {}: {}", tmp.string(),
+                                   ec.message()));
+    return Ok();
+  }
+
+private:
+  template <typename T>
+  static Byte *put(Byte *p, T value) noexcept {
+    for (std::size_t i{0}; i < sizeof(T); ++i)
+      *p++ = static_cast<Byte>(value >> (8 * i));
+    return p;
+  }
+
+  template <typename T>
+  static T get(const Byte *&p) noexcept {
+    T value{0};
+    for (std::size_t i{0}; i < sizeof(T); ++i)
+      value |= static_cast<T>(static_cast<T>(*p++) << (8 * i));
+    return value;
+  }
+};
+
+/// writes save states on a background thread. the caller only pays for
+/// serializing the snapshot, about 4.4 KB, the file I/O happens later
+class SaveStateWriter {
+public:
+  SaveStateWriter()
+    : m_Worker{[this](std::stop_token stop) { worker_loop(stop); }} {
+  }
+
+  ~SaveStateWriter() { m_Worker.request_stop(); }
+
+  SaveStateWriter(const SaveStateWriter &) = delete;
+  SaveStateWriter &operator=(const SaveStateWriter &) = delete;
+
+  void submit(std::filesystem::path path, const MachineSnapshot &snapshot,
+              std::uint64_t rom_hash) {
+    auto bytes{SaveState::serialize(snapshot, rom_hash)};
+    {
+      const std::lock_guard lock{m_Mutex};
+      m_Jobs.push_back(Job{std::move(path), std::move(bytes)});
+      ++m_Submitted;
+    }
+    m_Wake.notify_one();
+  }
+
+  /// blocks until everything submitted so far is on disk
+  void wait_idle() {
+    std::unique_lock lock{m_Mutex};
+    m_Done.wait(lock, [this] { return m_Completed == m_Submitted; });
+  }
+
+  [[nodiscard]] std::uint64_t failures() const noexcept {
+    return m_Failures.load(std::memory_order_relaxed);
+  }
+
+private:
+  struct Job {
+    std::filesystem::path path;
+    std::vector<Byte> bytes;
+  };
+
+  void worker_loop(std::stop_token stop) {
+    std::unique_lock lock{m_Mutex};
+    for (;;) {
+      // pending saves are still written on shutdown
+      m_Wake.wait(lock, stop, [this] { return !m_Jobs.empty(); });
+      if (m_Jobs.empty())
+        return;
+
+      auto job{std::move(m_Jobs.front())};
+      m_Jobs.pop_front();
+      lock.unlock();
+
+      if (auto result{SaveState::write(job.path, job.bytes)}; !result) {
+        m_Failures.fetch_add(1, std::memory_order_relaxed);
+        LOG_ERROR("Save state failed: {}", result.error().message());
+      }
+
+      lock.lock();
+      ++m_Completed;
+      m_Done.notify_all();
+    }
+  }
+
+  std::mutex m_Mutex;
+  std::condition_variable_any m_Wake;
+  std::condition_variable m_Done;
+  std::deque<Job> m_Jobs;
+  std::uint64_t m_Submitted{0};
+  std::uint64_t m_Completed{0};
+  std::atomic<std::uint64_t> m_Failures{0};
+  std::jthread m_Worker; // last, joined before the members above go away
+};
+
+}
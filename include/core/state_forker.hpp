@@ -0,0 +1,137 @@
+#pragma once
+#include "machine.hpp"
+#include "state_hash.hpp"
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <span>
+
+namespace chip8 {
+
+/// one successor of a forked state, the parent advanced one frame with a
+/// single key held. memory is stored as the pages that frame wrote, the
+/// rest is shared with the parent
+struct ForkChild {
+  KeyMask keys{0};
+  std::uint64_t hash{0};
+  std::uint8_t duplicate_of{0}; // own index unless an earlier child matches
+  bool faulted{false};
+
+  Memory::PageMask pages{0};
+  std::uint16_t first_page{0}; // into the forker's page arena
+  CpuState cpu{};
+  TimerState timers{};
+  DisplayBuffer display{};
+  std::uint64_t cycles{0};
+
+  [[nodiscard]] bool is_duplicate(std::size_t self) const noexcept {
+    return duplicate_of != self;
+  }
+};
+
+/// expands a state into its 16 single key successors for tree search.
+/// everything is preallocated, expand() never touches the heap. children
+/// are valid until the next expand()
+class StateForker {
+public:
+  static constexpr std::size_t MAX_CHILDREN{constants::NUM_KEYS};
+
+  explicit StateForker(const CpuConfig &config = {}, bool clip_sprites = false)
+    : m_Machine{config, clip_sprites},
+      m_Arena{std::make_unique<PageArena>()} {
+  }
+
+  StateForker(const StateForker &) = delete;
+  StateForker &operator=(const StateForker &) = delete;
+
+  std::span<const ForkChild> expand(const MachineSnapshot &parent) {
+    m_Machine.restore(parent);
+    m_Parent_hasher.invalidate();
+    m_Parent_hash = m_Parent_hasher.hash(m_Machine, Memory::ALL_PAGES);
+    m_Machine.memory().clear_dirty_pages();
+
+    std::uint16_t used_pages{0};
+    for (std::size_t k{0}; k < MAX_CHILDREN; ++k) {
+      auto &child{m_Children[k]};
+      child.keys = static_cast<KeyMask>(1u << k);
+      m_Machine.set_keys(child.keys);
+      child.faulted = !m_Machine.run_frame();
+
+      // only the pages this frame wrote need rehashing
+      const auto dirty{m_Machine.memory().dirty_pages()};
+      StateHasher hasher{m_Parent_hasher};
+      child.hash = hasher.hash(m_Machine, dirty);
+      child.duplicate_of = static_cast<std::uint8_t>(k);
+      for (std::size_t j{0}; j < k; ++j)
+        if (m_Children[j].hash == child.hash) {
+          child.duplicate_of = static_cast<std::uint8_t>(j);
+          break;
+        }
+
+      if (!child.is_duplicate(k)) {
+        child.pages = dirty;
+        child.first_page = used_pages;
+        for (auto pages{dirty}; pages != 0;
+             pages &= static_cast<Memory::PageMask>(pages - 1)) {
+          const auto page{m_Machine.memory().page(
+              static_cast<std::size_t>(std::countr_zero(pages)))};
+          std::ranges::copy(page, (*m_Arena)[used_pages++].begin());
+        }
+        child.cpu = m_Machine.cpu().state();
+        child.timers = m_Machine.timers().state();
+        child.display = m_Machine.display().buffer();
+        child.cycles = m_Machine.cycle_count();
+      }
+
+      // back to the parent for the next key, untouched pages stay put
+      m_Machine.restore(parent, dirty);
+      m_Machine.memory().clear_dirty_pages();
+    }
+    return m_Children;
+  }
+
+  [[nodiscard]] std::uint64_t parent_hash() const noexcept {
+    return m_Parent_hash;
+  }
+
+  [[nodiscard]] std::size_t unique_children() const noexcept {
+    std::size_t count{0};
+    for (std::size_t k{0}; k < MAX_CHILDREN; ++k)
+      count += !m_Children[k].is_duplicate(k);
+    return count;
+  }
+
+  /// turns the parent passed to the last expand() into child i, in place.
+  /// only the pages the child wrote are copied
+  void apply(std::size_t i, MachineSnapshot &state) const {
+    const auto &child{m_Children[m_Children[i].duplicate_of]};
+    std::uint16_t slot{child.first_page};
+    for (auto pages{child.pages}; pages != 0;
+         pages &= static_cast<Memory::PageMask>(pages - 1)) {
+      const auto offset{static_cast<std::size_t>(std::countr_zero(pages)) *
+                        Memory::PAGE_SIZE};
+      std::ranges::copy((*m_Arena)[slot++], state.memory.begin() + offset);
+    }
+    state.cpu = child.cpu;
+    state.timers = child.timers;
+    state.display = child.display;
+    state.keys = m_Children[i].keys;
+    state.previous_keys = m_Children[i].keys;
+    state.frames += 1;
+    state.cycles = child.cycles;
+  }
+
+private:
+  // worst case every child writes every page
+  using PageArena = std::array<std::array<Byte, Memory::PAGE_SIZE>,
+                               MAX_CHILDREN * Memory::PAGE_COUNT>;
+
+  Machine m_Machine;
+  StateHasher m_Parent_hasher;
+  std::uint64_t m_Parent_hash{0};
+  std::array<ForkChild, MAX_CHILDREN> m_Children{};
+  std::unique_ptr<PageArena> m_Arena;
+};
+
+}
@@ -0,0 +1,84 @@
+#pragma once
+#include "machine.hpp"
+#include "utils/hash.hpp"
+
+#include <array>
+#include <cstdint>
+#include <span>
+
+namespace chip8 {
+
+/// 64 bit hash of everything that decides how a machine continues: cpu
+/// registers, I, PC, stack, rng, timers, memory and display. frame and
+/// cycle counters are left out so a machine that loops hashes the same
+/// every time around. last frame's keys only count while the cpu sits in
+/// FX0A, anywhere else they would split states that only differ in input.
+/// memory is hashed per page and only pages passed as dirty are rehashed,
+/// the rest come from cache
+class StateHasher {
+public:
+  /// dirty = pages changed since the previous call, ignored on the first
+  /// call after construction or invalidate()
+  std::uint64_t hash(const Machine &machine, Memory::PageMask dirty) {
+    const auto &memory{machine.memory()};
+    if (!m_Valid)
+      dirty = Memory::ALL_PAGES;
+    for (; dirty != 0; dirty &= static_cast<Memory::PageMask>(dirty - 1)) {
+      const auto page{static_cast<std::size_t>(std::countr_zero(dirty))};
+      m_Words[page] = Xxh64::hash(memory.page(page));
+    }
+    m_Valid = true;
+
+    const auto &display{machine.display().buffer()};
+    m_Words[DISPLAY_WORD] = Xxh64::hash(std::span<const Byte>{
+        reinterpret_cast<const Byte *>(display.data()), display.size()});
+    m_Words[CORE_WORD] = core_hash(machine);
+
+    return Xxh64::hash(std::span<const Byte>{
+        reinterpret_cast<const Byte *>(m_Words.data()),
+        m_Words.size() * sizeof(std::uint64_t)});
+  }
+
+  /// forget the cached page hashes, the next call hashes everything
+  void invalidate() noexcept { m_Valid = false; }
+
+private:
+  static constexpr std::size_t DISPLAY_WORD{Memory::PAGE_COUNT};
+  static constexpr std::size_t CORE_WORD{Memory::PAGE_COUNT + 1};
+
+  // fields one by one, CpuState has padding
+  static std::uint64_t core_hash(const Machine &machine) noexcept {
+    const auto &cpu{machine.cpu().state()};
+    const auto &timers{machine.timers().state()};
+
+    std::array<Byte, constants::NUM_REGISTERS + constants::STACK_SIZE * 2 +
+                     16> bytes{};
+    auto *p{bytes.data()};
+    for (const auto reg : cpu.registers)
+      *p++ = reg.get();
+    for (const auto addr : cpu.stack) {
+      *p++ = static_cast<Byte>(addr.get());
+      *p++ = static_cast<Byte>(addr.get() >> 8);
+    }
+    const auto put16{[&p](std::uint16_t v) {
+      *p++ = static_cast<Byte>(v);
+      *p++ = static_cast<Byte>(v >> 8);
+    }};
+    put16(cpu.index.get());
+    put16(cpu.program_counter.get());
+    *p++ = cpu.stack_pointer;
+    *p++ = static_cast<Byte>(cpu.waiting_for_key);
+    *p++ = cpu.key_register.get();
+    put16(static_cast<std::uint16_t>(cpu.rng));
+    put16(static_cast<std::uint16_t>(cpu.rng >> 16));
+    *p++ = timers.delay_timer;
+    *p++ = timers.sound_timer;
+    put16(cpu.waiting_for_key ? machine.previous_keys() : KeyMask{0});
+    return Xxh64::hash(bytes);
+  }
+
+  std::array<std::uint64_t, Memory::PAGE_COUNT + 2> m_Words{};
+  bool m_Valid{false};
+};
+
+}
@@ -32,6 +32,11 @@ public:
   [[nodiscard]] Byte sound() const noexcept { return m_State.sound_timer; }
   [[nodiscard]] const TimerState &state() const noexcept { return m_State; }
 
+  void set_state(const TimerState &state) noexcept {
+    set_delay(state.delay_timer);
+    set_sound(state.sound_timer);
+  }
+
 
   void set_delay(Byte value) noexcept { m_State.delay_timer = value; }
 
@@ -40,7 +45,7 @@ public:
     m_State.sound_timer = value;
     const bool is_active{m_State.is_sound_active()};
 
-    if (was_active != is_active && m_Sound_callback)
+    if (was_active != is_active && m_Sound_callback && !m_Muted)
       m_Sound_callback(is_active);
   }
 
@@ -71,13 +76,17 @@ public:
     m_Sound_callback = std::move(callback);
   }
 
+  /// while muted the timers run but the sound callback isn't called
+  void set_muted(bool muted) noexcept { m_Muted = muted; }
+  [[nodiscard]] bool is_muted() const noexcept { return m_Muted; }
+
   void reset() noexcept {
     const bool was_active{m_State.is_sound_active()};
     m_State.delay_timer = 0;
     m_State.sound_timer = 0;
     m_Last_tick = Clock::now();
 
-    if (was_active && m_Sound_callback)
+    if (was_active && m_Sound_callback && !m_Muted)
       m_Sound_callback(false);
   }
 
@@ -108,13 +117,14 @@ private:
 
     const bool is_sound_active{m_State.is_sound_active()};
 
-    if (was_sound_active != is_sound_active && m_Sound_callback)
+    if (was_sound_active != is_sound_active && m_Sound_callback && !m_Muted)
       m_Sound_callback(is_sound_active);
   }
 
   TimerState m_State;
   TimePoint m_Last_tick;
   SoundCallback m_Sound_callback;
+  bool m_Muted{false};
 };
 
 
@@ -1,5 +1,6 @@
 #pragma once
 #include "core/types.hpp"
+#include "profiling/zones.hpp"
 
 #include <algorithm>
 #include <functional>
@@ -40,27 +41,28 @@ public:
     return was_on && value;
   }
 
+  /// the start position always wraps, pixels past the edge wrap around
+  /// too unless clipping is on
   bool draw_sprite(Byte start_x, Byte start_y,
                    MemoryView sprite_data) noexcept {
+    CHIP8_ZONE("Display::draw_sprite");
     bool collision{false};
 
     const std::size_t wrapped_x{start_x % constants::DISPLAY_WIDTH};
     const std::size_t wrapped_y{start_y % constants::DISPLAY_HEIGHT};
 
     for (std::size_t row{0}; row < sprite_data.size(); ++row) {
+      // clipping is the newer behaviour, older roms expect wrapping
+      if (m_Clip_sprites && wrapped_y + row >= constants::DISPLAY_HEIGHT)
+        break;
       const std::size_t y{(wrapped_y + row) % constants::DISPLAY_HEIGHT};
-      // below code is used for clipping, which is newer chip8 implementation,
-      // older roms fail here, so ill remove clipping and go the wrapping route
-      // if (y >= constants::DISPLAY_HEIGHT)
-      // break;
 
       const Byte sprite_row{sprite_data[row]};
       for (std::size_t col{0}; col < 8; ++col) {
+        if (m_Clip_sprites && wrapped_x + col >= constants::DISPLAY_WIDTH)
+          break;
         const std::size_t x{(wrapped_x + col) % constants::DISPLAY_WIDTH};
 
-        // if (x >= constants::DISPLAY_WIDTH)
-        // break;
-
         const bool sprite_pixel{(sprite_row & (0x80 >> col)) != 0};
         if (sprite_pixel && xor_pixel(x, y, true))
           collision = true;
@@ -69,6 +71,9 @@ public:
     return collision;
   }
 
+  void set_clip_sprites(bool clip) noexcept { m_Clip_sprites = clip; }
+  [[nodiscard]] bool clip_sprites() const noexcept { return m_Clip_sprites; }
+
 
   /// clear the display
   void clear() noexcept {
@@ -82,6 +87,11 @@ public:
     return m_Buffer;
   }
 
+  void set_buffer(const DisplayBuffer &buffer) noexcept {
+    m_Buffer = buffer;
+    m_Dirty = true;
+  }
+
   [[nodiscard]] bool is_dirty() const noexcept { return m_Dirty; }
 
   void clear_dirty() noexcept { m_Dirty = false; }
@@ -121,6 +131,7 @@ public:
 private:
   DisplayBuffer m_Buffer{};
   bool m_Dirty{true};
+  bool m_Clip_sprites{false};
   UpdateCallback m_Update_callback;
 };
 
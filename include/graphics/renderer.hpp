@@ -1,5 +1,6 @@
 #pragma once
 #include "i_renderer.hpp"
+#include "profiling/zones.hpp"
 #include <raylib.h>
 
 #include <algorithm>
@@ -64,6 +65,7 @@ public:
   }
 
   void render(const DisplayBuffer &buffer) override {
+    CHIP8_ZONE("RaylibRenderer::render");
     BeginTextureMode(m_Render_texture);
     ClearBackground(BLACK); // TODO: theming here too
 
@@ -0,0 +1,116 @@
+#pragma once
+#include "core/machine.hpp"
+#include "utils/mapped_file.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <format>
+#include <string_view>
+#include <vector>
+
+namespace chip8 {
+
+struct InputEvent {
+  std::uint64_t frame;
+  KeyMask keys; // held from this frame until the next event
+};
+
+/// key input by frame number, for headless runs
+class InputScript {
+public:
+  InputScript() = default;
+
+  explicit InputScript(std::vector<InputEvent> events)
+    : m_Events{std::move(events)} {
+    std::ranges::stable_sort(m_Events, {}, &InputEvent::frame);
+  }
+
+  void add(std::uint64_t frame, KeyMask keys) {
+    const auto it{std::ranges::upper_bound(m_Events, frame, {},
+                                           &InputEvent::frame)};
+    m_Events.insert(it, InputEvent{frame, keys});
+  }
+
+  [[nodiscard]] KeyMask keys_at(std::uint64_t frame) const noexcept {
+    const auto it{std::ranges::upper_bound(m_Events, frame, {},
+                                           &InputEvent::frame)};
+    return it == m_Events.begin() ? KeyMask{0} : std::prev(it)->keys;
+  }
+
+  [[nodiscard]] const std::vector<InputEvent> &events() const noexcept {
+    return m_Events;
+  }
+
+  [[nodiscard]] bool empty() const noexcept { return m_Events.empty(); }
+
+  /// recorded input, one "<frame> <key mask in hex>" event per line, '#'
+  /// starts a comment
+  [[nodiscard]] static Result<InputScript> parse(std::string_view text) {
+    using R = Result<InputScript>;
+    std::vector<InputEvent> events;
+    std::size_t line_number{0};
+    while (!text.empty()) {
+      const auto end{text.find('\n')};
+      std::string_view line{text.substr(0, end)};
+      text.remove_prefix(end == std::string_view::npos ? text.size()
+                                                       : end + 1);
+      ++line_number;
+
+      line = line.substr(0, line.find('#'));
+      const auto first{line.find_first_not_of(" \t\r")};
+      if (first == std::string_view::npos)
+        continue;
+      line.remove_prefix(first);
+
+      InputEvent event{};
+      const char *const last{line.data() + line.size()};
+      const auto skip_blanks{[last](const char *p) {
+        while (p != last && (*p == ' ' || *p == '\t' || *p == '\r'))
+          ++p;
+        return p;
+      }};
+      auto parsed{std::from_chars(line.data(), last, event.frame)};
+      if (parsed.ec == std::errc{})
+        parsed = std::from_chars(skip_blanks(parsed.ptr), last, event.keys,
+                                 16);
+      if (parsed.ec != std::errc{} || skip_blanks(parsed.ptr) != last)
+        return R{Error::input(std::format(
+            "input script line {}: expected <frame> <key mask>",
+            line_number))};
+      events.push_back(event);
+    }
+    return R{InputScript{std::move(events)}};
+  }
+
+  [[nodiscard]] static Result<InputScript> load(
+      const std::filesystem::path &path) {
+    auto file{MappedFile::open(path)};
+    if (!file)
+      return Result<InputScript>{file.error()};
+    const auto bytes{file->bytes()};
+    return parse(std::string_view{
+        reinterpret_cast<const char *>(bytes.data()), bytes.size()});
+  }
+
+  /// taps every key in turn, hold frames down then gap frames up, starting
+  /// after gap frames. enough to get most roms past their title screen
+  [[nodiscard]] static InputScript key_sweep(std::uint64_t total_frames,
+                                             std::uint64_t hold = 6,
+                                             std::uint64_t gap = 24) {
+    InputScript script;
+    std::uint8_t key{0};
+    for (std::uint64_t frame{gap}; frame < total_frames;
+         frame += hold + gap) {
+      script.m_Events.push_back({frame, static_cast<KeyMask>(1u << key)});
+      script.m_Events.push_back({frame + hold, 0});
+      key = static_cast<std::uint8_t>((key + 1) % constants::NUM_KEYS);
+    }
+    return script;
+  }
+
+private:
+  std::vector<InputEvent> m_Events;
+};
+
+}
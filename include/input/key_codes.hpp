@@ -23,8 +23,10 @@ enum class Key: int {
   ESCAPE = 17,
   F5 = 18,
   F11 = 19,
+  F6 = 20,
+  F9 = 21,
 
-  KEY_COUNT = 20 // TODO: update the value as we add more keybinding later on
+  KEY_COUNT = 22 // TODO: update the value as we add more keybinding later on
 };
 
 class IKeyStateProvider {
@@ -129,6 +129,14 @@ public:
     return m_Provider->is_key_pressed(Key::ESCAPE);
   }
 
+  bool is_save_state_pressed() {
+    return m_Provider->is_key_pressed(Key::F6);
+  }
+
+  bool is_load_state_pressed() {
+    return m_Provider->is_key_pressed(Key::F9);
+  }
+
 private:
   std::shared_ptr<IKeyStateProvider> m_Provider;
   std::array<KeyMapping, 16> m_Mappings{DEFAULT_KEY_MAP};
@@ -61,6 +61,10 @@ private:
       return KEY_F5;
     case Key::F11:
       return KEY_F11;
+    case Key::F6:
+      return KEY_F6;
+    case Key::F9:
+      return KEY_F9;
     default:
       return KEY_NULL;
     }
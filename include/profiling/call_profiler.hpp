@@ -0,0 +1,185 @@
+#pragma once
+#include "core/types.hpp"
+#include "utils/result.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace chip8 {
+
+/// shadows the CALL/RET stack as a call tree and charges every executed
+/// instruction to the subroutine it ran in. nodes are only allocated the
+/// first time a call path is seen, steady state profiling does not allocate
+class CallProfiler {
+public:
+  using NodeId = std::uint32_t;
+
+  static constexpr NodeId ROOT{0};
+  static constexpr NodeId NONE{~NodeId{0}};
+
+  struct Node {
+    Address entry{0};
+    NodeId parent{NONE};
+    NodeId first_child{NONE};
+    NodeId next_sibling{NONE};
+    std::uint64_t calls{0};
+    std::uint64_t exclusive_cycles{0};
+  };
+
+  struct SubroutineStats {
+    Address entry{0};
+    std::uint64_t calls{0};
+    std::uint64_t inclusive_cycles{0};
+    std::uint64_t exclusive_cycles{0};
+  };
+
+  CallProfiler() { reset(); }
+
+  /// charge one emulated cycle to the current subroutine
+  void on_step() noexcept { ++m_Nodes[m_Current].exclusive_cycles; }
+
+  void on_call(Address target) {
+    NodeId child{m_Nodes[m_Current].first_child};
+    while (child != NONE && m_Nodes[child].entry != target)
+      child = m_Nodes[child].next_sibling;
+
+    if (child == NONE) {
+      child = static_cast<NodeId>(m_Nodes.size());
+      m_Nodes.push_back(Node{
+          .entry = target,
+          .parent = m_Current,
+          .first_child = NONE,
+          .next_sibling = m_Nodes[m_Current].first_child});
+      m_Nodes[m_Current].first_child = child;
+    }
+
+    ++m_Nodes[child].calls;
+    m_Current = child;
+  }
+
+  void on_return() noexcept {
+    // RET without a matching CALL (profiler attached mid run) stays at root
+    if (m_Current != ROOT)
+      m_Current = m_Nodes[m_Current].parent;
+  }
+
+  /// drop the shadow stack, keep the accumulated counts
+  void reset_stack() noexcept { m_Current = ROOT; }
+
+  void reset() {
+    m_Nodes.clear();
+    m_Nodes.reserve(INITIAL_NODES);
+    m_Nodes.push_back(Node{});
+    m_Current = ROOT;
+  }
+
+  [[nodiscard]] const std::vector<Node> &nodes() const noexcept {
+    return m_Nodes;
+  }
+
+  [[nodiscard]] NodeId current() const noexcept { return m_Current; }
+
+  [[nodiscard]] std::size_t depth() const noexcept {
+    std::size_t depth{0};
+    for (NodeId id{m_Current}; id != ROOT; id = m_Nodes[id].parent)
+      ++depth;
+    return depth;
+  }
+
+  [[nodiscard]] std::uint64_t total_cycles() const noexcept {
+    std::uint64_t total{0};
+    for (const auto &node : m_Nodes)
+      total += node.exclusive_cycles;
+    return total;
+  }
+
+  /// per entry address totals, sorted by inclusive cycles descending.
+  /// recursive frames only count once towards inclusive time
+  [[nodiscard]] std::vector<SubroutineStats> subroutines() const {
+    // children are always created after their parent, so walking backwards
+    // folds every subtree into its parent in one pass
+    std::vector<std::uint64_t> inclusive(m_Nodes.size());
+    for (std::size_t i{m_Nodes.size()}; i-- > 0;) {
+      inclusive[i] += m_Nodes[i].exclusive_cycles;
+      if (i != ROOT)
+        inclusive[m_Nodes[i].parent] += inclusive[i];
+    }
+
+    std::vector<SubroutineStats> result;
+    const auto stats_for{[&](Address entry) -> SubroutineStats & {
+      auto it{std::ranges::find(result, entry, &SubroutineStats::entry)};
+      if (it != result.end())
+        return *it;
+      return result.emplace_back(SubroutineStats{.entry = entry});
+    }};
+
+    for (std::size_t i{1}; i < m_Nodes.size(); ++i) {
+      const auto &node{m_Nodes[i]};
+      auto &stats{stats_for(node.entry)};
+      stats.calls += node.calls;
+      stats.exclusive_cycles += node.exclusive_cycles;
+      if (!has_ancestor(static_cast<NodeId>(i), node.entry))
+        stats.inclusive_cycles += inclusive[i];
+    }
+
+    std::ranges::sort(result, [](const auto &a, const auto &b) {
+      return a.inclusive_cycles > b.inclusive_cycles;
+    });
+    return result;
+  }
+
+  /// flamegraph.pl / speedscope collapsed stack format, one line per path:
+  /// main;sub_2A0;sub_31C 1234
+  [[nodiscard]] std::string collapsed_stacks() const {
+    std::string out;
+    std::vector<NodeId> path;
+    for (NodeId i{0}; i < m_Nodes.size(); ++i) {
+      if (m_Nodes[i].exclusive_cycles == 0)
+        continue;
+
+      path.clear();
+      for (NodeId id{i}; id != ROOT; id = m_Nodes[id].parent)
+        path.push_back(id);
+
+      out += "main";
+      for (auto it{path.rbegin()}; it != path.rend(); ++it)
+        std::format_to(std::back_inserter(out), ";sub_{:03X}",
+                       m_Nodes[*it].entry.get());
+      std::format_to(std::back_inserter(out), " {}\n",
+                     m_Nodes[i].exclusive_cycles);
+    }
+    return out;
+  }
+
+  Result<void> export_collapsed(const std::filesystem::path &path) const {
+    std::ofstream file(path, std::ios::binary);
+    if (!file)
+      return Error::io(std::format("Failed to open file: {}", path.string()));
+
+    const auto stacks{collapsed_stacks()};
+    file.write(stacks.data(), static_cast<std::streamsize>(stacks.size()));
+    if (!file)
+      return Error::io("Failed to write collapsed stacks");
+    return Ok();
+  }
+
+private:
+  static constexpr std::size_t INITIAL_NODES{256};
+
+  [[nodiscard]] bool has_ancestor(NodeId id, Address entry) const noexcept {
+    for (NodeId p{m_Nodes[id].parent}; p != ROOT; p = m_Nodes[p].parent)
+      if (m_Nodes[p].entry == entry)
+        return true;
+    return false;
+  }
+
+  std::vector<Node> m_Nodes;
+  NodeId m_Current{ROOT};
+};
+
+}
@@ -0,0 +1,165 @@
+#pragma once
+#include "core/types.hpp"
+#include "utils/result.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <string>
+
+namespace chip8 {
+
+enum class AccessKind {
+  Fetch, Read, Write
+};
+
+[[nodiscard]] constexpr std::string_view access_kind_string(
+    AccessKind kind) noexcept {
+  switch (kind) {
+  case AccessKind::Fetch:
+    return "fetch";
+  case AccessKind::Read:
+    return "read";
+  case AccessKind::Write:
+    return "write";
+  }
+  return "unknown";
+}
+
+/// per address access counters over the whole 4KB address space
+/// recording is a bounds masked increment, nothing allocates after construction
+class AccessHeatmap {
+public:
+  using Counters = std::array<std::uint64_t, constants::MEMORY_SIZE>;
+
+  static constexpr std::size_t IMAGE_SIZE{64}; // 64x64 == 4096 addresses
+
+  void record_fetch(Address addr) noexcept { ++m_Fetches[slot(addr)]; }
+  void record_read(Address addr) noexcept { ++m_Reads[slot(addr)]; }
+  void record_write(Address addr) noexcept { ++m_Writes[slot(addr)]; }
+
+  void record_read_range(Address addr, std::size_t length) noexcept {
+    for (std::size_t i{0}; i < length; ++i)
+      ++m_Reads[slot(Address{static_cast<Word>(addr.get() + i)})];
+  }
+
+  void record_write_range(Address addr, std::size_t length) noexcept {
+    for (std::size_t i{0}; i < length; ++i)
+      ++m_Writes[slot(Address{static_cast<Word>(addr.get() + i)})];
+  }
+
+  [[nodiscard]] const Counters &counters(AccessKind kind) const noexcept {
+    switch (kind) {
+    case AccessKind::Fetch:
+      return m_Fetches;
+    case AccessKind::Read:
+      return m_Reads;
+    case AccessKind::Write:
+      break;
+    }
+    return m_Writes;
+  }
+
+  [[nodiscard]] std::uint64_t count(AccessKind kind,
+                                    Address addr) const noexcept {
+    return counters(kind)[slot(addr)];
+  }
+
+  [[nodiscard]] std::uint64_t total(AccessKind kind) const noexcept {
+    std::uint64_t sum{0};
+    for (const auto value : counters(kind))
+      sum += value;
+    return sum;
+  }
+
+  /// address that was both written and executed, i.e. self modifying code
+  [[nodiscard]] bool is_self_modified(Address addr) const noexcept {
+    return m_Writes[slot(addr)] > 0 && m_Fetches[slot(addr)] > 0;
+  }
+
+  [[nodiscard]] std::size_t self_modified_count() const noexcept {
+    std::size_t count{0};
+    for (std::size_t i{0}; i < constants::MEMORY_SIZE; ++i)
+      if (m_Writes[i] > 0 && m_Fetches[i] > 0)
+        ++count;
+    return count;
+  }
+
+  void reset() noexcept {
+    m_Fetches.fill(0);
+    m_Reads.fill(0);
+    m_Writes.fill(0);
+  }
+
+  /// one row per address: address,fetches,reads,writes
+  [[nodiscard]] std::string to_csv() const {
+    std::string csv{"address,fetches,reads,writes\n"};
+    csv.reserve(constants::MEMORY_SIZE * 32);
+    for (std::size_t i{0}; i < constants::MEMORY_SIZE; ++i)
+      std::format_to(std::back_inserter(csv), "0x{:03X},{},{},{}\n", i,
+                     m_Fetches[i], m_Reads[i], m_Writes[i]);
+    return csv;
+  }
+
+  Result<void> export_csv(const std::filesystem::path &path) const {
+    std::ofstream file(path, std::ios::binary);
+    if (!file)
+      return Error::io(std::format("Failed to open file: {}", path.string()));
+
+    const auto csv{to_csv()};
+    file.write(csv.data(), static_cast<std::streamsize>(csv.size()));
+    if (!file)
+      return Error::io("Failed to write heatmap CSV");
+    return Ok();
+  }
+
+  /// 64x64 binary PPM, one pixel per address, row major from $000.
+  /// intensity is log scaled so cold code still shows next to hot loops
+  Result<void> export_image(const std::filesystem::path &path,
+                            AccessKind kind) const {
+    std::ofstream file(path, std::ios::binary);
+    if (!file)
+      return Error::io(std::format("Failed to open file: {}", path.string()));
+
+    const auto &data{counters(kind)};
+    const auto peak{*std::ranges::max_element(data)};
+    const double log_peak{std::log1p(static_cast<double>(peak))};
+
+    file << std::format("P6\n{} {}\n255\n", IMAGE_SIZE, IMAGE_SIZE);
+    for (const auto value : data) {
+      const double t{log_peak > 0.0
+                       ? std::log1p(static_cast<double>(value)) / log_peak
+                       : 0.0};
+      const auto rgb{heat_color(t)};
+      file.write(reinterpret_cast<const char *>(rgb.data()), rgb.size());
+    }
+
+    if (!file)
+      return Error::io("Failed to write heatmap image");
+    return Ok();
+  }
+
+private:
+  static constexpr std::size_t slot(Address addr) noexcept {
+    return addr.get() & (constants::MEMORY_SIZE - 1);
+  }
+
+  /// black -> red -> yellow -> white
+  static std::array<Byte, 3> heat_color(double t) noexcept {
+    const double scaled{std::clamp(t, 0.0, 1.0) * 3.0};
+    const auto channel{[](double v) {
+      return static_cast<Byte>(std::clamp(v, 0.0, 1.0) * 255.0);
+    }};
+    return {channel(scaled), channel(scaled - 1.0), channel(scaled - 2.0)};
+  }
+
+  Counters m_Fetches{};
+  Counters m_Reads{};
+  Counters m_Writes{};
+};
+
+}
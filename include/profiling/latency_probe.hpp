@@ -0,0 +1,111 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+namespace chip8 {
+
+/// where a key press is on its way to the screen, in the order it gets there
+enum class LatencyStage : std::uint8_t {
+  KeyboardUpdate, // Keyboard::update saw the press
+  CpuExecute, // first frame executed with the key held
+  DisplayChange, // first presented frame that differs from the last one
+  Render, // IRenderer::render returned
+  EndDrawing, // IRenderer::end_frame returned, buffers swapped
+  Count
+};
+
+inline constexpr std::size_t LATENCY_STAGE_COUNT{
+    static_cast<std::size_t>(LatencyStage::Count)};
+
+inline constexpr std::array<std::string_view, LATENCY_STAGE_COUNT>
+    LATENCY_STAGE_NAMES{"keyboard", "cpu", "display", "render", "end_drawing"};
+
+/// follows one input event at a time from the moment the key provider
+/// delivers it to the end of the frame that shows its effect. the driver
+/// calls begin(), the emulator marks the stages. a stage only counts once
+/// the one before it is stamped, the event is complete at EndDrawing
+class LatencyProbe {
+public:
+  using Clock = std::chrono::steady_clock;
+  using Duration = std::chrono::duration<double, std::milli>;
+
+  /// stages since the input, complete events only
+  using Sample = std::array<Clock::duration, LATENCY_STAGE_COUNT>;
+
+  explicit LatencyProbe(std::size_t expected_events = 1024) {
+    m_Samples.reserve(expected_events);
+  }
+
+  /// the key went down at input. an event still open is dropped
+  void begin(Clock::time_point input = Clock::now()) noexcept {
+    if (m_Input)
+      ++m_Dropped;
+    m_Input = input;
+    m_Next = 0;
+  }
+
+  /// gives up on the open event, e.g. a press the rom ignored
+  void abandon() noexcept {
+    if (m_Input)
+      ++m_Dropped;
+    m_Input.reset();
+  }
+
+  void mark(LatencyStage stage, Clock::time_point now = Clock::now()) {
+    const auto index{static_cast<std::size_t>(stage)};
+    if (!m_Input || index != m_Next)
+      return;
+    m_Current[index] = now - *m_Input;
+    if (++m_Next == LATENCY_STAGE_COUNT) {
+      m_Samples.push_back(m_Current);
+      m_Input.reset();
+    }
+  }
+
+  [[nodiscard]] bool pending() const noexcept { return m_Input.has_value(); }
+  [[nodiscard]] std::size_t samples() const noexcept {
+    return m_Samples.size();
+  }
+  [[nodiscard]] std::size_t dropped() const noexcept { return m_Dropped; }
+  [[nodiscard]] const std::vector<Sample> &raw() const noexcept {
+    return m_Samples;
+  }
+
+  /// nearest rank percentile of input to stage, p in [0, 100]
+  [[nodiscard]] Duration percentile(LatencyStage stage, double p) const {
+    if (m_Samples.empty())
+      return Duration{0.0};
+    std::vector<Clock::duration> values;
+    values.reserve(m_Samples.size());
+    for (const auto &sample : m_Samples)
+      values.push_back(sample[static_cast<std::size_t>(stage)]);
+    std::ranges::sort(values);
+
+    const auto rank{static_cast<std::size_t>(std::ceil(
+        std::clamp(p, 0.0, 100.0) / 100.0 *
+        static_cast<double>(values.size())))};
+    return values[std::clamp<std::size_t>(rank, 1, values.size()) - 1];
+  }
+
+  void clear() noexcept {
+    m_Samples.clear();
+    m_Input.reset();
+    m_Dropped = 0;
+  }
+
+private:
+  std::vector<Sample> m_Samples;
+  std::optional<Clock::time_point> m_Input;
+  Sample m_Current{};
+  std::size_t m_Next{0};
+  std::size_t m_Dropped{0};
+};
+
+}
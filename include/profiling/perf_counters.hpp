@@ -0,0 +1,284 @@
+#pragma once
+#include "utils/result.hpp"
+
+#include <array>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace chip8 {
+
+/// host hardware events, counted in user space for the calling thread
+enum class PerfEvent : std::uint8_t {
+  Instructions,
+  Cycles,
+  BranchMisses,
+  L1dMisses, // level 1 data cache read misses
+  Count
+};
+
+inline constexpr std::size_t PERF_EVENT_COUNT{
+    static_cast<std::size_t>(PerfEvent::Count)};
+
+inline constexpr std::array<std::string_view, PERF_EVENT_COUNT>
+    PERF_EVENT_NAMES{"instructions", "cycles", "branch_misses", "l1d_misses"};
+
+/// part of a frame the counts are charged to, Idle is not charged
+enum class PerfPhase : std::uint8_t {
+  Cpu, // instruction execution, display time excluded
+  Display, // DXYN and 00E0
+  Render, // IRenderer begin_frame to end_frame
+  Idle
+};
+
+inline constexpr std::size_t PERF_PHASE_COUNT{
+    static_cast<std::size_t>(PerfPhase::Idle)};
+
+inline constexpr std::array<std::string_view, PERF_PHASE_COUNT>
+    PERF_PHASE_NAMES{"cpu", "display", "render"};
+
+using PerfValues = std::array<std::uint64_t, PERF_EVENT_COUNT>;
+
+/// one perf_event_open counter group for the calling thread. the driver
+/// switches phases, each switch reads the group once and charges the counts
+/// since the previous switch to the phase that was running. events the host
+/// doesn't have are left out and stay 0. Linux only, open() fails elsewhere
+/// and when perf_event_paranoid or a container forbids it
+class PerfCounters {
+public:
+  [[nodiscard]] static Result<PerfCounters> open() {
+#ifdef __linux__
+    using R = Result<PerfCounters>;
+    PerfCounters counters;
+    int leader{-1};
+    int first_errno{0};
+    std::size_t opened{0};
+    for (std::size_t e{0}; e < PERF_EVENT_COUNT; ++e) {
+      const int fd{open_event(static_cast<PerfEvent>(e), leader)};
+      if (fd < 0) {
+        if (first_errno == 0)
+          first_errno = errno;
+        continue;
+      }
+      if (leader < 0)
+        leader = fd;
+      counters.m_Fds[e] = fd;
+      counters.m_Slot[e] = opened++;
+    }
+
+    if (leader < 0)
+      return R{Error::runtime("perf_event_open failed: " +
+                              reason(first_errno))};
+    ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    if (!counters.read_group(counters.m_Last))
+      return R{Error::runtime("perf counter group read failed")};
+    return R{std::move(counters)};
+#else
+    return Result<PerfCounters>{
+        Error::runtime("perf counters need Linux perf_event_open")};
+#endif
+  }
+
+  PerfCounters(const PerfCounters &) = delete;
+  PerfCounters &operator=(const PerfCounters &) = delete;
+
+  PerfCounters(PerfCounters &&other) noexcept : PerfCounters{} {
+    swap(other);
+  }
+  PerfCounters &operator=(PerfCounters &&other) noexcept {
+    PerfCounters moved{std::move(other)};
+    swap(moved);
+    return *this;
+  }
+
+  ~PerfCounters() { close_all(); }
+
+  [[nodiscard]] bool supported(PerfEvent event) const noexcept {
+    return m_Fds[static_cast<std::size_t>(event)] >= 0;
+  }
+
+  /// charges the counts since the last switch to the running phase and
+  /// makes phase the running one, returns the phase it replaced
+  PerfPhase switch_to(PerfPhase phase) noexcept {
+    PerfValues now{};
+    if (read_group(now) && m_Phase != PerfPhase::Idle) {
+      auto &totals{m_Totals[static_cast<std::size_t>(m_Phase)]};
+      for (std::size_t e{0}; e < PERF_EVENT_COUNT; ++e)
+        totals[e] += now[e] - m_Last[e];
+    }
+    m_Last = now;
+    return std::exchange(m_Phase, phase);
+  }
+
+  /// closes an emulated frame that executed the given chip8 instructions
+  void end_frame(std::uint64_t instructions) noexcept {
+    ++m_Frames;
+    m_Instructions += instructions;
+  }
+
+  [[nodiscard]] const PerfValues &totals(PerfPhase phase) const noexcept {
+    return m_Totals[static_cast<std::size_t>(phase)];
+  }
+  [[nodiscard]] std::uint64_t total(PerfPhase phase,
+                                    PerfEvent event) const noexcept {
+    return totals(phase)[static_cast<std::size_t>(event)];
+  }
+
+  [[nodiscard]] std::uint64_t frames() const noexcept { return m_Frames; }
+  /// chip8 instructions over every frame ended so far
+  [[nodiscard]] std::uint64_t instructions() const noexcept {
+    return m_Instructions;
+  }
+
+  [[nodiscard]] double per_frame(PerfPhase phase,
+                                 PerfEvent event) const noexcept {
+    return m_Frames == 0 ? 0.0
+                         : static_cast<double>(total(phase, event)) /
+                               static_cast<double>(m_Frames);
+  }
+
+  [[nodiscard]] double per_instruction(PerfPhase phase,
+                                       PerfEvent event) const noexcept {
+    return m_Instructions == 0 ? 0.0
+                               : static_cast<double>(total(phase, event)) /
+                                     static_cast<double>(m_Instructions);
+  }
+
+  /// the kernel time shared the hardware with other groups, counts are
+  /// then a sample of the run rather than exact
+  [[nodiscard]] bool multiplexed() const noexcept { return m_Multiplexed; }
+
+  void clear() noexcept {
+    m_Totals = {};
+    m_Frames = 0;
+    m_Instructions = 0;
+    m_Multiplexed = false;
+  }
+
+private:
+  static constexpr std::size_t NO_SLOT{PERF_EVENT_COUNT};
+
+  PerfCounters() noexcept {
+    m_Fds.fill(-1);
+    m_Slot.fill(NO_SLOT);
+  }
+
+  void swap(PerfCounters &other) noexcept {
+    std::swap(m_Fds, other.m_Fds);
+    std::swap(m_Slot, other.m_Slot);
+    std::swap(m_Last, other.m_Last);
+    std::swap(m_Totals, other.m_Totals);
+    std::swap(m_Phase, other.m_Phase);
+    std::swap(m_Frames, other.m_Frames);
+    std::swap(m_Instructions, other.m_Instructions);
+    std::swap(m_Multiplexed, other.m_Multiplexed);
+  }
+
+  [[nodiscard]] int leader() const noexcept {
+    for (const int fd : m_Fds)
+      if (fd >= 0)
+        return fd;
+    return -1;
+  }
+
+#ifdef __linux__
+  static int open_event(PerfEvent event, int group) noexcept {
+    perf_event_attr attr{};
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    switch (event) {
+    case PerfEvent::Instructions:
+      attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+      break;
+    case PerfEvent::Cycles:
+      attr.config = PERF_COUNT_HW_CPU_CYCLES;
+      break;
+    case PerfEvent::BranchMisses:
+      attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+      break;
+    default:
+      attr.type = PERF_TYPE_HW_CACHE;
+      attr.config = PERF_COUNT_HW_CACHE_L1D |
+                    (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                    (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+      break;
+    }
+    attr.disabled = group < 0 ? 1 : 0; // the leader starts the group
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+                       PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return static_cast<int>(
+        syscall(SYS_perf_event_open, &attr, 0, -1, group, 0));
+  }
+
+  static std::string reason(int error) {
+    switch (error) {
+    case EACCES:
+    case EPERM:
+      return "not permitted, see /proc/sys/kernel/perf_event_paranoid";
+    case ENOENT:
+    case EOPNOTSUPP:
+      return "no hardware counters on this host";
+    case ENOSYS:
+      return "kernel built without perf events";
+    default:
+      return std::strerror(error);
+    }
+  }
+#endif
+
+  bool read_group(PerfValues &values) noexcept {
+#ifdef __linux__
+    struct {
+      std::uint64_t count;
+      std::uint64_t time_enabled;
+      std::uint64_t time_running;
+      std::array<std::uint64_t, PERF_EVENT_COUNT> values;
+    } group{};
+    const int fd{leader()};
+    if (fd < 0 || ::read(fd, &group, sizeof(group)) <= 0)
+      return false;
+    m_Multiplexed = m_Multiplexed || group.time_running < group.time_enabled;
+    for (std::size_t e{0}; e < PERF_EVENT_COUNT; ++e)
+      values[e] = m_Slot[e] < group.count ? group.values[m_Slot[e]] : 0;
+    return true;
+#else
+    (void)values;
+    return false;
+#endif
+  }
+
+  void close_all() noexcept {
+#ifdef __linux__
+    // members first, the leader owns the group
+    for (std::size_t e{PERF_EVENT_COUNT}; e-- > 0;)
+      if (m_Fds[e] >= 0)
+        ::close(m_Fds[e]);
+#endif
+    m_Fds.fill(-1);
+  }
+
+  std::array<int, PERF_EVENT_COUNT> m_Fds;
+  std::array<std::size_t, PERF_EVENT_COUNT> m_Slot;
+  PerfValues m_Last{};
+  std::array<PerfValues, PERF_PHASE_COUNT> m_Totals{};
+  PerfPhase m_Phase{PerfPhase::Idle};
+  std::uint64_t m_Frames{0};
+  std::uint64_t m_Instructions{0};
+  bool m_Multiplexed{false};
+};
+
+}
@@ -0,0 +1,112 @@
+#pragma once
+#include "core/instruction.hpp"
+#include "core/types.hpp"
+
+#include <bit>
+#include <cstdint>
+#include <format>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace chip8 {
+
+/// one executed instruction, 16 bytes so four records share a cache line
+struct TraceRecord {
+  std::uint64_t cycle;
+  Word pc;
+  Word opcode;
+  Word index;
+  Byte changed_reg; // NO_REGISTER if the instruction left V0-VF untouched
+  Byte value; // new value of changed_reg
+};
+
+static_assert(sizeof(TraceRecord) == 16);
+
+/// fixed size ring of the most recent instructions. storage is allocated
+/// once on construction, recording is a couple of stores and a mask
+class TraceRing {
+public:
+  static constexpr Byte NO_REGISTER{0xFF};
+  static constexpr std::size_t DEFAULT_CAPACITY{1 << 16};
+
+  /// capacity is rounded up to a power of two
+  explicit TraceRing(std::size_t capacity = DEFAULT_CAPACITY)
+    : m_Records(std::bit_ceil(std::max<std::size_t>(capacity, 1))),
+      m_Mask{m_Records.size() - 1} {
+  }
+
+  void record(Address pc, Opcode opcode, Address index,
+              const RegisterFile &before, const RegisterFile &after) noexcept {
+    Byte changed{NO_REGISTER};
+    for (Byte i{0}; i < constants::NUM_REGISTERS; ++i) {
+      if (before[i] != after[i]) {
+        changed = i;
+        break;
+      }
+    }
+
+    m_Records[m_Cycle & m_Mask] = TraceRecord{
+        .cycle = m_Cycle,
+        .pc = pc.get(),
+        .opcode = opcode.get(),
+        .index = index.get(),
+        .changed_reg = changed,
+        .value = changed != NO_REGISTER ? after[changed].get() : Byte{0}};
+    ++m_Cycle;
+  }
+
+  [[nodiscard]] std::size_t capacity() const noexcept {
+    return m_Records.size();
+  }
+
+  [[nodiscard]] std::size_t size() const noexcept {
+    return static_cast<std::size_t>(
+        std::min<std::uint64_t>(m_Cycle, m_Records.size()));
+  }
+
+  [[nodiscard]] bool empty() const noexcept { return m_Cycle == 0; }
+
+  /// instructions recorded since construction or the last clear
+  [[nodiscard]] std::uint64_t total_recorded() const noexcept {
+    return m_Cycle;
+  }
+
+  /// i = 0 is the oldest record still held
+  [[nodiscard]] const TraceRecord &operator[](std::size_t i) const noexcept {
+    return m_Records[(m_Cycle - size() + i) & m_Mask];
+  }
+
+  [[nodiscard]] const TraceRecord &newest() const noexcept {
+    return m_Records[(m_Cycle - 1) & m_Mask];
+  }
+
+  void clear() noexcept { m_Cycle = 0; }
+
+private:
+  std::vector<TraceRecord> m_Records;
+  std::size_t m_Mask;
+  std::uint64_t m_Cycle{0};
+};
+
+[[nodiscard]] inline std::string format_trace_record(
+    const TraceRecord &record) {
+  const auto mnemonic{std::visit([](const auto &i) { return i.mnemonic(); },
+                                 decode(Opcode{record.opcode}))};
+
+  auto line{std::format("{:>10}  ${:03X}  {:04X}  {:<4}  I=${:03X}",
+                        record.cycle, record.pc, record.opcode, mnemonic,
+                        record.index)};
+  if (record.changed_reg != TraceRing::NO_REGISTER)
+    std::format_to(std::back_inserter(line), "  V{:X}={:02X}",
+                   record.changed_reg, record.value);
+  return line;
+}
+
+/// decode the ring oldest first, one instruction per line
+inline void dump_trace(const TraceRing &ring, std::ostream &out) {
+  for (std::size_t i{0}; i < ring.size(); ++i)
+    out << format_trace_record(ring[i]) << '\n';
+}
+
+}
@@ -0,0 +1,235 @@
+#pragma once
+#include "utils/result.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/// CHIP8_ZONE("name") times the rest of the enclosing block. it compiles to
+/// nothing unless CHIP8_ENABLE_ZONES is defined, see the cmake option of the
+/// same name. names must be string literals, only the pointer is kept
+#define CHIP8_ZONE_CAT2(a, b) a##b
+#define CHIP8_ZONE_CAT(a, b) CHIP8_ZONE_CAT2(a, b)
+#ifdef CHIP8_ENABLE_ZONES
+#define CHIP8_ZONE(name)                                                       \
+  const ::chip8::ZoneScope CHIP8_ZONE_CAT(chip8_zone_, __LINE__) { name }
+#else
+#define CHIP8_ZONE(name) static_cast<void>(0)
+#endif
+
+namespace chip8 {
+
+#ifdef CHIP8_ENABLE_ZONES
+inline constexpr bool ZONES_ENABLED{true};
+#else
+inline constexpr bool ZONES_ENABLED{false};
+#endif
+
+/// one closed zone, times in ns since the profiler epoch
+struct ZoneRecord {
+  const char *name;
+  std::uint64_t begin;
+  std::uint64_t end;
+};
+
+/// the zones of one thread. only the owning thread writes, the newest
+/// records overwrite the oldest once the ring is full
+class ZoneRing {
+public:
+  ZoneRing(std::uint32_t thread_id, std::size_t capacity)
+    : m_Records(std::bit_ceil(std::max<std::size_t>(capacity, 1))),
+      m_Mask{m_Records.size() - 1}, m_Thread_id{thread_id} {
+  }
+
+  void record(const char *name, std::uint64_t begin,
+              std::uint64_t end) noexcept {
+    const auto count{m_Count.load(std::memory_order_relaxed)};
+    m_Records[count & m_Mask] = ZoneRecord{name, begin, end};
+    m_Count.store(count + 1, std::memory_order_release);
+  }
+
+  /// oldest first
+  [[nodiscard]] std::vector<ZoneRecord> records() const {
+    const auto count{m_Count.load(std::memory_order_acquire)};
+    const auto kept{std::min<std::uint64_t>(count, m_Records.size())};
+    std::vector<ZoneRecord> out;
+    out.reserve(kept);
+    for (auto i{count - kept}; i < count; ++i)
+      out.push_back(m_Records[i & m_Mask]);
+    return out;
+  }
+
+  [[nodiscard]] std::uint64_t total_recorded() const noexcept {
+    return m_Count.load(std::memory_order_acquire);
+  }
+  [[nodiscard]] std::uint32_t thread_id() const noexcept {
+    return m_Thread_id;
+  }
+  [[nodiscard]] const std::string &thread_name() const noexcept {
+    return m_Thread_name;
+  }
+
+  void set_thread_name(std::string_view name) { m_Thread_name = name; }
+  void clear() noexcept { m_Count.store(0, std::memory_order_release); }
+
+private:
+  std::vector<ZoneRecord> m_Records;
+  std::size_t m_Mask;
+  std::atomic<std::uint64_t> m_Count{0};
+  std::uint32_t m_Thread_id;
+  std::string m_Thread_name;
+};
+
+/// owns every thread's ring. a thread's ring is created on its first zone
+/// and kept after the thread exits, so export sees all of them. export
+/// while the recording threads are idle, a ring being written may show a
+/// torn record
+class ZoneProfiler {
+public:
+  using Clock = std::chrono::steady_clock;
+  static constexpr std::size_t DEFAULT_CAPACITY{1 << 16};
+
+  static ZoneProfiler &instance() {
+    static ZoneProfiler profiler;
+    return profiler;
+  }
+
+  /// ring size for threads that have not recorded yet, rounded up to a
+  /// power of two
+  void set_capacity(std::size_t capacity) noexcept {
+    m_Capacity.store(capacity, std::memory_order_relaxed);
+  }
+
+  /// the calling thread's ring, allocated on first use
+  [[nodiscard]] ZoneRing &thread_ring() {
+    thread_local ZoneRing *ring{nullptr};
+    if (!ring) {
+      const std::scoped_lock lock{m_Mutex};
+      m_Rings.push_back(std::make_unique<ZoneRing>(
+          static_cast<std::uint32_t>(m_Rings.size() + 1),
+          m_Capacity.load(std::memory_order_relaxed)));
+      ring = m_Rings.back().get();
+    }
+    return *ring;
+  }
+
+  /// shown as the track name in the trace viewer
+  void name_thread(std::string_view name) {
+    thread_ring().set_thread_name(name);
+  }
+
+  [[nodiscard]] std::uint64_t now() const noexcept {
+    return static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() -
+          m_Epoch).count());
+  }
+
+  [[nodiscard]] std::size_t thread_count() const {
+    const std::scoped_lock lock{m_Mutex};
+    return m_Rings.size();
+  }
+
+  /// Chrome trace event JSON, one complete event per zone, opens in
+  /// Perfetto or chrome://tracing
+  void write_chrome(std::ostream &out) const {
+    const std::scoped_lock lock{m_Mutex};
+    out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    bool first{true};
+    const auto separator{[&] {
+      if (!first)
+        out << ',';
+      first = false;
+      out << '\n';
+    }};
+
+    for (const auto &ring : m_Rings) {
+      if (!ring->thread_name().empty()) {
+        separator();
+        out << std::format("{{\"name\":\"thread_name\",\"ph\":\"M\","
+                           "\"pid\":1,\"tid\":{},\"args\":{{\"name\":\"{}\"}}}}",
+                           ring->thread_id(), escape(ring->thread_name()));
+      }
+      for (const auto &zone : ring->records()) {
+        separator();
+        // microseconds with ns precision
+        out << std::format("{{\"name\":\"{}\",\"ph\":\"X\",\"pid\":1,"
+                           "\"tid\":{},\"ts\":{}.{:03},\"dur\":{}.{:03}}}",
+                           escape(zone.name), ring->thread_id(),
+                           zone.begin / 1000, zone.begin % 1000,
+                           (zone.end - zone.begin) / 1000,
+                           (zone.end - zone.begin) % 1000);
+      }
+    }
+    out << "\n]}\n";
+  }
+
+  Result<void> export_chrome(const std::filesystem::path &path) const {
+    std::ofstream file(path, std::ios::binary);
+    if (!file)
+      return Error::io(std::format("Failed to open file: {}", path.string()));
+    write_chrome(file);
+    if (!file)
+      return Error::io("Failed to write zone trace");
+    return Ok();
+  }
+
+  /// empties every ring, the rings themselves stay
+  void clear() {
+    const std::scoped_lock lock{m_Mutex};
+    for (const auto &ring : m_Rings)
+      ring->clear();
+  }
+
+private:
+  ZoneProfiler() = default;
+
+  static std::string escape(std::string_view text) {
+    std::string out;
+    out.reserve(text.size());
+    for (const char c : text) {
+      if (c == '"' || c == '\\')
+        out += '\\';
+      if (static_cast<unsigned char>(c) >= 0x20)
+        out += c;
+    }
+    return out;
+  }
+
+  const Clock::time_point m_Epoch{Clock::now()};
+  std::atomic<std::size_t> m_Capacity{DEFAULT_CAPACITY};
+  mutable std::mutex m_Mutex;
+  std::vector<std::unique_ptr<ZoneRing>> m_Rings;
+};
+
+/// records [construction, destruction) as a zone of the calling thread
+class ZoneScope {
+public:
+  explicit ZoneScope(const char *name) noexcept
+    : m_Name{name}, m_Begin{ZoneProfiler::instance().now()} {
+  }
+
+  ZoneScope(const ZoneScope &) = delete;
+  ZoneScope &operator=(const ZoneScope &) = delete;
+
+  ~ZoneScope() {
+    auto &profiler{ZoneProfiler::instance()};
+    profiler.thread_ring().record(m_Name, m_Begin, profiler.now());
+  }
+
+private:
+  const char *m_Name;
+  std::uint64_t m_Begin;
+};
+
+}
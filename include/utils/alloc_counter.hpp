@@ -0,0 +1,57 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+namespace chip8 {
+
+namespace detail {
+inline std::atomic<std::uint64_t> g_Allocations{0};
+inline std::atomic<std::uint64_t> g_Allocated_bytes{0};
+inline thread_local std::uint64_t t_Allocations{0};
+inline bool g_Alloc_counter_installed{false};
+
+inline void count_allocation(std::size_t size) noexcept {
+  g_Allocations.fetch_add(1, std::memory_order_relaxed);
+  g_Allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+  ++t_Allocations;
+}
+}
+
+/// heap allocations seen by the replaced global operator new. the operators
+/// live in src/alloc_counter.cpp, a binary that doesn't link it keeps every
+/// count at 0 and installed() false
+class AllocCounter {
+public:
+  [[nodiscard]] static bool installed() noexcept {
+    return detail::g_Alloc_counter_installed;
+  }
+
+  /// every thread since start up
+  [[nodiscard]] static std::uint64_t allocations() noexcept {
+    return detail::g_Allocations.load(std::memory_order_relaxed);
+  }
+
+  [[nodiscard]] static std::uint64_t bytes() noexcept {
+    return detail::g_Allocated_bytes.load(std::memory_order_relaxed);
+  }
+
+  /// the calling thread only, unaffected by logger or save threads
+  [[nodiscard]] static std::uint64_t thread_allocations() noexcept {
+    return detail::t_Allocations;
+  }
+};
+
+/// counts the calling thread's allocations from construction on
+class AllocScope {
+public:
+  AllocScope() noexcept : m_Start{AllocCounter::thread_allocations()} {}
+
+  [[nodiscard]] std::uint64_t allocations() const noexcept {
+    return AllocCounter::thread_allocations() - m_Start;
+  }
+
+private:
+  std::uint64_t m_Start;
+};
+
+}
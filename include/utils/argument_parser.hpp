@@ -1,13 +1,17 @@
 #pragma once
 #include "config.hpp"
 
+#include <charconv>
+#include <optional>
 #include <string>
+#include <string_view>
 
 
 namespace chip8 {
 
 struct CommandLineArgs {
   std::string rom_path;
+  std::string catalog_dir; // list the ROMs in this directory and exit
   Config config;
 
   bool help{false};
@@ -42,10 +46,89 @@ public:
           return std::nullopt;
         }
         result.config.cpu_frequency = std::atof(argv[++i]);
+      } else if (arg == "--shift-quirk") {
+        result.config.shift_quirk = true;
+        result.config.forced_quirks.shift = true;
+      } else if (arg == "--load-store-quirk") {
+        result.config.load_store_quirk = true;
+        result.config.forced_quirks.load_store = true;
+      } else if (arg == "--jump-quirk") {
+        result.config.jump_quirk = true;
+        result.config.forced_quirks.jump = true;
+      } else if (arg == "--clip") {
+        result.config.clip_sprites = true;
+        result.config.forced_quirks.clip = true;
+      } else if (arg == "--no-quirk-db") {
+        result.config.use_quirk_db = false;
+      } else if (arg == "--detect-quirks") {
+        result.config.detect_quirks = true;
       } else if (arg == "--fullscreen") {
         result.config.start_fullscreen = true;
       } else if (arg == "--no-audio") {
         result.config.audio_enabled = false;
+      } else if (arg == "--heatmap") {
+        if (i + 1 >= argc) {
+          std::cerr << "Error: --heatmap required a value\n";
+          return std::nullopt;
+        }
+        result.config.heatmap_prefix = argv[++i];
+      } else if (arg == "--callgraph") {
+        if (i + 1 >= argc) {
+          std::cerr << "Error: --callgraph required a value\n";
+          return std::nullopt;
+        }
+        result.config.callgraph_path = argv[++i];
+      } else if (arg == "--trace") {
+        if (i + 1 >= argc) {
+          std::cerr << "Error: --trace required a value\n";
+          return std::nullopt;
+        }
+        result.config.trace_path = argv[++i];
+      } else if (arg == "--trace-size") {
+        if (i + 1 >= argc) {
+          std::cerr << "Error: --trace-size required a value\n";
+          return std::nullopt;
+        }
+        const auto size{parse_number<std::size_t>(argv[++i], 1,
+                                                  MAX_TRACE_SIZE)};
+        if (!size) {
+          std::cerr << "Error: --trace-size must be 1-" << MAX_TRACE_SIZE
+                    << "\n";
+          return std::nullopt;
+        }
+        result.config.trace_size = *size;
+      } else if (arg == "--zones") {
+        if (i + 1 >= argc) {
+          std::cerr << "Error: --zones required a value\n";
+          return std::nullopt;
+        }
+        result.config.zones_path = argv[++i];
+      } else if (arg == "--perf") {
+        result.config.perf_counters = true;
+      } else if (arg == "--run-ahead") {
+        if (i + 1 >= argc) {
+          std::cerr << "Error: --run-ahead required a value\n";
+          return std::nullopt;
+        }
+        const auto frames{parse_number(argv[++i], 0, MAX_RUN_AHEAD)};
+        if (!frames) {
+          std::cerr << "Error: --run-ahead must be 0-" << MAX_RUN_AHEAD
+                    << "\n";
+          return std::nullopt;
+        }
+        result.config.run_ahead = *frames;
+      } else if (arg == "--pack") {
+        if (i + 1 >= argc) {
+          std::cerr << "Error: --pack required a value\n";
+          return std::nullopt;
+        }
+        result.config.rom_pack = argv[++i];
+      } else if (arg == "--catalog") {
+        if (i + 1 >= argc) {
+          std::cerr << "Error: --catalog required a value\n";
+          return std::nullopt;
+        }
+        result.catalog_dir = argv[++i];
       } else if (arg[0] == '-') {
         std::cerr << std::format("Error: unknown option {}", arg);
         return std::nullopt;
@@ -59,7 +142,8 @@ public:
       }
     }
 
-    if (result.rom_path.empty() && !result.help && !result.version) {
+    if (result.rom_path.empty() && result.catalog_dir.empty() &&
+        !result.help && !result.version) {
       std::cerr << "Error: No ROM file specifiedn\n";
       return std::nullopt;
     }
@@ -75,9 +159,26 @@ public:
   }
 
 private:
+  // 64 MB of trace records
+  static constexpr std::size_t MAX_TRACE_SIZE{1 << 22};
+  static constexpr int MAX_RUN_AHEAD{2}; // RunAhead::MAX_FRAMES
+
+  /// the whole of text as a number in [min, max]
+  template <typename T>
+  static std::optional<T> parse_number(std::string_view text, T min, T max) {
+    T value{};
+    const auto *const end{text.data() + text.size()};
+    const auto result{std::from_chars(text.data(), end, value)};
+    if (result.ec != std::errc{} || result.ptr != end || value < min ||
+        value > max)
+      return std::nullopt;
+    return value;
+  }
+
   static constexpr std::string_view HELP_TEXT{R"(
 USAGE:
   chip8 [OPTIONS] <rom>
+  chip8 --catalog <dir>
   chip8 --help
 
 ARGUMENTS:
@@ -88,13 +189,30 @@ OPTIONS:
   -v, --version           Show version
   -s, --scale <N>         Set display scale factor (1-32, 12 is default)
   -f, --frequency <N>     Set CPU frequency in Hz (1-10k, 500 is default)
+  --shift-quirk           8XY6/8XYE shift VX in place, ignoring VY
+  --load-store-quirk      FX55/FX65 leave I unchanged
+  --jump-quirk            BNNN jumps to NNN + VX instead of NNN + V0
+  --clip                  Clip sprites at the screen edge instead of wrapping
+  --no-quirk-db           Don't apply built-in quirks for known ROMs
+  --detect-quirks         Detect quirks of unknown ROMs, saved to ./profiles
+  --run-ahead <N>         Emulate N frames ahead to cut input lag (0-2)
   --fullscreen            Start in fullscreen mode
   --no-audio              Disable audio
+  --heatmap <prefix>      Write memory access heatmap (CSV + PPM) on exit
+  --callgraph <file>      Write subroutine cycles as collapsed stacks on exit
+  --trace <file>          Dump the last executed instructions on exit
+  --trace-size <N>        Instructions kept by --trace (65536 is default)
+  --perf                  Report hardware counters per frame on exit (Linux)
+  --zones <file>          Write profiler zones as Chrome trace JSON on exit
+                          (builds with -DCHIP8_ENABLE_ZONES=ON only)
+  --pack <file>           Load <rom> by name or hash from a chip8-pack archive
+  --catalog <dir>         List ROMs under dir with hash and platform, then exit
 
 EXAMPLES:
   chip8 roms/pong.ch8
   chip8 --scale 5 --fullscreen game.rom
   chip8 -f 1000 game.ch8
+  chip8 --pack roms.c8pk "games/Pong [Paul Vervalin, 1990].ch8"
 )"};
 
   static constexpr std::string_view VERSION_INFO{R"(
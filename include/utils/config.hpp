@@ -5,6 +5,15 @@
 
 namespace chip8 {
 
+/// quirks switched on from the command line, a quirk profile can't turn
+/// these off again
+struct ForcedQuirks {
+  bool shift{false};
+  bool load_store{false};
+  bool jump{false};
+  bool clip{false};
+};
+
 struct Config {
   int display_scale{12};
   bool start_fullscreen{false};
@@ -17,12 +26,28 @@ struct Config {
   bool shift_quirk{false};
   bool load_store_quirk{false};
   bool jump_quirk{false};
+  bool clip_sprites{false};
+  ForcedQuirks forced_quirks{};
+  bool use_quirk_db{true}; // known roms override unforced quirks on load
+  bool detect_quirks{false}; // run the quirk detector on unknown roms
+  int run_ahead{0}; // frames emulated ahead to hide input lag, 0-2
+  std::filesystem::path profile_directory{"./profiles"};
 
   bool debug_mode{false};
   LogLevel log_level{LogLevel::Info};
 
   std::filesystem::path rom_directory{"./roms"};
   std::filesystem::path last_rom_path{""};
+  std::filesystem::path rom_pack{""}; // empty = rom argument is a file path
+  std::filesystem::path save_directory{"./saves"};
+
+  // profiling
+  std::filesystem::path heatmap_prefix{""}; // empty = heatmap disabled
+  std::filesystem::path callgraph_path{""}; // empty = call profiler disabled
+  std::filesystem::path trace_path{""}; // empty = instruction trace disabled
+  std::size_t trace_size{1 << 16}; // TraceRing::DEFAULT_CAPACITY
+  bool perf_counters{false}; // hardware counters per frame, Linux only
+  std::filesystem::path zones_path{""}; // empty = zone trace not written
 };
 
 }
\ No newline at end of file
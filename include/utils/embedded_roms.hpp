@@ -0,0 +1,43 @@
+#pragma once
+#include "core/types.hpp"
+
+#include <array>
+#include <optional>
+#include <span>
+#include <string_view>
+
+namespace chip8 {
+
+/// rom compiled into the binary, see CHIP8_EMBED_ROMS in CMakeLists.txt
+struct EmbeddedRom {
+  std::string_view name; // path relative to roms/
+  std::span<const Byte> data;
+};
+
+namespace embedded {
+#ifdef CHIP8_HAS_EMBEDDED_ROMS
+// generated at configure time by cmake/EmbedRoms.cmake
+#include "embedded_roms.inc"
+#else
+inline constexpr std::array<EmbeddedRom, 0> EMBEDDED_ROMS{};
+#endif
+}
+
+inline constexpr std::span<const EmbeddedRom> EMBEDDED_ROMS{
+    embedded::EMBEDDED_ROMS};
+
+/// match by name relative to roms/, or by any path that ends in it, so
+/// "roms/games/Pong.ch8" finds "games/Pong.ch8"
+[[nodiscard]] constexpr std::optional<EmbeddedRom> find_embedded_rom(
+    std::string_view path) noexcept {
+  for (const auto &rom : EMBEDDED_ROMS) {
+    if (path == rom.name)
+      return rom;
+    if (path.size() > rom.name.size() && path.ends_with(rom.name) &&
+        path[path.size() - rom.name.size() - 1] == '/')
+      return rom;
+  }
+  return std::nullopt;
+}
+
+}
@@ -0,0 +1,124 @@
+#pragma once
+#include "core/types.hpp"
+
+#include <bit>
+#include <cstdint>
+#include <span>
+#include <string_view>
+
+namespace chip8 {
+
+/// XXH64, fast non-cryptographic content hash used to identify ROMs.
+/// constexpr so hashes of known ROMs can be baked into tables at compile time
+class Xxh64 {
+public:
+  [[nodiscard]] static constexpr std::uint64_t hash(
+      std::span<const Byte> data, std::uint64_t seed = 0) noexcept {
+    return hash_bytes(data.data(), data.size(), seed);
+  }
+
+  [[nodiscard]] static constexpr std::uint64_t hash(
+      std::string_view text, std::uint64_t seed = 0) noexcept {
+    return hash_bytes(text.data(), text.size(), seed);
+  }
+
+private:
+  static constexpr std::uint64_t P1{0x9E3779B185EBCA87ULL};
+  static constexpr std::uint64_t P2{0xC2B2AE3D27D4EB4FULL};
+  static constexpr std::uint64_t P3{0x165667B19E3779F9ULL};
+  static constexpr std::uint64_t P4{0x85EBCA77C2B2AE63ULL};
+  static constexpr std::uint64_t P5{0x27D4EB2F165667C5ULL};
+
+  static constexpr std::uint64_t round(std::uint64_t acc,
+                                       std::uint64_t input) noexcept {
+    acc += input * P2;
+    acc = std::rotl(acc, 31);
+    return acc * P1;
+  }
+
+  static constexpr std::uint64_t merge(std::uint64_t acc,
+                                       std::uint64_t value) noexcept {
+    acc ^= round(0, value);
+    return acc * P1 + P4;
+  }
+
+  // char or Byte input, both readable in constant evaluation
+  template <typename Ch>
+  static constexpr std::uint64_t hash_bytes(const Ch *data, std::size_t size,
+                                            std::uint64_t seed) noexcept {
+    const Ch *p{data};
+    const Ch *const end{p + size};
+    std::uint64_t h;
+
+    if (size >= 32) {
+      std::uint64_t v1{seed + P1 + P2};
+      std::uint64_t v2{seed + P2};
+      std::uint64_t v3{seed};
+      std::uint64_t v4{seed - P1};
+      const Ch *const limit{end - 32};
+      do {
+        v1 = round(v1, read64(p));
+        v2 = round(v2, read64(p + 8));
+        v3 = round(v3, read64(p + 16));
+        v4 = round(v4, read64(p + 24));
+        p += 32;
+      } while (p <= limit);
+
+      h = std::rotl(v1, 1) + std::rotl(v2, 7) + std::rotl(v3, 12) +
+          std::rotl(v4, 18);
+      h = merge(h, v1);
+      h = merge(h, v2);
+      h = merge(h, v3);
+      h = merge(h, v4);
+    } else {
+      h = seed + P5;
+    }
+
+    h += size;
+
+    for (; p + 8 <= end; p += 8) {
+      h ^= round(0, read64(p));
+      h = std::rotl(h, 27) * P1 + P4;
+    }
+    if (p + 4 <= end) {
+      h ^= read32(p) * P1;
+      h = std::rotl(h, 23) * P2 + P3;
+      p += 4;
+    }
+    for (; p < end; ++p) {
+      h ^= static_cast<Byte>(*p) * P5;
+      h = std::rotl(h, 11) * P1;
+    }
+
+    h ^= h >> 33;
+    h *= P2;
+    h ^= h >> 29;
+    h *= P3;
+    h ^= h >> 32;
+    return h;
+  }
+
+  // little endian loads, byte by byte so the compiler can fuse them
+  template <typename Ch>
+  static constexpr std::uint64_t read64(const Ch *p) noexcept {
+    std::uint64_t value{0};
+    for (int i{7}; i >= 0; --i)
+      value = (value << 8) | static_cast<Byte>(p[i]);
+    return value;
+  }
+
+  template <typename Ch>
+  static constexpr std::uint64_t read32(const Ch *p) noexcept {
+    std::uint64_t value{0};
+    for (int i{3}; i >= 0; --i)
+      value = (value << 8) | static_cast<Byte>(p[i]);
+    return value;
+  }
+};
+
+[[nodiscard]] constexpr std::uint64_t rom_hash(
+    std::span<const Byte> data) noexcept {
+  return Xxh64::hash(data);
+}
+
+}
@@ -1,9 +1,25 @@
 #pragma once
+#include "mpsc_queue.hpp"
+#include "timestamp.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <format>
 #include <iostream>
 #include <mutex>
 #include <source_location>
+#include <string>
 #include <string_view>
+#include <thread>
+
+// compile time floor, LOG_* call sites below it expand to nothing
+// 0 = Trace, 1 = Debug, 2 = Info, 3 = Warning, 4 = Error, 5 = Fatal, 6 = Off
+#ifndef CHIP8_LOG_MIN_LEVEL
+#define CHIP8_LOG_MIN_LEVEL 0
+#endif
 
 namespace chip8 {
 
@@ -32,6 +48,9 @@ enum class LogLevel {
   return "Unknown";
 }
 
+inline constexpr LogLevel COMPILE_TIME_LOG_LEVEL{
+    static_cast<LogLevel>(CHIP8_LOG_MIN_LEVEL)};
+
 struct LogConfig {
   LogLevel min_level{LogLevel::Info};
   bool show_timestamp{true};
@@ -39,6 +58,26 @@ struct LogConfig {
   bool show_location{true};
 
   std::ostream *output{&std::cerr};
+  TimestampMode timestamp_mode{TimestampMode::WallClock};
+
+  // async: callers format and enqueue, a background thread writes to output.
+  // the queue is sized once, by the first async configure
+  bool async{false};
+  std::size_t async_queue_size{4096};
+};
+
+/// one queued message, location strings have static storage. longer
+/// messages are cut and end in TRUNCATED
+struct LogRecord {
+  static constexpr std::size_t MAX_MESSAGE{224};
+  static constexpr std::string_view TRUNCATED{"..."};
+
+  LogLevel level{LogLevel::Info};
+  TimestampProvider::Clock::time_point time{};
+  const char *file{""};
+  std::uint_least32_t line{0};
+  std::uint16_t length{0};
+  std::array<char, MAX_MESSAGE> text{};
 };
 
 
@@ -55,52 +94,90 @@ public:
 
   void configure(const LogConfig &cfg) {
     std::lock_guard lock(m_Mutex);
+    stop_worker();
     m_Config = cfg;
+    m_Level.store(cfg.min_level, std::memory_order_relaxed);
+    m_Timestamps.set_mode(cfg.timestamp_mode);
+    if (cfg.async)
+      start_worker();
   }
 
   void set_level(LogLevel level) {
     std::lock_guard lock(m_Mutex);
     m_Config.min_level = level;
+    m_Level.store(level, std::memory_order_relaxed);
+  }
+
+  [[nodiscard]] LogLevel level() const {
+    return m_Level.load(std::memory_order_relaxed);
+  }
+
+  [[nodiscard]] bool is_async() const {
+    return m_Async.load(std::memory_order_acquire);
+  }
+
+  /// messages lost because the async queue was full
+  [[nodiscard]] std::uint64_t dropped() const {
+    return m_Dropped.load(std::memory_order_relaxed);
   }
 
-  [[nodiscard]] LogLevel level() const { return m_Config.min_level; }
+  /// block until everything logged so far reached the output
+  void flush() {
+    if (is_async()) {
+      const auto target{m_Queue->pushed()};
+      auto written{m_Written.load(std::memory_order_acquire)};
+      while (written < target) {
+        m_Written.wait(written, std::memory_order_acquire);
+        written = m_Written.load(std::memory_order_acquire);
+      }
+      return;
+    }
+
+    std::lock_guard lock{m_Mutex};
+    drain_stranded();
+    m_Config.output->flush();
+  }
 
   template <typename... Args>
   void log(LogLevel level, std::source_location loc,
            std::format_string<Args...> fmt, Args &&... args) {
-    if (level < m_Config.min_level)
+    if (level < m_Level.load(std::memory_order_relaxed))
       return;
 
-    std::lock_guard lock{m_Mutex};
+    auto &buffer{thread_buffer()};
+    buffer.clear();
 
-    auto &out{*m_Config.output};
+    if (!is_async()) {
+      std::unique_lock lock{m_Mutex};
+      // re-check, configure may have started the writer thread meanwhile
+      if (!is_async()) {
+        append_prefix(buffer, level, TimestampProvider::now(),
+                      loc.file_name(), loc.line());
+        std::format_to(std::back_inserter(buffer), fmt,
+                       std::forward<Args>(args)...);
+        buffer += '\n';
 
-    // timestamp
-    if (m_Config.show_timestamp) {
-      const auto now{std::chrono::system_clock::now()};
-      const auto time{std::chrono::system_clock::to_time_t(now)};
-      const auto ms{
-          std::chrono::duration_cast<std::chrono::milliseconds>(
-              now.time_since_epoch()) % 1000};
-
-      std::tm tm_buf{};
-      localtime_s(&tm_buf, &time);
-
-      out << std::format("{:02}:{:02}:{:02}.{:03} ",
-                         tm_buf.tm_hour, tm_buf.tm_min, tm_buf.tm_sec,
-                         ms.count());
+        auto &out{*m_Config.output};
+        out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        // flush if error
+        if (level >= LogLevel::Error)
+          out.flush();
+        return;
+      }
+    }
+
+    std::format_to(std::back_inserter(buffer), fmt,
+                   std::forward<Args>(args)...);
+    enqueue(level, loc, buffer);
+
+    // configure may have stopped the writer since the check above, its
+    // last drain can have missed this record
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!is_async()) {
+      std::lock_guard lock{m_Mutex};
+      if (!is_async())
+        drain_stranded();
     }
-    // level
-    if (m_Config.show_level)
-      out << '[' << log_level_string(level) << "] ";
-    // location
-    if (m_Config.show_location)
-      out << std::format("{}:{}", loc.file_name(), loc.line());
-    // message
-    out << std::format(fmt, std::forward<Args>(args)...) << '\n';
-    // flush if error
-    if (level >= LogLevel::Error)
-      out.flush();
   }
 
   template <typename... Args>
@@ -141,9 +218,172 @@ public:
 
 private:
   Logger() = default;
-  ~Logger() = default;
+
+  ~Logger() {
+    std::lock_guard lock(m_Mutex);
+    stop_worker();
+  }
+
+  static std::string &thread_buffer() {
+    thread_local std::string buffer{[] {
+      std::string s;
+      s.reserve(256);
+      return s;
+    }()};
+    return buffer;
+  }
+
+  // timestamp cache is owned by whoever writes: the caller under m_Mutex
+  // in sync mode, the writer thread in async mode
+  void append_prefix(std::string &out, LogLevel level,
+                     TimestampProvider::Clock::time_point now,
+                     const char *file, std::uint_least32_t line) {
+    // timestamp
+    if (m_Config.show_timestamp)
+      m_Timestamps.append(out, now);
+    // level
+    if (m_Config.show_level) {
+      out += '[';
+      out += log_level_string(level);
+      out += "] ";
+    }
+    // location
+    if (m_Config.show_location)
+      std::format_to(std::back_inserter(out), "{}:{}", file, line);
+  }
+
+  /// producer side, never blocks: a full queue drops the message
+  void enqueue(LogLevel level, std::source_location loc,
+               std::string_view message) noexcept {
+    const auto now{TimestampProvider::now()};
+    const bool pushed{m_Queue->push_with([&](LogRecord &record) {
+      record.level = level;
+      record.time = now;
+      record.file = loc.file_name();
+      record.line = loc.line();
+      if (message.size() <= LogRecord::MAX_MESSAGE) {
+        record.length = static_cast<std::uint16_t>(message.size());
+        std::copy_n(message.data(), message.size(), record.text.data());
+        return;
+      }
+      constexpr auto kept{LogRecord::MAX_MESSAGE -
+                          LogRecord::TRUNCATED.size()};
+      std::copy_n(message.data(), kept, record.text.data());
+      std::ranges::copy(LogRecord::TRUNCATED, record.text.data() + kept);
+      record.length = LogRecord::MAX_MESSAGE;
+    })};
+
+    if (!pushed) {
+      m_Dropped.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+    m_Published.fetch_add(1, std::memory_order_release);
+    m_Published.notify_one();
+  }
+
+  /// consumer side, writes everything queued as one batch
+  std::size_t drain(std::string &batch, LogRecord &record) {
+    batch.clear();
+    std::size_t count{0};
+    bool flush{false};
+
+    while (m_Queue->pop(record)) {
+      append_prefix(batch, record.level, record.time, record.file,
+                    record.line);
+      batch.append(record.text.data(), record.length);
+      batch += '\n';
+      flush = flush || record.level >= LogLevel::Error;
+      ++count;
+    }
+
+    const auto dropped{m_Dropped.load(std::memory_order_relaxed)};
+    if (dropped != m_Reported_dropped) {
+      std::format_to(std::back_inserter(batch),
+                     "[logger] {} messages dropped, queue full\n",
+                     dropped - m_Reported_dropped);
+      m_Reported_dropped = dropped;
+    }
+
+    if (!batch.empty()) {
+      auto &out{*m_Config.output};
+      out.write(batch.data(), static_cast<std::streamsize>(batch.size()));
+      out.flush();
+    }
+
+    if (count > 0) {
+      m_Written.fetch_add(count, std::memory_order_release);
+      m_Written.notify_all();
+    }
+    return count;
+  }
+
+  void worker_loop(std::stop_token stop) {
+    std::string batch;
+    batch.reserve(64 * 1024);
+    LogRecord record;
+
+    for (;;) {
+      const auto seen{m_Published.load(std::memory_order_acquire)};
+      if (drain(batch, record) > 0)
+        continue;
+      if (stop.stop_requested())
+        break;
+      m_Published.wait(seen, std::memory_order_acquire);
+    }
+  }
+
+  // callers hold m_Mutex
+  void start_worker() {
+    if (!m_Queue)
+      m_Queue = std::make_unique<MpscQueue<LogRecord>>(
+          m_Config.async_queue_size);
+
+    m_Async.store(true, std::memory_order_release);
+    m_Worker = std::jthread{[this](std::stop_token stop) {
+      worker_loop(stop);
+    }};
+  }
+
+  void stop_worker() {
+    if (!m_Worker.joinable())
+      return;
+
+    m_Async.store(false, std::memory_order_release);
+    m_Worker.request_stop();
+    m_Published.fetch_add(1, std::memory_order_release);
+    m_Published.notify_all();
+    m_Worker.join();
+
+    // pairs with the fence in log(), a producer either sees sync mode and
+    // drains itself or its record is visible here
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    drain_stranded();
+  }
+
+  /// records queued by producers that raced the switch back to sync mode,
+  /// callers hold m_Mutex
+  void drain_stranded() {
+    if (!m_Queue ||
+        m_Queue->pushed() == m_Written.load(std::memory_order_acquire))
+      return;
+    std::string batch;
+    LogRecord record;
+    drain(batch, record);
+  }
+
   LogConfig m_Config{};
   std::mutex m_Mutex{};
+  std::atomic<LogLevel> m_Level{LogLevel::Info};
+  TimestampProvider m_Timestamps{};
+
+  // async backend
+  std::atomic<bool> m_Async{false};
+  std::unique_ptr<MpscQueue<LogRecord>> m_Queue;
+  std::atomic<std::uint64_t> m_Published{0};
+  std::atomic<std::size_t> m_Written{0};
+  std::atomic<std::uint64_t> m_Dropped{0};
+  std::uint64_t m_Reported_dropped{0};
+  std::jthread m_Worker;
 };
 
 
@@ -165,12 +405,42 @@ private:
   LogLevel m_Previous_level;
 };
 
-// macros for automatic source location
+// macros for automatic source location, levels below CHIP8_LOG_MIN_LEVEL
+// are removed at compile time together with their arguments
+#if CHIP8_LOG_MIN_LEVEL <= 0
 #define LOG_TRACE(...) ::chip8::Logger::instance().trace(std::source_location::current(), __VA_ARGS__)
+#else
+#define LOG_TRACE(...) ((void)0)
+#endif
+
+#if CHIP8_LOG_MIN_LEVEL <= 1
 #define LOG_DEBUG(...) ::chip8::Logger::instance().debug(std::source_location::current(), __VA_ARGS__)
+#else
+#define LOG_DEBUG(...) ((void)0)
+#endif
+
+#if CHIP8_LOG_MIN_LEVEL <= 2
 #define LOG_INFO(...) ::chip8::Logger::instance().info(std::source_location::current(), __VA_ARGS__)
+#else
+#define LOG_INFO(...) ((void)0)
+#endif
+
+#if CHIP8_LOG_MIN_LEVEL <= 3
 #define LOG_WARNING(...) ::chip8::Logger::instance().warning(std::source_location::current(), __VA_ARGS__)
+#else
+#define LOG_WARNING(...) ((void)0)
+#endif
+
+#if CHIP8_LOG_MIN_LEVEL <= 4
 #define LOG_ERROR(...) ::chip8::Logger::instance().error(std::source_location::current(), __VA_ARGS__)
+#else
+#define LOG_ERROR(...) ((void)0)
+#endif
+
+#if CHIP8_LOG_MIN_LEVEL <= 5
 #define LOG_FATAL(...) ::chip8::Logger::instance().fatal(std::source_location::current(), __VA_ARGS__)
+#else
+#define LOG_FATAL(...) ((void)0)
+#endif
 
 }
\ No newline at end of file
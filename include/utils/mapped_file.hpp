@@ -0,0 +1,135 @@
+#pragma once
+#include "result.hpp"
+#include "core/types.hpp"
+
+#include <cstring>
+#include <filesystem>
+#include <span>
+#include <utility>
+
+#ifdef _WIN32
+// windows.h clashes with raylib, fall back to a single buffered read
+#include <fstream>
+#include <system_error>
+#include <vector>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace chip8 {
+
+/// read-only view of a whole file. on posix the file is mmap'd, one open,
+/// one fstat and no copy. elsewhere it is read into an owned buffer
+class MappedFile {
+public:
+  MappedFile() = default;
+
+  ~MappedFile() { release(); }
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  MappedFile(MappedFile &&other) noexcept { *this = std::move(other); }
+
+  MappedFile &operator=(MappedFile &&other) noexcept {
+    if (this != &other) {
+      release();
+      m_Data = std::exchange(other.m_Data, nullptr);
+      m_Size = std::exchange(other.m_Size, 0);
+#ifdef _WIN32
+      m_Buffer = std::move(other.m_Buffer);
+#endif
+    }
+    return *this;
+  }
+
+  static Result<MappedFile> open(const std::filesystem::path &path) {
+    MappedFile file;
+#ifdef _WIN32
+    std::error_code ec;
+    const auto size{std::filesystem::file_size(path, ec)};
+    if (ec)
+      return Result<MappedFile>{
+          Error::io(std::format("File not found: {}", path.string()))};
+
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+      return Result<MappedFile>{
+          Error::io(std::format("Failed to open file: {}", path.string()))};
+
+    file.m_Buffer.resize(size);
+    in.read(reinterpret_cast<char *>(file.m_Buffer.data()),
+            static_cast<std::streamsize>(size));
+    if (!in)
+      return Result<MappedFile>{
+          Error::io(std::format("Failed to read file: {}", path.string()))};
+
+    file.m_Data = file.m_Buffer.data();
+    file.m_Size = size;
+#else
+    const int fd{::open(path.c_str(), O_RDONLY | O_CLOEXEC)};
+    if (fd < 0) {
+      if (errno == ENOENT)
+        return Result<MappedFile>{
+            Error::io(std::format("File not found: {}", path.string()))};
+      return Result<MappedFile>{
+          Error::io(std::format("Failed to open file: {} ({})", path.string(),
+                                std::strerror(errno)))};
+    }
+
+    struct stat st{};
+    if (::fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+      ::close(fd);
+      return Result<MappedFile>{
+          Error::io(std::format("Not a regular file: {}", path.string()))};
+    }
+
+    // mmap rejects zero length, an empty file is just an empty view
+    if (st.st_size > 0) {
+      void *addr{::mmap(nullptr, static_cast<std::size_t>(st.st_size),
+                        PROT_READ, MAP_PRIVATE, fd, 0)};
+      if (addr == MAP_FAILED) {
+        ::close(fd);
+        return Result<MappedFile>{
+            Error::io(std::format("Failed to map file: {} ({})",
+                                  path.string(), std::strerror(errno)))};
+      }
+      file.m_Data = static_cast<const Byte *>(addr);
+      file.m_Size = static_cast<std::size_t>(st.st_size);
+    }
+    // the mapping keeps the file referenced
+    ::close(fd);
+#endif
+    return Result<MappedFile>{std::move(file)};
+  }
+
+  [[nodiscard]] const Byte *data() const noexcept { return m_Data; }
+  [[nodiscard]] std::size_t size() const noexcept { return m_Size; }
+  [[nodiscard]] bool empty() const noexcept { return m_Size == 0; }
+
+  [[nodiscard]] std::span<const Byte> bytes() const noexcept {
+    return {m_Data, m_Size};
+  }
+
+private:
+  void release() noexcept {
+#ifndef _WIN32
+    if (m_Data)
+      ::munmap(const_cast<Byte *>(m_Data), m_Size);
+#endif
+    m_Data = nullptr;
+    m_Size = 0;
+  }
+
+  const Byte *m_Data{nullptr};
+  std::size_t m_Size{0};
+#ifdef _WIN32
+  std::vector<Byte> m_Buffer;
+#endif
+};
+
+}
@@ -0,0 +1,93 @@
+#pragma once
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <memory>
+#include <new>
+
+namespace chip8 {
+
+/// bounded lock-free multi producer / single consumer queue.
+/// every slot carries a sequence number (Vyukov's bounded queue), producers
+/// claim a position with a CAS and never wait on each other or the consumer.
+/// push fails instead of blocking when the queue is full
+template <typename T>
+class MpscQueue {
+public:
+  /// capacity is rounded up to a power of two
+  explicit MpscQueue(std::size_t capacity)
+    : m_Capacity{std::bit_ceil(std::max<std::size_t>(capacity, 2))},
+      m_Mask{m_Capacity - 1},
+      m_Slots{std::make_unique<Slot[]>(m_Capacity)} {
+    for (std::size_t i{0}; i < m_Capacity; ++i)
+      m_Slots[i].sequence.store(i, std::memory_order_relaxed);
+  }
+
+  MpscQueue(const MpscQueue &) = delete;
+  MpscQueue &operator=(const MpscQueue &) = delete;
+
+  /// construct the element in place through fill(T&), false if full
+  template <typename F>
+  bool push_with(F &&fill) noexcept {
+    std::size_t pos{m_Enqueue_pos.load(std::memory_order_relaxed)};
+    Slot *slot;
+    for (;;) {
+      slot = &m_Slots[pos & m_Mask];
+      const std::size_t seq{slot->sequence.load(std::memory_order_acquire)};
+      const auto diff{static_cast<std::ptrdiff_t>(seq) -
+                      static_cast<std::ptrdiff_t>(pos)};
+      if (diff == 0) {
+        if (m_Enqueue_pos.compare_exchange_weak(pos, pos + 1,
+                                                std::memory_order_relaxed))
+          break;
+      } else if (diff < 0) {
+        return false; // full
+      } else {
+        pos = m_Enqueue_pos.load(std::memory_order_relaxed);
+      }
+    }
+
+    fill(slot->value);
+    slot->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool push(const T &value) noexcept {
+    return push_with([&](T &slot) { slot = value; });
+  }
+
+  /// consumer side only
+  bool pop(T &out) noexcept {
+    Slot &slot{m_Slots[m_Dequeue_pos & m_Mask]};
+    const std::size_t seq{slot.sequence.load(std::memory_order_acquire)};
+    if (seq != m_Dequeue_pos + 1)
+      return false; // empty, or the producer has not published yet
+
+    out = slot.value;
+    slot.sequence.store(m_Dequeue_pos + m_Capacity, std::memory_order_release);
+    ++m_Dequeue_pos;
+    return true;
+  }
+
+  [[nodiscard]] std::size_t capacity() const noexcept { return m_Capacity; }
+
+  /// number of successful pushes so far
+  [[nodiscard]] std::size_t pushed() const noexcept {
+    return m_Enqueue_pos.load(std::memory_order_acquire);
+  }
+
+private:
+  struct Slot {
+    std::atomic<std::size_t> sequence;
+    T value;
+  };
+
+  std::size_t m_Capacity;
+  std::size_t m_Mask;
+  std::unique_ptr<Slot[]> m_Slots;
+
+  alignas(64) std::atomic<std::size_t> m_Enqueue_pos{0};
+  alignas(64) std::size_t m_Dequeue_pos{0};
+};
+
+}
@@ -0,0 +1,145 @@
+#pragma once
+#include "result.hpp"
+#include "core/types.hpp"
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace chip8 {
+
+/// 8 bit RGB image, just enough PNG to dump frames for inspection. the
+/// pixel data goes into uncompressed deflate blocks, no zlib needed
+class PngWriter {
+public:
+  struct Rgb {
+    Byte r, g, b;
+  };
+
+  PngWriter(std::size_t width, std::size_t height)
+    : m_Width{width},
+      m_Height{height},
+      m_Pixels(width * height, Rgb{0, 0, 0}) {
+  }
+
+  [[nodiscard]] std::size_t width() const noexcept { return m_Width; }
+  [[nodiscard]] std::size_t height() const noexcept { return m_Height; }
+
+  void set(std::size_t x, std::size_t y, Rgb color) noexcept {
+    if (x < m_Width && y < m_Height)
+      m_Pixels[y * m_Width + x] = color;
+  }
+
+  void fill(std::size_t x, std::size_t y, std::size_t w, std::size_t h,
+            Rgb color) noexcept {
+    for (std::size_t dy{0}; dy < h; ++dy)
+      for (std::size_t dx{0}; dx < w; ++dx)
+        set(x + dx, y + dy, color);
+  }
+
+  Result<void> write(const std::filesystem::path &path) const {
+    // scanlines, each behind a filter type byte of 0
+    std::vector<Byte> raw;
+    raw.reserve(m_Height * (1 + m_Width * 3));
+    for (std::size_t y{0}; y < m_Height; ++y) {
+      raw.push_back(0);
+      for (std::size_t x{0}; x < m_Width; ++x) {
+        const auto &p{m_Pixels[y * m_Width + x]};
+        raw.insert(raw.end(), {p.r, p.g, p.b});
+      }
+    }
+
+    std::vector<Byte> png{0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+
+    std::vector<Byte> header;
+    put32(header, static_cast<std::uint32_t>(m_Width));
+    put32(header, static_cast<std::uint32_t>(m_Height));
+    header.insert(header.end(), {8, 2, 0, 0, 0}); // 8 bit rgb, no interlace
+    chunk(png, "IHDR", header);
+    chunk(png, "IDAT", zlib_stored(raw));
+    chunk(png, "IEND", {});
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file)
+      return Error::io(std::format("Failed to open file: {}", path.string()));
+    file.write(reinterpret_cast<const char *>(png.data()),
+               static_cast<std::streamsize>(png.size()));
+    if (!file)
+      return Error::io(std::format("Failed to write {}", path.string()));
+    return Ok();
+  }
+
+private:
+  static constexpr std::array<std::uint32_t, 256> CRC_TABLE{[] {
+    std::array<std::uint32_t, 256> table{};
+    for (std::uint32_t n{0}; n < 256; ++n) {
+      std::uint32_t c{n};
+      for (int k{0}; k < 8; ++k)
+        c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+      table[n] = c;
+    }
+    return table;
+  }()};
+
+  static std::uint32_t crc32(std::span<const Byte> data,
+                             std::uint32_t crc = 0) noexcept {
+    crc = ~crc;
+    for (const auto b : data)
+      crc = CRC_TABLE[(crc ^ b) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+  }
+
+  static void put32(std::vector<Byte> &out, std::uint32_t value) {
+    out.insert(out.end(), {static_cast<Byte>(value >> 24),
+                           static_cast<Byte>(value >> 16),
+                           static_cast<Byte>(value >> 8),
+                           static_cast<Byte>(value)});
+  }
+
+  static void chunk(std::vector<Byte> &out, std::string_view type,
+                    std::span<const Byte> data) {
+    put32(out, static_cast<std::uint32_t>(data.size()));
+    const auto start{out.size()};
+    out.insert(out.end(), type.begin(), type.end());
+    out.insert(out.end(), data.begin(), data.end());
+    put32(out, crc32(std::span{out}.subspan(start)));
+  }
+
+  static std::vector<Byte> zlib_stored(std::span<const Byte> data) {
+    std::vector<Byte> out{0x78, 0x01};
+    std::size_t offset{0};
+    do {
+      const auto size{std::min<std::size_t>(data.size() - offset, 65535)};
+      const bool last{offset + size == data.size()};
+      const auto len{static_cast<std::uint16_t>(size)};
+      out.insert(out.end(), {static_cast<Byte>(last),
+                             static_cast<Byte>(len),
+                             static_cast<Byte>(len >> 8),
+                             static_cast<Byte>(~len),
+                             static_cast<Byte>(~len >> 8)});
+      out.insert(out.end(), data.begin() + offset,
+                 data.begin() + offset + size);
+      offset += size;
+    } while (offset < data.size());
+
+    std::uint32_t a{1};
+    std::uint32_t b{0};
+    for (const auto byte : data) {
+      a = (a + byte) % 65521;
+      b = (b + a) % 65521;
+    }
+    put32(out, (b << 16) | a);
+    return out;
+  }
+
+  std::size_t m_Width;
+  std::size_t m_Height;
+  std::vector<Rgb> m_Pixels;
+};
+
+}
@@ -0,0 +1,115 @@
+#pragma once
+#include "core/types.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <limits>
+#include <string_view>
+
+namespace chip8 {
+
+/// interpreter behaviour a rom expects, applied on top of Config on load
+struct QuirkProfile {
+  bool shift_quirk{false};
+  bool load_store_quirk{false};
+  bool jump_quirk{false};
+  bool clip_sprites{false}; // clip at the screen edge instead of wrapping
+  double frequency_hz{0.0}; // 0 = keep the configured frequency
+};
+
+struct QuirkDbEntry {
+  std::uint64_t hash; // xxh64 of the rom, see rom_hash()
+  std::string_view name;
+  QuirkProfile profile;
+};
+
+/// immutable hash -> entry map built at compile time. the keys are already
+/// well mixed content hashes, so one multiply-shift with a searched
+/// multiplier gives a collision free slot for every key, lookup is a
+/// multiply, a shift and one compare
+template <typename Entry, std::size_t N>
+class PerfectHashMap {
+public:
+  consteval explicit PerfectHashMap(const std::array<Entry, N> &entries)
+    : m_Entries{entries} {
+    for (std::uint64_t attempt{0}; attempt < MAX_ATTEMPTS; ++attempt) {
+      m_Multiplier = (SEED + attempt * 2) | 1;
+      if (try_fill())
+        return;
+    }
+    throw "PerfectHashMap: no collision free multiplier, duplicate hash?";
+  }
+
+  [[nodiscard]] constexpr const Entry *find(
+      std::uint64_t hash) const noexcept {
+    const auto index{m_Slots[slot(hash)]};
+    if (index == EMPTY || m_Entries[index].hash != hash)
+      return nullptr;
+    return &m_Entries[index];
+  }
+
+  [[nodiscard]] constexpr const std::array<Entry, N> &
+  entries() const noexcept {
+    return m_Entries;
+  }
+
+  [[nodiscard]] static constexpr std::size_t table_size() noexcept {
+    return SIZE;
+  }
+
+private:
+  // load factor <= 0.5 keeps the search short
+  static constexpr std::size_t SIZE{
+      std::bit_ceil(std::max<std::size_t>(N * 2, 2))};
+  static constexpr int BITS{std::countr_zero(SIZE)};
+  static constexpr std::uint16_t EMPTY{
+      std::numeric_limits<std::uint16_t>::max()};
+  static constexpr std::uint64_t SEED{0x9E3779B97F4A7C15ULL};
+  static constexpr std::uint64_t MAX_ATTEMPTS{1 << 16};
+
+  static_assert(N < EMPTY);
+
+  [[nodiscard]] constexpr std::size_t slot(std::uint64_t hash) const noexcept {
+    return static_cast<std::size_t>((hash * m_Multiplier) >> (64 - BITS));
+  }
+
+  constexpr bool try_fill() {
+    m_Slots.fill(EMPTY);
+    for (std::size_t i{0}; i < N; ++i) {
+      auto &target{m_Slots[slot(m_Entries[i].hash)]};
+      if (target != EMPTY)
+        return false;
+      target = static_cast<std::uint16_t>(i);
+    }
+    return true;
+  }
+
+  std::array<Entry, N> m_Entries;
+  std::array<std::uint16_t, SIZE> m_Slots{};
+  std::uint64_t m_Multiplier{0};
+};
+
+// roms under roms/ known to need non default behaviour
+inline constexpr std::array KNOWN_QUIRKS{
+    QuirkDbEntry{0x6D145095732B5BF4ULL, "Space Invaders [David Winter]",
+                 {.shift_quirk = true}},
+    QuirkDbEntry{0x04068F4DEAFE8B10ULL, "Space Invaders [David Winter] (alt)",
+                 {.shift_quirk = true}},
+    QuirkDbEntry{0xE9322020B823E5A7ULL, "Blinky [Hans Christian Egeberg, 1991]",
+                 {.shift_quirk = true, .load_store_quirk = true}},
+    QuirkDbEntry{0xC728DBCF14B59E6AULL, "Blinky [Hans Christian Egeberg] (alt)",
+                 {.shift_quirk = true, .load_store_quirk = true}},
+    QuirkDbEntry{0x73EAB3FB89C0D6D3ULL, "Blitz [David Winter]",
+                 {.clip_sprites = true}},
+};
+
+inline constexpr PerfectHashMap QUIRK_DB{KNOWN_QUIRKS};
+
+[[nodiscard]] constexpr const QuirkDbEntry *find_quirks(
+    std::uint64_t rom_hash) noexcept {
+  return QUIRK_DB.find(rom_hash);
+}
+
+}
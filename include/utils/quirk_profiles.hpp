@@ -0,0 +1,86 @@
+#pragma once
+#include "quirk_db.hpp"
+#include "result.hpp"
+
+#include <charconv>
+#include <cstdint>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace chip8 {
+
+/// detected quirk profiles, one small key=value file per rom named after
+/// its content hash, e.g. profiles/6D145095732B5BF4.quirks
+class QuirkProfileStore {
+public:
+  explicit QuirkProfileStore(std::filesystem::path directory)
+    : m_Directory{std::move(directory)} {
+  }
+
+  [[nodiscard]] std::filesystem::path path_for(std::uint64_t hash) const {
+    return m_Directory / std::format("{:016X}.quirks", hash);
+  }
+
+  [[nodiscard]] std::optional<QuirkProfile> load(std::uint64_t hash) const {
+    std::ifstream file(path_for(hash));
+    if (!file)
+      return std::nullopt;
+
+    QuirkProfile profile;
+    std::string line;
+    while (std::getline(file, line)) {
+      const auto eq{line.find('=')};
+      if (eq == std::string::npos)
+        continue;
+      const std::string_view key{std::string_view{line}.substr(0, eq)};
+      const std::string_view value{std::string_view{line}.substr(eq + 1)};
+
+      if (key == "shift_quirk")
+        profile.shift_quirk = value == "1";
+      else if (key == "load_store_quirk")
+        profile.load_store_quirk = value == "1";
+      else if (key == "jump_quirk")
+        profile.jump_quirk = value == "1";
+      else if (key == "clip_sprites")
+        profile.clip_sprites = value == "1";
+      else if (key == "frequency_hz")
+        std::from_chars(value.data(), value.data() + value.size(),
+                        profile.frequency_hz);
+    }
+    return profile;
+  }
+
+  Result<void> save(std::uint64_t hash, const QuirkProfile &profile) const {
+    std::error_code ec;
+    std::filesystem::create_directories(m_Directory, ec);
+    if (ec)
+      return Error::io(std::format("Failed to create {}: {}",
+                                   m_Directory.string(), ec.message()));
+
+    const auto path{path_for(hash)};
+    std::ofstream file(path, std::ios::trunc);
+    if (!file)
+      return Error::io(std::format("Failed to open file: {}", path.string()));
+
+    file << std::format("shift_quirk={:d}\n"
+                        "load_store_quirk={:d}\n"
+                        "jump_quirk={:d}\n"
+                        "clip_sprites={:d}\n"
+                        "frequency_hz={}\n",
+                        profile.shift_quirk, profile.load_store_quirk,
+                        profile.jump_quirk, profile.clip_sprites,
+                        profile.frequency_hz);
+    if (!file)
+      return Error::io("Failed to write quirk profile");
+    return Ok();
+  }
+
+private:
+  std::filesystem::path m_Directory;
+};
+
+}
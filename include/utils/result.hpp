@@ -2,9 +2,12 @@
 #include <cstdint>
 #include <format>
 #include <functional>
+#include <memory>
 #include <source_location>
+#include <stdexcept>
 #include <string>
 #include <string_view>
+#include <type_traits>
 #include <variant>
 
 
@@ -12,9 +15,12 @@ namespace chip8 {
 // for curiosity, reimplementing std::expected or rather rust's Result<T,E> type
 // why not?
 
-class Error {
+/// 16 bytes and trivially copyable, so a Result<void, Fault> travels in
+/// registers. what the interpreter fails with, a code plus payload that
+/// allocates nothing, the text is only built when message() is asked for
+class Fault {
 public:
-  enum class Category {
+  enum class Category : std::uint8_t {
     None,
     IO,
     Memory,
@@ -27,16 +33,176 @@ public:
     Runtime
   };
 
-  constexpr Error() noexcept : m_Category{Category::None} {
+  enum class Code : std::uint8_t {
+    Message, // free form, only an Error carries the text
+    UnknownOpcode, // payload = opcode, address = pc
+    StackOverflow, // address = pc
+    StackUnderflow, // address = pc
+    NoKeyWaitHandler,
+    NoDrawHandler,
+    MemoryOutOfRange // payload = first address past memory, address = pc
+  };
+
+  constexpr Fault() noexcept = default;
+
+  constexpr Fault(Category category, Code code, std::uint16_t payload = 0,
+                  std::uint16_t address = 0,
+                  std::source_location loc =
+                      std::source_location::current()) noexcept
+    : m_Category{category},
+      m_Code{code},
+      m_Payload{payload},
+      m_Address{address},
+      m_Line{loc.line()} {
+  }
+
+  [[nodiscard]] static constexpr Fault unknown_opcode(
+      std::uint16_t opcode, std::uint16_t pc,
+      std::source_location loc = std::source_location::current()) noexcept {
+    return Fault{Category::InvalidOpcode, Code::UnknownOpcode, opcode, pc, loc};
+  }
+
+  [[nodiscard]] static constexpr Fault stack_overflow(
+      std::uint16_t pc,
+      std::source_location loc = std::source_location::current()) noexcept {
+    return Fault{Category::StackError, Code::StackOverflow, 0, pc, loc};
+  }
+
+  [[nodiscard]] static constexpr Fault stack_underflow(
+      std::uint16_t pc,
+      std::source_location loc = std::source_location::current()) noexcept {
+    return Fault{Category::StackError, Code::StackUnderflow, 0, pc, loc};
+  }
+
+  [[nodiscard]] static constexpr Fault memory_out_of_range(
+      std::uint16_t address, std::uint16_t pc,
+      std::source_location loc = std::source_location::current()) noexcept {
+    return Fault{Category::Memory, Code::MemoryOutOfRange, address, pc, loc};
+  }
+
+  [[nodiscard]] static constexpr Fault no_key_wait_handler(
+      std::source_location loc = std::source_location::current()) noexcept {
+    return Fault{Category::Runtime, Code::NoKeyWaitHandler, 0, 0, loc};
+  }
+
+  [[nodiscard]] static constexpr Fault no_draw_handler(
+      std::source_location loc = std::source_location::current()) noexcept {
+    return Fault{Category::Runtime, Code::NoDrawHandler, 0, 0, loc};
+  }
+
+  // accessors
+  [[nodiscard]] constexpr Category category() const noexcept {
+    return m_Category;
+  }
+
+  [[nodiscard]] constexpr Code code() const noexcept { return m_Code; }
+  [[nodiscard]] constexpr std::uint16_t payload() const noexcept {
+    return m_Payload;
+  }
+  [[nodiscard]] constexpr std::uint16_t address() const noexcept {
+    return m_Address;
+  }
+  [[nodiscard]] constexpr std::uint32_t line() const noexcept {
+    return m_Line;
+  }
+
+  /// formatted on demand
+  [[nodiscard]] std::string message() const {
+    switch (m_Code) {
+    case Code::Message:
+      break;
+    case Code::UnknownOpcode:
+      return std::format("Unknown opcode: ${:04X} at ${:03X}", m_Payload,
+                         m_Address);
+    case Code::StackOverflow:
+      return std::format("Stack overflow on CALL at ${:03X}", m_Address);
+    case Code::StackUnderflow:
+      return std::format("Stack underflow on RET at ${:03X}", m_Address);
+    case Code::NoKeyWaitHandler:
+      return "No key wait handler registered";
+    case Code::NoDrawHandler:
+      return "No draw handler registered";
+    case Code::MemoryOutOfRange:
+      return std::format("Memory access out of bounds: ${:03X} at ${:03X}",
+                         m_Payload, m_Address);
+    }
+    return is_error() ? std::format("{} error", category_string())
+                      : std::string{};
+  }
+
+  /// check if this represents an actual error
+  /// @return t/f
+  [[nodiscard]] constexpr bool is_error() const noexcept {
+    return m_Category != Category::None;
+  }
+
+  [[nodiscard]] constexpr explicit operator bool() const noexcept {
+    return is_error();
+  }
+
+  [[nodiscard]] constexpr std::string_view category_string() const noexcept {
+    switch (m_Category) {
+    case Category::None:
+      return "None";
+    case Category::IO:
+      return "IO";
+    case Category::Memory:
+      return "Memory";
+    case Category::InvalidOpcode:
+      return "Opcode";
+    case Category::StackError:
+      return "Stack";
+    case Category::Config:
+      return "Config";
+    case Category::Graphics:
+      return "Graphics";
+    case Category::Audio:
+      return "Audio";
+    case Category::Input:
+      return "Input";
+    case Category::Runtime:
+      return "Runtime";
+    }
+    return "Unknown";
+  }
+
+  [[nodiscard]] std::string format() const {
+    if (!is_error())
+      return "No error";
+    return std::format("[{}] {} (line {})", category_string(), message(),
+                       m_Line);
+  }
+
+private:
+  Category m_Category{Category::None};
+  Code m_Code{Code::Message};
+  std::uint16_t m_Payload{0};
+  std::uint16_t m_Address{0};
+  std::uint16_t m_Reserved{0};
+  std::uint32_t m_Line{0};
+  std::uint32_t m_Reserved_line{0};
+};
+
+static_assert(sizeof(Fault) == 16);
+static_assert(std::is_trivially_copyable_v<Fault>);
+
+/// the error of everything outside the interpreter. a Fault converts to it
+/// without allocating, free form text is owned and shared between copies
+class Error {
+public:
+  using Category = Fault::Category;
+  using Code = Fault::Code;
+
+  Error() noexcept = default;
+
+  Error(Fault fault) noexcept : m_Fault{fault} {
   }
 
   Error(Category category, std::string message,
         std::source_location loc = std::source_location::current())
-    : m_Category{category},
-      m_Message{std::move(message)},
-      m_File{loc.file_name()},
-      m_Function{loc.function_name()},
-      m_Line{loc.line()} {
+    : m_Fault{category, Code::Message, 0, 0, loc},
+      m_Detail{std::make_shared<const Detail>(Detail{
+          std::move(message), loc.file_name(), loc.function_name()})} {
   }
 
   // factory for categories
@@ -95,76 +261,60 @@ public:
   }
 
   // accessors
-  [[nodiscard]] constexpr Category category() const noexcept {
-    return m_Category;
+  [[nodiscard]] Category category() const noexcept {
+    return m_Fault.category();
+  }
+
+  [[nodiscard]] Code code() const noexcept { return m_Fault.code(); }
+  [[nodiscard]] std::uint16_t payload() const noexcept {
+    return m_Fault.payload();
+  }
+  [[nodiscard]] std::uint16_t address() const noexcept {
+    return m_Fault.address();
   }
 
-  [[nodiscard]] const std::string &message() const noexcept {
-    return m_Message;
+  [[nodiscard]] std::string message() const {
+    return m_Detail ? m_Detail->message : m_Fault.message();
   }
 
+  /// only known for free form messages
   [[nodiscard]] std::string_view file() const noexcept {
-    return m_File;
+    return m_Detail ? m_Detail->file : std::string_view{};
   }
 
   [[nodiscard]] std::string_view function() const noexcept {
-    return m_Function;
+    return m_Detail ? m_Detail->function : std::string_view{};
   }
 
-  [[nodiscard]] constexpr std::uint32_t line() const noexcept {
-    return m_Line;
-  }
+  [[nodiscard]] std::uint32_t line() const noexcept { return m_Fault.line(); }
 
   /// check if this represents an actual error
   /// @return t/f
-  [[nodiscard]] constexpr bool is_error() const noexcept {
-    return m_Category != Category::None;
-  }
+  [[nodiscard]] bool is_error() const noexcept { return m_Fault.is_error(); }
 
-  [[nodiscard]] constexpr explicit operator bool() const noexcept {
-    return is_error();
-  }
+  [[nodiscard]] explicit operator bool() const noexcept { return is_error(); }
 
-  [[nodiscard]] constexpr std::string_view category_string() const noexcept {
-    switch (m_Category) {
-    case Category::None:
-      return "None";
-    case Category::IO:
-      return "IO";
-    case Category::Memory:
-      return "Memory";
-    case Category::InvalidOpcode:
-      return "Opcode";
-    case Category::StackError:
-      return "Stack";
-    case Category::Config:
-      return "Config";
-    case Category::Graphics:
-      return "Graphics";
-    case Category::Audio:
-      return "Audio";
-    case Category::Input:
-      return "Input";
-    case Category::Runtime:
-      return "Runtime";
-    }
-    return "Unknown";
+  [[nodiscard]] std::string_view category_string() const noexcept {
+    return m_Fault.category_string();
   }
 
   [[nodiscard]] std::string format() const {
-    if (!is_error())
-      return "No error";
-
-    return std::format("[{}] {} ({}:{} in {})", category_string(), m_Message,
-                       m_File, m_Line, m_Function);
+    if (!m_Detail)
+      return m_Fault.format();
+    return std::format("[{}] {} ({}:{} in {})", category_string(),
+                       m_Detail->message, m_Detail->file, line(),
+                       m_Detail->function);
   }
 
 private:
-  Category m_Category;
-  std::string m_Message;
-  std::string_view m_File;
-  std::string_view m_Function;
-  std::uint32_t m_Line{0};
+  struct Detail {
+    std::string message;
+    std::string_view file;
+    std::string_view function;
+  };
+
+  Fault m_Fault;
+  std::shared_ptr<const Detail> m_Detail;
 };
 
 template <typename T, typename E = Error>
@@ -385,9 +535,21 @@ private:
   std::variant<T, E> m_Data;
 };
 
+/// errors that know whether they are set, Result<void> then needs no flag
+/// of its own. a default constructed E has to mean no error
+template <typename E>
+concept SelfFlaggingError = std::is_trivially_copyable_v<E> &&
+                            requires(const E &e) {
+                              { e.is_error() } -> std::same_as<bool>;
+                            };
+
 // void specialization
 template <typename E>
 class Result<void, E> {
+  static constexpr bool SELF_FLAGGING{SelfFlaggingError<E>};
+  struct NoFlag {
+  };
+
 public:
   struct success_tag {
   };
@@ -395,25 +557,43 @@ public:
   struct error_tag {
   };
 
-  Result() : m_Has_error{} {
+  constexpr Result() noexcept(SELF_FLAGGING) {
+  }
+
+  constexpr Result(success_tag) noexcept(SELF_FLAGGING) {
   }
 
-  Result(success_tag) : m_Has_error{false} {
+  constexpr Result(E error) : m_Error{std::move(error)} {
+    set_error();
   }
 
-  Result(E error) : m_Error{std::move(error)}, m_Has_error{true} {
+  constexpr Result(error_tag, E error) : m_Error{std::move(error)} {
+    set_error();
   }
 
-  Result(error_tag, E error) : m_Error{std::move(error)}, m_Has_error{true} {
+  /// widens a Result<void, Fault> into one that carries an Error
+  template <typename G>
+    requires(!std::same_as<G, E> && std::convertible_to<const G &, E>)
+  constexpr Result(const Result<void, G> &other) {
+    if (other.is_err()) {
+      m_Error = other.error();
+      set_error();
+    }
   }
 
-  [[nodiscard]] constexpr bool is_ok() const noexcept { return !m_Has_error; }
-  [[nodiscard]] constexpr bool is_err() const noexcept { return m_Has_error; }
+  // for Error this is one byte compare
+  [[nodiscard]] constexpr bool is_err() const noexcept {
+    if constexpr (SELF_FLAGGING)
+      return m_Error.is_error();
+    else
+      return m_Has_error;
+  }
+  [[nodiscard]] constexpr bool is_ok() const noexcept { return !is_err(); }
 
   constexpr explicit operator bool() const noexcept { return is_ok(); }
 
   [[nodiscard]] E &error() & {
-    if (!m_Has_error)
+    if (is_ok())
       throw std::runtime_error(
           "Attempted to access error of successful Result");
 
@@ -421,7 +601,7 @@ public:
   }
 
   [[nodiscard]] const E &error() const & {
-    if (!m_Has_error)
+    if (is_ok())
       throw std::runtime_error(
           "Attempted to access error of successful Result");
     return m_Error;
@@ -446,10 +626,21 @@ public:
   }
 
 private:
-  E m_Error;
-  bool m_Has_error;
+  constexpr void set_error() noexcept {
+    if constexpr (!SELF_FLAGGING)
+      m_Has_error = true;
+  }
+
+  E m_Error{};
+  [[no_unique_address]] std::conditional_t<SELF_FLAGGING, NoFlag, bool>
+      m_Has_error{};
 };
 
+/// what the interpreter returns for every instruction and frame
+using StepResult = Result<void, Fault>;
+
+static_assert(sizeof(StepResult) == sizeof(Fault));
+
 // Factory
 // success result
 template <typename T>
@@ -457,8 +648,8 @@ template <typename T>
   return Result<std::decay_t<T>>{std::forward<T>(value)};
 }
 
-// void success result
-[[nodiscard]] inline auto Ok() { return Result<void>{}; };
+// void success result, converts to a Result<void> of any error
+[[nodiscard]] constexpr StepResult Ok() noexcept { return StepResult{}; };
 
 // error result
 template <typename T, typename E>
@@ -0,0 +1,404 @@
+#pragma once
+#include "hash.hpp"
+#include "logger.hpp"
+#include "mapped_file.hpp"
+#include "result.hpp"
+#include "rom_loader.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <charconv>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace chip8 {
+
+enum class RomPlatform : std::uint8_t {
+  Chip8, // 64x32
+  VipHires // 64x64 two page display patch for the COSMAC VIP
+};
+
+[[nodiscard]] constexpr std::string_view rom_platform_string(
+    RomPlatform platform) noexcept {
+  switch (platform) {
+  case RomPlatform::Chip8:
+    return "chip8";
+  case RomPlatform::VipHires:
+    return "hires";
+  }
+  return "unknown";
+}
+
+/// hires ROMs start with JP 0x260, skipping the interpreter patch that sits
+/// at 0x200
+[[nodiscard]] constexpr RomPlatform detect_platform(
+    std::span<const Byte> rom) noexcept {
+  if (rom.size() >= 2 && rom[0] == 0x12 && rom[1] == 0x60)
+    return RomPlatform::VipHires;
+  return RomPlatform::Chip8;
+}
+
+struct CatalogEntry {
+  std::string path; // relative to the catalog root, '/' separated
+  std::uint64_t size{0};
+  std::int64_t mtime{0}; // file clock ticks, only compared for equality
+  std::uint64_t hash{0}; // xxh64 of the contents
+  RomPlatform platform{RomPlatform::Chip8};
+  std::string description; // paired .txt file, empty if there is none
+};
+
+struct CatalogScanStats {
+  std::size_t reused{0}; // size and mtime matched the index
+  std::size_t hashed{0};
+  std::size_t failed{0};
+  bool index_written{false};
+};
+
+/// every ROM under a directory with its content hash and metadata.
+/// hashing runs in parallel and results are kept in an index file, so a
+/// warm start only stats the files
+class RomCatalog {
+public:
+  static constexpr std::string_view INDEX_HEADER{"chip8-catalog\t1"};
+  static constexpr std::string_view DEFAULT_INDEX_NAME{".chip8-catalog"};
+
+  /// walk root recursively. with an index_path, entries whose size and mtime
+  /// still match are reused and the index is rewritten if anything changed.
+  /// threads = 0 uses the hardware concurrency
+  static Result<RomCatalog> scan(const std::filesystem::path &root,
+                                 const std::filesystem::path &index_path = {},
+                                 unsigned threads = 0) {
+    std::error_code ec;
+    if (!std::filesystem::is_directory(root, ec))
+      return Result<RomCatalog>{
+          Error::io(std::format("Not a directory: {}", root.string()))};
+
+    std::vector<CatalogEntry> cached;
+    if (!index_path.empty()) {
+      if (auto index{load_index(index_path)})
+        cached = std::move(index).value();
+    }
+    std::unordered_map<std::string_view, const CatalogEntry *> by_path;
+    by_path.reserve(cached.size());
+    for (const auto &entry : cached)
+      by_path.emplace(entry.path, &entry);
+
+    RomCatalog catalog;
+    catalog.m_Root = root;
+
+    // stat pass, single threaded, the directory walk is the cheap part
+    std::vector<CatalogEntry> pending;
+    for (auto it{std::filesystem::recursive_directory_iterator(root, ec)};
+         !ec && it != std::filesystem::recursive_directory_iterator{};
+         it.increment(ec)) {
+      const auto &file{*it};
+      if (!file.is_regular_file(ec) ||
+          !RomLoader::is_supported_extension(file.path()))
+        continue;
+
+      CatalogEntry entry{
+          .path = file.path().lexically_relative(root).generic_string(),
+          .size = file.file_size(ec),
+          .mtime = file.last_write_time(ec).time_since_epoch().count()};
+      if (ec) {
+        ++catalog.m_Stats.failed;
+        ec.clear();
+        continue;
+      }
+
+      const auto hit{by_path.find(entry.path)};
+      if (hit != by_path.end() && hit->second->size == entry.size &&
+          hit->second->mtime == entry.mtime) {
+        catalog.m_Entries.push_back(*hit->second);
+        ++catalog.m_Stats.reused;
+      } else {
+        pending.push_back(std::move(entry));
+      }
+    }
+    if (ec)
+      return Result<RomCatalog>{
+          Error::io(std::format("Failed to scan {}: {}", root.string(),
+                                ec.message()))};
+
+    // anything hashed or anything gone since the index was written
+    const bool changed{!pending.empty() ||
+                       catalog.m_Entries.size() != cached.size()};
+    hash_all(root, pending, threads);
+    for (auto &entry : pending) {
+      if (entry.size == 0) { // failed to read, see hash_all
+        ++catalog.m_Stats.failed;
+        continue;
+      }
+      catalog.m_Entries.push_back(std::move(entry));
+      ++catalog.m_Stats.hashed;
+    }
+
+    catalog.build_lookup();
+
+    if (!index_path.empty() && changed) {
+      if (auto result{catalog.save_index(index_path)}; !result)
+        LOG_WARNING("Catalog index not written: {}",
+                    result.error().message());
+      else
+        catalog.m_Stats.index_written = true;
+    }
+    return Result<RomCatalog>{std::move(catalog)};
+  }
+
+  [[nodiscard]] const std::vector<CatalogEntry> &entries() const noexcept {
+    return m_Entries;
+  }
+
+  [[nodiscard]] std::size_t size() const noexcept { return m_Entries.size(); }
+
+  [[nodiscard]] const std::filesystem::path &root() const noexcept {
+    return m_Root;
+  }
+
+  [[nodiscard]] const CatalogScanStats &stats() const noexcept {
+    return m_Stats;
+  }
+
+  [[nodiscard]] std::filesystem::path full_path(
+      const CatalogEntry &entry) const {
+    return m_Root / entry.path;
+  }
+
+  /// O(log n), entries are sorted by path
+  [[nodiscard]] const CatalogEntry *find_by_path(std::string_view path) const {
+    const auto it{std::ranges::lower_bound(m_Entries, path, {},
+                                           &CatalogEntry::path)};
+    return it != m_Entries.end() && it->path == path ? &*it : nullptr;
+  }
+
+  /// O(log n), first entry with this content hash
+  [[nodiscard]] const CatalogEntry *find_by_hash(std::uint64_t hash) const {
+    const auto it{std::ranges::lower_bound(
+        m_By_hash, hash, {},
+        [this](std::uint32_t i) { return m_Entries[i].hash; })};
+    return it != m_By_hash.end() && m_Entries[*it].hash == hash
+             ? &m_Entries[*it]
+             : nullptr;
+  }
+
+  /// one entry per line, tab separated, text fields escaped
+  [[nodiscard]] std::string serialize() const {
+    std::string out{INDEX_HEADER};
+    out += '\n';
+    for (const auto &entry : m_Entries) {
+      append_escaped(out, entry.path);
+      std::format_to(std::back_inserter(out), "\t{}\t{}\t{:016X}\t{}\t",
+                     entry.size, entry.mtime, entry.hash,
+                     static_cast<int>(entry.platform));
+      append_escaped(out, entry.description);
+      out += '\n';
+    }
+    return out;
+  }
+
+  Result<void> save_index(const std::filesystem::path &path) const {
+    // write then rename, a crash never leaves a torn index behind
+    auto tmp{path};
+    tmp += ".tmp";
+    {
+      std::ofstream file(tmp, std::ios::binary | std::ios::trunc);
+      if (!file)
+        return Error::io(std::format("Failed to open file: {}", tmp.string()));
+      const auto text{serialize()};
+      file.write(text.data(), static_cast<std::streamsize>(text.size()));
+      if (!file)
+        return Error::io("Failed to write catalog index");
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tmp, path, ec);
+    if (ec)
+      return Error::io(std::format("Failed to replace {}: {}", path.string(),
+                                   ec.message()));
+    return Ok();
+  }
+
+  static Result<std::vector<CatalogEntry>> load_index(
+      const std::filesystem::path &path) {
+    auto file{MappedFile::open(path)};
+    if (!file)
+      return Result<std::vector<CatalogEntry>>{file.error()};
+    return parse_index(std::string_view{
+        reinterpret_cast<const char *>(file->data()), file->size()});
+  }
+
+  static Result<std::vector<CatalogEntry>> parse_index(std::string_view text) {
+    using R = Result<std::vector<CatalogEntry>>;
+
+    auto line{next_token(text, '\n')};
+    if (line != INDEX_HEADER)
+      return R{Error::io("Catalog index has an unknown format")};
+
+    std::vector<CatalogEntry> entries;
+    while (!text.empty()) {
+      line = next_token(text, '\n');
+      if (line.empty())
+        continue;
+
+      CatalogEntry entry;
+      int platform{0};
+      const auto path{next_token(line, '\t')};
+      const bool ok{parse_number(next_token(line, '\t'), entry.size) &&
+                    parse_number(next_token(line, '\t'), entry.mtime) &&
+                    parse_number(next_token(line, '\t'), entry.hash, 16) &&
+                    parse_number(next_token(line, '\t'), platform) &&
+                    platform <= static_cast<int>(RomPlatform::VipHires)};
+      if (!ok || path.empty())
+        return R{Error::io("Catalog index is corrupt")};
+
+      entry.path = unescape(path);
+      entry.platform = static_cast<RomPlatform>(platform);
+      entry.description = unescape(line);
+      entries.push_back(std::move(entry));
+    }
+    return R{std::move(entries)};
+  }
+
+private:
+  /// fills hash, platform and description of every entry, entries that can
+  /// not be read get size 0
+  static void hash_all(const std::filesystem::path &root,
+                              std::vector<CatalogEntry> &entries,
+                              unsigned threads) {
+    if (entries.empty())
+      return;
+
+    if (threads == 0)
+      threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = static_cast<unsigned>(
+        std::min<std::size_t>(threads, entries.size()));
+
+    // workers claim entries one at a time and only touch their own slot
+    std::atomic<std::size_t> next{0};
+    const auto worker{[&] {
+      for (std::size_t i{next.fetch_add(1, std::memory_order_relaxed)};
+           i < entries.size();
+           i = next.fetch_add(1, std::memory_order_relaxed))
+        hash_entry(root, entries[i]);
+    }};
+
+    {
+      std::vector<std::jthread> pool;
+      pool.reserve(threads - 1);
+      for (unsigned t{1}; t < threads; ++t)
+        pool.emplace_back(worker);
+      worker();
+    }
+  }
+
+  static void hash_entry(const std::filesystem::path &root,
+                         CatalogEntry &entry) {
+    const auto path{root / entry.path};
+    auto file{MappedFile::open(path)};
+    if (!file || file->empty()) {
+      entry.size = 0;
+      return;
+    }
+
+    const auto bytes{file->bytes()};
+    entry.size = bytes.size();
+    entry.hash = rom_hash(bytes);
+    entry.platform = detect_platform(bytes);
+
+    auto notes_path{path};
+    notes_path.replace_extension(".txt");
+    if (auto notes{MappedFile::open(notes_path)}) {
+      std::string_view text{reinterpret_cast<const char *>(notes->data()),
+                            notes->size()};
+      while (!text.empty() && std::isspace(static_cast<unsigned char>(
+                                  text.back())))
+        text.remove_suffix(1);
+      entry.description = text;
+    }
+  }
+
+  void build_lookup() {
+    std::ranges::sort(m_Entries, {}, &CatalogEntry::path);
+    m_By_hash.resize(m_Entries.size());
+    for (std::uint32_t i{0}; i < m_By_hash.size(); ++i)
+      m_By_hash[i] = i;
+    std::ranges::stable_sort(m_By_hash, {}, [this](std::uint32_t i) {
+      return m_Entries[i].hash;
+    });
+  }
+
+  static std::string_view next_token(std::string_view &text, char delim) {
+    const auto pos{text.find(delim)};
+    const auto token{text.substr(0, pos)};
+    text.remove_prefix(pos == std::string_view::npos ? text.size() : pos + 1);
+    return token;
+  }
+
+  template <typename T>
+  static bool parse_number(std::string_view text, T &value, int base = 10) {
+    const auto [ptr, ec]{std::from_chars(text.data(), text.data() + text.size(),
+                                         value, base)};
+    return ec == std::errc{} && ptr == text.data() + text.size();
+  }
+
+  static void append_escaped(std::string &out, std::string_view text) {
+    for (const char c : text) {
+      switch (c) {
+      case '\\':
+        out += "\\\\";
+        break;
+      case '\t':
+        out += "\\t";
+        break;
+      case '\n':
+        out += "\\n";
+        break;
+      case '\r':
+        out += "\\r";
+        break;
+      default:
+        out += c;
+      }
+    }
+  }
+
+  static std::string unescape(std::string_view text) {
+    std::string out;
+    out.reserve(text.size());
+    for (std::size_t i{0}; i < text.size(); ++i) {
+      if (text[i] != '\\' || i + 1 == text.size()) {
+        out += text[i];
+        continue;
+      }
+      switch (text[++i]) {
+      case 't':
+        out += '\t';
+        break;
+      case 'n':
+        out += '\n';
+        break;
+      case 'r':
+        out += '\r';
+        break;
+      default:
+        out += text[i];
+      }
+    }
+    return out;
+  }
+
+  std::filesystem::path m_Root;
+  std::vector<CatalogEntry> m_Entries;
+  std::vector<std::uint32_t> m_By_hash; // entry indices sorted by hash
+  CatalogScanStats m_Stats;
+};
+
+}
@@ -1,34 +1,65 @@
 #pragma once
+#include "embedded_roms.hpp"
+#include "mapped_file.hpp"
 #include "result.hpp"
 #include "core/types.hpp"
+#include "profiling/zones.hpp"
 
 #include <filesystem>
-#include <fstream>
 #include <string_view>
+#include <system_error>
 #include <vector>
 
 namespace chip8 {
 
+/// rom image, either an owned buffer or a read-only mapping of the file
 class RomData {
 public:
   RomData() = default;
 
   explicit RomData(std::vector<Byte> data) : m_Data{std::move(data)} {
+    m_View = m_Data;
   }
 
-  const Byte *data() const noexcept { return m_Data.data(); }
-  std::size_t size() const noexcept { return m_Data.size(); }
-  bool empty() const noexcept { return m_Data.empty(); }
+  explicit RomData(MappedFile mapping) : m_Mapping{std::move(mapping)} {
+    m_View = m_Mapping.bytes();
+  }
+
+  RomData(const RomData &) = delete;
+  RomData &operator=(const RomData &) = delete;
+
+  RomData(RomData &&other) noexcept { *this = std::move(other); }
 
-  std::span<const Byte> as_span() const noexcept {
-    return std::span<const Byte>(m_Data);
+  RomData &operator=(RomData &&other) noexcept {
+    if (this == &other)
+      return *this;
+    m_Data = std::move(other.m_Data);
+    m_Mapping = std::move(other.m_Mapping);
+    m_View = m_Mapping.empty() ? std::span<const Byte>{m_Data}
+                               : m_Mapping.bytes();
+    other.m_View = {};
+    return *this;
   }
 
-  auto begin() noexcept { return m_Data.begin(); }
-  auto end() noexcept { return m_Data.end(); }
+  const Byte *data() const noexcept { return m_View.data(); }
+  std::size_t size() const noexcept { return m_View.size(); }
+  bool empty() const noexcept { return m_View.empty(); }
+  bool is_mapped() const noexcept { return !m_Mapping.empty(); }
+
+  std::span<const Byte> as_span() const noexcept { return m_View; }
+
+  auto begin() const noexcept { return m_View.begin(); }
+  auto end() const noexcept { return m_View.end(); }
+
+  /// copy into an owned buffer, so the file can go away
+  [[nodiscard]] RomData to_owned() const {
+    return RomData{std::vector<Byte>(m_View.begin(), m_View.end())};
+  }
 
 private:
   std::vector<Byte> m_Data;
+  MappedFile m_Mapping;
+  std::span<const Byte> m_View;
 };
 
 
@@ -39,12 +70,14 @@ public:
   static constexpr std::array<std::string_view, 4> SUPPORTED_EXTENSIONS{
       {".ch8", ".c8", ".rom", ".bin"}};
 
+  /// map the rom read-only, the span handed out points into the page cache
   static Result<RomData> load(const std::filesystem::path &path) {
-    if (!std::filesystem::exists(path))
-      return Result<RomData>{
-          Error::io(std::format("File not found: {}", path.string()))};
+    CHIP8_ZONE("RomLoader::load");
+    auto mapping{MappedFile::open(path)};
+    if (!mapping)
+      return Result<RomData>{mapping.error()};
 
-    const auto file_size{std::filesystem::file_size(path)};
+    const auto file_size{mapping->size()};
     if (file_size == 0)
       return Result<RomData>{Error::io("ROM file is empty")};
     if (file_size > MAX_ROM_SIZE)
@@ -52,19 +85,16 @@ public:
           Error::io(std::format("ROM too large: {} bytes (max: {} bytes)",
                                 file_size, MAX_ROM_SIZE))};
 
-    std::ifstream file(path, std::ios::binary);
-    if (!file)
-      return Result<RomData>{
-          Error::io(std::format("Failed to open file: {}", path.string()))};
-
-    std::vector<Byte> data(file_size);
-    file.read(reinterpret_cast<char *>(data.data()),
-              static_cast<std::streamsize>(file_size));
-
-    if (!file)
-      return Result<RomData>{Error::io("Failed to read ROM data")};
+    return Result<RomData>{RomData{std::move(mapping).value()}};
+  }
 
-    return Result<RomData>{RomData{std::move(data)}};
+  /// rom compiled into the binary, never touches the filesystem
+  static std::optional<EmbeddedRom> find_embedded(
+      const std::filesystem::path &path) {
+    if constexpr (EMBEDDED_ROMS.empty())
+      return std::nullopt;
+    else
+      return find_embedded_rom(path.generic_string());
   }
 
   static Result<RomData> load(const std::string &path) {
@@ -95,10 +125,12 @@ public:
     RomInfo info{};
     info.filename = path.filename().string();
     info.valid = false;
-    if (!std::filesystem::exists(path))
+    std::error_code ec;
+    const auto size{std::filesystem::file_size(path, ec)};
+    if (ec)
       return info;
 
-    info.size_bytes = std::filesystem::file_size(path);
+    info.size_bytes = size;
     info.instruction_cound = info.size_bytes / 2;
     info.valid = info.size_bytes > 0 && info.size_bytes <= MAX_ROM_SIZE;
 
@@ -0,0 +1,340 @@
+#pragma once
+#include "hash.hpp"
+#include "mapped_file.hpp"
+#include "result.hpp"
+#include "rom_catalog.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace chip8 {
+
+// on disk layout, all integers little endian:
+//   PackHeader
+//   PackEntry[count]          sorted by hash
+//   uint32_t[count]           entry indices sorted by name
+//   names                     concatenated, not terminated
+//   rom data                  every rom starts on a 16 byte boundary
+static_assert(std::endian::native == std::endian::little,
+              "rom packs are read in place");
+
+struct PackHeader {
+  char magic[4];
+  std::uint32_t version;
+  std::uint32_t count;
+  std::uint32_t names_offset;
+  std::uint32_t names_size;
+  std::uint32_t data_offset;
+  std::uint64_t file_size;
+};
+
+struct PackEntry {
+  std::uint64_t hash;
+  std::uint32_t data_offset;
+  std::uint32_t size;
+  std::uint32_t name_offset; // relative to names_offset
+  std::uint16_t name_length;
+  RomPlatform platform;
+  std::uint8_t reserved;
+};
+
+static_assert(sizeof(PackHeader) == 32);
+static_assert(sizeof(PackEntry) == 24);
+
+struct PackedRom {
+  std::string_view name;
+  std::uint64_t hash;
+  RomPlatform platform;
+  std::span<const Byte> data; // points into the mapping
+};
+
+/// many roms in one read-only mapped file. lookups are binary searches over
+/// the index in place, opening a pack costs one open/fstat/mmap in total
+class RomPack {
+public:
+  static constexpr char MAGIC[4]{'C', '8', 'P', 'K'};
+  static constexpr std::uint32_t VERSION{1};
+  static constexpr std::size_t DATA_ALIGNMENT{16};
+
+  static Result<RomPack> open(const std::filesystem::path &path) {
+    auto file{MappedFile::open(path)};
+    if (!file)
+      return Result<RomPack>{file.error()};
+
+    RomPack pack;
+    pack.m_File = std::move(file).value();
+    if (auto result{pack.validate()}; !result)
+      return Result<RomPack>{Error::io(std::format(
+          "{}: {}", path.string(), result.error().message()))};
+    return Result<RomPack>{std::move(pack)};
+  }
+
+  [[nodiscard]] std::size_t size() const noexcept { return m_Count; }
+
+  [[nodiscard]] PackedRom operator[](std::size_t i) const noexcept {
+    return to_rom(entry(i));
+  }
+
+  /// exact match on the name the rom was packed under, e.g. "games/Pong.ch8"
+  [[nodiscard]] std::optional<PackedRom> find_by_name(
+      std::string_view name) const noexcept {
+    std::size_t lo{0};
+    std::size_t hi{m_Count};
+    while (lo < hi) {
+      const auto mid{lo + (hi - lo) / 2};
+      const auto &candidate{entry(name_order(mid))};
+      const auto cmp{entry_name(candidate).compare(name)};
+      if (cmp == 0)
+        return to_rom(candidate);
+      if (cmp < 0)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+    return std::nullopt;
+  }
+
+  [[nodiscard]] std::optional<PackedRom> find_by_hash(
+      std::uint64_t hash) const noexcept {
+    std::size_t lo{0};
+    std::size_t hi{m_Count};
+    while (lo < hi) {
+      const auto mid{lo + (hi - lo) / 2};
+      if (entry(mid).hash < hash)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+    if (lo < m_Count && entry(lo).hash == hash)
+      return to_rom(entry(lo));
+    return std::nullopt;
+  }
+
+private:
+  Result<void> validate() {
+    const auto bytes{m_File.bytes()};
+    if (bytes.size() < sizeof(PackHeader))
+      return Error::io("not a rom pack");
+
+    PackHeader header;
+    std::memcpy(&header, bytes.data(), sizeof(header));
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0)
+      return Error::io("not a rom pack");
+    if (header.version != VERSION)
+      return Error::io(std::format("unsupported pack version {}",
+                                   header.version));
+    if (header.file_size != bytes.size())
+      return Error::io("pack is truncated");
+
+    const std::uint64_t index_end{sizeof(PackHeader) +
+                                  std::uint64_t{header.count} *
+                                  (sizeof(PackEntry) + sizeof(std::uint32_t))};
+    if (index_end > header.names_offset ||
+        std::uint64_t{header.names_offset} + header.names_size >
+        header.data_offset ||
+        header.data_offset > bytes.size())
+      return Error::io("pack index is corrupt");
+
+    m_Count = header.count;
+    m_Names_offset = header.names_offset;
+
+    // check every entry once here so lookups can skip bounds checks
+    for (std::size_t i{0}; i < m_Count; ++i) {
+      const auto &e{entry(i)};
+      if (e.data_offset < header.data_offset ||
+          std::uint64_t{e.data_offset} + e.size > bytes.size() ||
+          std::uint64_t{e.name_offset} + e.name_length > header.names_size ||
+          name_order(i) >= m_Count)
+        return Error::io("pack index is corrupt");
+    }
+    return Ok();
+  }
+
+  // the index is 8 byte aligned within a page aligned mapping
+  [[nodiscard]] const PackEntry &entry(std::size_t i) const noexcept {
+    return reinterpret_cast<const PackEntry *>(
+        m_File.data() + sizeof(PackHeader))[i];
+  }
+
+  [[nodiscard]] std::uint32_t name_order(std::size_t i) const noexcept {
+    return reinterpret_cast<const std::uint32_t *>(
+        m_File.data() + sizeof(PackHeader) + m_Count * sizeof(PackEntry))[i];
+  }
+
+  [[nodiscard]] std::string_view entry_name(
+      const PackEntry &e) const noexcept {
+    return {reinterpret_cast<const char *>(m_File.data()) + m_Names_offset +
+            e.name_offset,
+            e.name_length};
+  }
+
+  [[nodiscard]] PackedRom to_rom(const PackEntry &e) const noexcept {
+    return PackedRom{
+        .name = entry_name(e),
+        .hash = e.hash,
+        .platform = e.platform,
+        .data = m_File.bytes().subspan(e.data_offset, e.size)};
+  }
+
+  MappedFile m_File;
+  std::size_t m_Count{0};
+  std::uint32_t m_Names_offset{0};
+};
+
+/// collects roms in memory and writes a pack in one go
+class RomPackWriter {
+public:
+  void add(std::string name, std::span<const Byte> data) {
+    m_Roms.push_back(Pending{
+        .name = std::move(name),
+        .data = {data.begin(), data.end()},
+        .hash = rom_hash(data),
+        .platform = detect_platform(data)});
+  }
+
+  [[nodiscard]] std::size_t size() const noexcept { return m_Roms.size(); }
+
+  /// every rom from the catalog, named by its path relative to the root
+  Result<void> add_catalog(const RomCatalog &catalog) {
+    for (const auto &entry : catalog.entries()) {
+      auto file{MappedFile::open(catalog.full_path(entry))};
+      if (!file)
+        return file.error();
+      add(entry.path, file->bytes());
+    }
+    return Ok();
+  }
+
+  Result<void> write(const std::filesystem::path &path) {
+    std::ranges::sort(m_Roms, {}, &Pending::hash);
+
+    std::vector<std::uint32_t> by_name(m_Roms.size());
+    for (std::uint32_t i{0}; i < by_name.size(); ++i)
+      by_name[i] = i;
+    std::ranges::sort(by_name, {}, [this](std::uint32_t i) -> const auto & {
+      return m_Roms[i].name;
+    });
+    if (std::ranges::adjacent_find(by_name, {}, [this](std::uint32_t i) {
+          return std::string_view{m_Roms[i].name};
+        }) != by_name.end())
+      return Error::io("duplicate rom name in pack");
+
+    std::string names;
+    std::vector<PackEntry> entries;
+    entries.reserve(m_Roms.size());
+    for (const auto &rom : m_Roms) {
+      if (rom.name.size() > UINT16_MAX)
+        return Error::io(std::format("rom name too long: {}", rom.name));
+      entries.push_back(PackEntry{
+          .hash = rom.hash,
+          .data_offset = 0,
+          .size = static_cast<std::uint32_t>(rom.data.size()),
+          .name_offset = static_cast<std::uint32_t>(names.size()),
+          .name_length = static_cast<std::uint16_t>(rom.name.size()),
+          .platform = rom.platform,
+          .reserved = 0});
+      names += rom.name;
+    }
+
+    PackHeader header{};
+    std::memcpy(header.magic, RomPack::MAGIC, sizeof(header.magic));
+    header.version = RomPack::VERSION;
+    header.count = static_cast<std::uint32_t>(m_Roms.size());
+    header.names_offset = static_cast<std::uint32_t>(
+        sizeof(PackHeader) + entries.size() * sizeof(PackEntry) +
+        by_name.size() * sizeof(std::uint32_t));
+    header.names_size = static_cast<std::uint32_t>(names.size());
+    header.data_offset = static_cast<std::uint32_t>(
+        align(header.names_offset + names.size()));
+
+    std::uint64_t offset{header.data_offset};
+    for (std::size_t i{0}; i < entries.size(); ++i) {
+      entries[i].data_offset = static_cast<std::uint32_t>(offset);
+      offset = align(offset + entries[i].size);
+    }
+    header.file_size = offset;
+    if (offset > UINT32_MAX)
+      return Error::io("rom pack exceeds 4 GiB");
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file)
+      return Error::io(std::format("Failed to open file: {}", path.string()));
+
+    std::uint64_t written{0};
+    const auto put{[&](const void *data, std::size_t size) {
+      file.write(static_cast<const char *>(data),
+                 static_cast<std::streamsize>(size));
+      written += size;
+    }};
+    const auto pad_to{[&](std::uint64_t target) {
+      static constexpr char zeros[RomPack::DATA_ALIGNMENT]{};
+      put(zeros, static_cast<std::size_t>(target - written));
+    }};
+
+    put(&header, sizeof(header));
+    put(entries.data(), entries.size() * sizeof(PackEntry));
+    put(by_name.data(), by_name.size() * sizeof(std::uint32_t));
+    put(names.data(), names.size());
+    for (std::size_t i{0}; i < entries.size(); ++i) {
+      pad_to(entries[i].data_offset);
+      put(m_Roms[i].data.data(), m_Roms[i].data.size());
+    }
+    pad_to(header.file_size);
+
+    if (!file)
+      return Error::io("Failed to write rom pack");
+    return Ok();
+  }
+
+private:
+  struct Pending {
+    std::string name;
+    std::vector<Byte> data;
+    std::uint64_t hash;
+    RomPlatform platform;
+  };
+
+  static constexpr std::uint64_t align(std::uint64_t offset) noexcept {
+    return (offset + RomPack::DATA_ALIGNMENT - 1) &
+           ~std::uint64_t{RomPack::DATA_ALIGNMENT - 1};
+  }
+
+  std::vector<Pending> m_Roms;
+};
+
+/// by name, or by content hash given as 16 hex digits. no file is opened,
+/// the span points into the pack mapping
+inline Result<PackedRom> load_packed_rom(const RomPack &pack,
+                                         std::string_view key) {
+  auto rom{pack.find_by_name(key)};
+  if (!rom && key.size() == 16) {
+    std::uint64_t hash{0};
+    const auto [ptr, ec]{std::from_chars(key.data(), key.data() + key.size(),
+                                         hash, 16)};
+    if (ec == std::errc{} && ptr == key.data() + key.size())
+      rom = pack.find_by_hash(hash);
+  }
+
+  if (!rom)
+    return Result<PackedRom>{
+        Error::io(std::format("ROM not found in pack: {}", key))};
+  if (rom->data.empty())
+    return Result<PackedRom>{Error::io("ROM file is empty")};
+  if (rom->data.size() > RomLoader::MAX_ROM_SIZE)
+    return Result<PackedRom>{
+        Error::io(std::format("ROM too large: {} bytes (max: {} bytes)",
+                              rom->data.size(), RomLoader::MAX_ROM_SIZE))};
+  return Result<PackedRom>{*rom};
+}
+
+}
@@ -0,0 +1,132 @@
+#pragma once
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <string>
+
+namespace chip8 {
+
+enum class TimestampMode {
+  WallClock, // HH:MM:SS.mmm local time
+  Relative // +S.mmm monotonic, since the provider was created
+};
+
+/// portable localtime, localtime_s on windows and localtime_r elsewhere
+[[nodiscard]] inline std::tm local_time(std::time_t time) noexcept {
+  std::tm tm_buf{};
+#ifdef _WIN32
+  localtime_s(&tm_buf, &time);
+#else
+  localtime_r(&time, &tm_buf);
+#endif
+  return tm_buf;
+}
+
+/// log timestamps from one steady clock read per message. wall clock time is
+/// derived from a system/steady anchor and the HH:MM:SS part is only rebuilt
+/// when the second changes. not thread safe, the owner serializes access
+class TimestampProvider {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  explicit TimestampProvider(TimestampMode mode = TimestampMode::WallClock,
+                             Clock::time_point origin = Clock::now())
+    : m_Mode{mode},
+      m_Origin{origin},
+      m_Anchor_steady{Clock::now()},
+      m_Anchor_wall{std::chrono::system_clock::now()} {
+  }
+
+  [[nodiscard]] static Clock::time_point now() noexcept {
+    return Clock::now();
+  }
+
+  [[nodiscard]] TimestampMode mode() const noexcept { return m_Mode; }
+
+  void set_mode(TimestampMode mode) noexcept {
+    m_Mode = mode;
+    // re-anchor so wall clock adjustments since startup are picked up
+    m_Anchor_steady = Clock::now();
+    m_Anchor_wall = std::chrono::system_clock::now();
+    m_Cached_second = INVALID_SECOND;
+  }
+
+  /// appends the timestamp and a trailing space
+  void append(std::string &out, Clock::time_point time) {
+    if (m_Mode == TimestampMode::Relative)
+      append_relative(out, time);
+    else
+      append_wall(out, time);
+  }
+
+  /// how often the HH:MM:SS prefix had to be rebuilt
+  [[nodiscard]] std::uint64_t cache_misses() const noexcept {
+    return m_Cache_misses;
+  }
+
+private:
+  static constexpr std::int64_t INVALID_SECOND{INT64_MIN};
+
+  void append_wall(std::string &out, Clock::time_point time) {
+    using namespace std::chrono;
+
+    const auto wall{m_Anchor_wall + duration_cast<system_clock::duration>(
+                        time - m_Anchor_steady)};
+    const auto since_epoch{duration_cast<milliseconds>(
+        wall.time_since_epoch())};
+    const auto second{floor<seconds>(since_epoch)};
+
+    if (second.count() != m_Cached_second) {
+      const auto tm_buf{local_time(static_cast<std::time_t>(second.count()))};
+      write_digits(m_Cached_prefix + 0, tm_buf.tm_hour, 2);
+      m_Cached_prefix[2] = ':';
+      write_digits(m_Cached_prefix + 3, tm_buf.tm_min, 2);
+      m_Cached_prefix[5] = ':';
+      write_digits(m_Cached_prefix + 6, tm_buf.tm_sec, 2);
+      m_Cached_prefix[8] = '.';
+      m_Cached_second = second.count();
+      ++m_Cache_misses;
+    }
+
+    char ms[4];
+    write_digits(ms, static_cast<int>((since_epoch - second).count()), 3);
+    ms[3] = ' ';
+    out.append(m_Cached_prefix, sizeof(m_Cached_prefix));
+    out.append(ms, sizeof(ms));
+  }
+
+  void append_relative(std::string &out, Clock::time_point time) const {
+    using namespace std::chrono;
+
+    const auto elapsed{duration_cast<milliseconds>(time - m_Origin)};
+    const auto ms{elapsed.count() < 0 ? 0 : elapsed.count()};
+
+    char buf[32];
+    buf[0] = '+';
+    auto *end{std::to_chars(buf + 1, buf + sizeof(buf), ms / 1000).ptr};
+    *end++ = '.';
+    write_digits(end, static_cast<int>(ms % 1000), 3);
+    end += 3;
+    *end++ = ' ';
+    out.append(buf, static_cast<std::size_t>(end - buf));
+  }
+
+  static void write_digits(char *dst, int value, int width) noexcept {
+    for (int i{width - 1}; i >= 0; --i) {
+      dst[i] = static_cast<char>('0' + value % 10);
+      value /= 10;
+    }
+  }
+
+  TimestampMode m_Mode;
+  Clock::time_point m_Origin;
+  Clock::time_point m_Anchor_steady;
+  std::chrono::system_clock::time_point m_Anchor_wall;
+
+  std::int64_t m_Cached_second{INVALID_SECOND};
+  char m_Cached_prefix[9]{}; // "HH:MM:SS."
+  std::uint64_t m_Cache_misses{0};
+};
+
+}
@@ -0,0 +1,105 @@
+// replaces the global operator new and delete with counting ones, see
+// utils/alloc_counter.hpp. a translation unit of its own so the compiler
+// can't inline the operators into their callers
+#include "utils/alloc_counter.hpp"
+
+#include <cstdlib>
+#include <new>
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+namespace {
+
+[[maybe_unused]] const bool g_Registered{(chip8::detail::g_Alloc_counter_installed = true)};
+
+void *counted_alloc(std::size_t size) noexcept {
+  chip8::detail::count_allocation(size);
+  return std::malloc(size != 0 ? size : 1);
+}
+
+void *counted_alloc(std::size_t size, std::align_val_t al) noexcept {
+  chip8::detail::count_allocation(size);
+  const auto alignment{static_cast<std::size_t>(al)};
+#ifdef _WIN32
+  return _aligned_malloc(size != 0 ? size : 1, alignment);
+#else
+  // aligned_alloc wants a multiple of the alignment
+  return std::aligned_alloc(alignment,
+                            (size + alignment - 1) / alignment * alignment);
+#endif
+}
+
+/// the aligned operators' counterpart, msvcrt can't free() those
+void aligned_free(void *p) noexcept {
+#ifdef _WIN32
+  _aligned_free(p);
+#else
+  std::free(p);
+#endif
+}
+
+}
+
+void *operator new(std::size_t size) {
+  if (void *p{counted_alloc(size)})
+    return p;
+  throw std::bad_alloc{};
+}
+void *operator new[](std::size_t size) {
+  if (void *p{counted_alloc(size)})
+    return p;
+  throw std::bad_alloc{};
+}
+void *operator new(std::size_t size, std::align_val_t al) {
+  if (void *p{counted_alloc(size, al)})
+    return p;
+  throw std::bad_alloc{};
+}
+void *operator new[](std::size_t size, std::align_val_t al) {
+  if (void *p{counted_alloc(size, al)})
+    return p;
+  throw std::bad_alloc{};
+}
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept {
+  return counted_alloc(size);
+}
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept {
+  return counted_alloc(size);
+}
+void *operator new(std::size_t size, std::align_val_t al,
+                   const std::nothrow_t &) noexcept {
+  return counted_alloc(size, al);
+}
+void *operator new[](std::size_t size, std::align_val_t al,
+                     const std::nothrow_t &) noexcept {
+  return counted_alloc(size, al);
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::size_t) noexcept { std::free(p); }
+void operator delete(void *p, std::align_val_t) noexcept { aligned_free(p); }
+void operator delete[](void *p, std::align_val_t) noexcept { aligned_free(p); }
+void operator delete(void *p, std::size_t, std::align_val_t) noexcept {
+  aligned_free(p);
+}
+void operator delete[](void *p, std::size_t, std::align_val_t) noexcept {
+  aligned_free(p);
+}
+void operator delete(void *p, const std::nothrow_t &) noexcept {
+  std::free(p);
+}
+void operator delete[](void *p, const std::nothrow_t &) noexcept {
+  std::free(p);
+}
+void operator delete(void *p, std::align_val_t,
+                     const std::nothrow_t &) noexcept {
+  aligned_free(p);
+}
+void operator delete[](void *p, std::align_val_t,
+                       const std::nothrow_t &) noexcept {
+  aligned_free(p);
+}
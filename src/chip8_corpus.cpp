@@ -0,0 +1,409 @@
+#include "core/machine.hpp"
+#include "input/input_script.hpp"
+#include "utils/hash.hpp"
+#include "utils/mapped_file.hpp"
+#include "utils/png_writer.hpp"
+#include "utils/quirk_db.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// runs every rom under <rom dir>/{games,demos,programs} headless with a
+// scripted key sweep and checks framebuffer hashes against a golden file
+// usage: chip8_corpus [options] <rom dir>
+//   --golden <file>    golden hashes, required
+//   --update           rewrite the golden file instead of checking it
+//   --frames <N>       frames per rom (600)
+//   --interval <N>     frames between hashes (60)
+//   --threads <N>      worker threads, 0 = all cores (0)
+//   --diff <dir>       write a png of expected/actual/diff for every failure
+
+namespace {
+
+using namespace chip8;
+
+constexpr std::string_view GOLDEN_HEADER{"chip8_corpus\t1"};
+constexpr std::string_view CORPUS_DIRS[]{"games", "demos", "programs"};
+constexpr double FREQUENCY_HZ{700.0};
+constexpr std::uint32_t SEED{0xC8C8C8C8};
+
+struct Options {
+  std::filesystem::path root;
+  std::filesystem::path golden;
+  std::filesystem::path diff_dir;
+  bool update{false};
+  std::uint64_t frames{600};
+  std::uint64_t interval{60};
+  unsigned threads{0};
+};
+
+/// what one rom did. a fault ends the run, the hashes taken so far stay
+struct RomRun {
+  std::string name; // relative to the rom dir, '/' separated
+  std::vector<std::uint64_t> hashes;
+  std::string fault; // "category@frame", empty if none
+  DisplayBuffer final_frame{};
+
+  bool operator==(const RomRun &other) const {
+    return hashes == other.hashes && fault == other.fault;
+  }
+};
+
+std::uint64_t frame_hash(const DisplayBuffer &frame) {
+  return Xxh64::hash(std::span<const Byte>{
+      reinterpret_cast<const Byte *>(frame.data()), frame.size()});
+}
+
+std::string pack_frame(const DisplayBuffer &frame) {
+  std::string hex;
+  hex.reserve(frame.size() / 4);
+  for (std::size_t i{0}; i < frame.size(); i += 4)
+    hex += "0123456789abcdef"[frame[i] << 3 | frame[i + 1] << 2 |
+                              frame[i + 2] << 1 | frame[i + 3]];
+  return hex;
+}
+
+DisplayBuffer unpack_frame(std::string_view hex) {
+  DisplayBuffer frame{};
+  for (std::size_t i{0}; i < hex.size() && i * 4 < frame.size(); ++i) {
+    const char c{hex[i]};
+    const int nibble{c >= 'a' ? c - 'a' + 10 : c - '0'};
+    for (int bit{0}; bit < 4; ++bit)
+      frame[i * 4 + bit] = (nibble >> (3 - bit)) & 1;
+  }
+  return frame;
+}
+
+RomRun run_rom(const std::filesystem::path &path, std::string name,
+               const Options &options, const InputScript &input) {
+  RomRun run{.name = std::move(name)};
+
+  auto file{MappedFile::open(path)};
+  if (!file) {
+    run.fault = "io@0";
+    return run;
+  }
+
+  CpuConfig config{.frequency_hz = FREQUENCY_HZ};
+  bool clip{false};
+  if (const auto *known{find_quirks(rom_hash(file->bytes()))}) {
+    config.shift_quirk = known->profile.shift_quirk;
+    config.load_store_quirk = known->profile.load_store_quirk;
+    config.jump_quirk = known->profile.jump_quirk;
+    if (known->profile.frequency_hz > 0.0)
+      config.frequency_hz = known->profile.frequency_hz;
+    clip = known->profile.clip_sprites;
+  }
+
+  Machine machine{config, clip};
+  if (!machine.load_rom(file->bytes())) {
+    run.fault = "io@0";
+    return run;
+  }
+  machine.seed(SEED);
+
+  for (std::uint64_t frame{0}; frame < options.frames; ++frame) {
+    machine.set_keys(input.keys_at(frame));
+    if (auto result{machine.run_frame()}; !result) {
+      run.fault = std::format("{}@{}", result.error().category_string(),
+                              frame);
+      break;
+    }
+    if ((frame + 1) % options.interval == 0)
+      run.hashes.push_back(frame_hash(machine.display().buffer()));
+  }
+  run.final_frame = machine.display().buffer();
+  return run;
+}
+
+std::vector<std::pair<std::filesystem::path, std::string>> find_roms(
+    const std::filesystem::path &root) {
+  std::vector<std::pair<std::filesystem::path, std::string>> roms;
+  for (const auto dir : CORPUS_DIRS) {
+    std::error_code ec;
+    for (const auto &entry :
+         std::filesystem::recursive_directory_iterator(root / dir, ec)) {
+      if (entry.is_regular_file() && entry.path().extension() == ".ch8")
+        roms.emplace_back(entry.path(), entry.path()
+                                        .lexically_relative(root)
+                                        .generic_string());
+    }
+  }
+  std::ranges::sort(roms, {}, &std::pair<std::filesystem::path,
+                                         std::string>::second);
+  return roms;
+}
+
+std::vector<RomRun> run_corpus(const Options &options) {
+  const auto roms{find_roms(options.root)};
+  const auto input{InputScript::key_sweep(options.frames)};
+  std::vector<RomRun> runs(roms.size());
+
+  unsigned threads{options.threads};
+  if (threads == 0)
+    threads = std::max(1u, std::thread::hardware_concurrency());
+
+  std::atomic<std::size_t> next{0};
+  const auto worker{[&] {
+    for (std::size_t i{next.fetch_add(1)}; i < roms.size();
+         i = next.fetch_add(1))
+      runs[i] = run_rom(roms[i].first, roms[i].second, options, input);
+  }};
+  {
+    std::vector<std::jthread> pool;
+    for (unsigned t{1}; t < threads; ++t)
+      pool.emplace_back(worker);
+    worker();
+  }
+  return runs;
+}
+
+// one line per rom: name, hashes, fault or "-", final frame as hex
+std::string format_run(const RomRun &run) {
+  std::string line{run.name};
+  line += '\t';
+  for (std::size_t i{0}; i < run.hashes.size(); ++i)
+    line += std::format("{}{:016x}", i ? " " : "", run.hashes[i]);
+  line += '\t';
+  line += run.fault.empty() ? "-" : run.fault;
+  line += '\t';
+  line += pack_frame(run.final_frame);
+  return line;
+}
+
+std::optional<RomRun> parse_run(const std::string &line) {
+  std::vector<std::string_view> fields;
+  std::string_view rest{line};
+  for (std::size_t tab; (tab = rest.find('\t')) != std::string_view::npos;) {
+    fields.push_back(rest.substr(0, tab));
+    rest.remove_prefix(tab + 1);
+  }
+  fields.push_back(rest);
+  if (fields.size() != 4)
+    return std::nullopt;
+
+  RomRun run{.name = std::string{fields[0]}};
+  std::istringstream hashes{std::string{fields[1]}};
+  for (std::string token; hashes >> token;) {
+    std::uint64_t hash{0};
+    std::from_chars(token.data(), token.data() + token.size(), hash, 16);
+    run.hashes.push_back(hash);
+  }
+  if (fields[2] != "-")
+    run.fault = fields[2];
+  run.final_frame = unpack_frame(fields[3]);
+  return run;
+}
+
+// the second line of a golden file, a run only compares against the same
+std::string settings_line(const Options &options) {
+  return std::format("# frames={} interval={} frequency={} seed={:08x}",
+                     options.frames, options.interval, FREQUENCY_HZ, SEED);
+}
+
+Result<void> write_golden(const Options &options,
+                          const std::vector<RomRun> &runs) {
+  std::ofstream file(options.golden, std::ios::trunc);
+  if (!file)
+    return Error::io(std::format("Failed to open file: {}",
+                                 options.golden.string()));
+  file << GOLDEN_HEADER << '\n' << settings_line(options) << '\n';
+  for (const auto &run : runs)
+    file << format_run(run) << '\n';
+  if (!file)
+    return Error::io("Failed to write golden file");
+  return Ok();
+}
+
+Result<std::map<std::string, RomRun>> read_golden(const Options &options) {
+  using R = Result<std::map<std::string, RomRun>>;
+  std::ifstream file(options.golden);
+  if (!file)
+    return R{Error::io(std::format("File not found: {}",
+                                   options.golden.string()))};
+
+  std::string line;
+  if (!std::getline(file, line) || line != GOLDEN_HEADER)
+    return R{Error::io("not a corpus golden file")};
+  if (!std::getline(file, line) || !line.starts_with("# frames="))
+    return R{Error::io("golden file has no settings line")};
+  if (const auto settings{settings_line(options)}; line != settings)
+    return R{Error::config(std::format(
+        "golden file was recorded with '{}', this run uses '{}'. match "
+        "--frames and --interval or rerun with --update",
+        line.substr(2), settings.substr(2)))};
+
+  std::map<std::string, RomRun> golden;
+  while (std::getline(file, line)) {
+    if (line.empty() || line[0] == '#')
+      continue;
+    auto run{parse_run(line)};
+    if (!run)
+      return R{Error::io(std::format("bad golden line: {}", line))};
+    auto name{run->name};
+    golden.emplace(std::move(name), std::move(*run));
+  }
+  return R{std::move(golden)};
+}
+
+// expected | actual | diff, 4x scale. red = expected only, green = actual only
+void write_diff(const Options &options, const RomRun &expected,
+                const RomRun &actual) {
+  constexpr std::size_t SCALE{4};
+  constexpr std::size_t W{constants::DISPLAY_WIDTH};
+  constexpr std::size_t H{constants::DISPLAY_HEIGHT};
+  constexpr std::size_t GAP{2};
+  PngWriter png{(W * 3 + GAP * 2) * SCALE, H * SCALE};
+  png.fill(0, 0, png.width(), png.height(), {40, 40, 90});
+
+  for (std::size_t y{0}; y < H; ++y)
+    for (std::size_t x{0}; x < W; ++x) {
+      const bool e{expected.final_frame[y * W + x]};
+      const bool a{actual.final_frame[y * W + x]};
+      const PngWriter::Rgb off{0, 0, 0};
+      const PngWriter::Rgb on{255, 255, 255};
+      png.fill(x * SCALE, y * SCALE, SCALE, SCALE, e ? on : off);
+      png.fill((W + GAP + x) * SCALE, y * SCALE, SCALE, SCALE, a ? on : off);
+      const PngWriter::Rgb diff{e && a    ? PngWriter::Rgb{90, 90, 90}
+                                : e       ? PngWriter::Rgb{230, 40, 40}
+                                : a       ? PngWriter::Rgb{40, 230, 40}
+                                          : off};
+      png.fill((2 * (W + GAP) + x) * SCALE, y * SCALE, SCALE, SCALE, diff);
+    }
+
+  std::error_code ec;
+  std::filesystem::create_directories(options.diff_dir, ec);
+  auto name{actual.name};
+  std::ranges::replace(name, '/', '_');
+  const auto path{options.diff_dir / (name + ".png")};
+  if (auto result{png.write(path)}; !result)
+    std::cerr << result.error().message() << '\n';
+}
+
+int check(const Options &options, const std::vector<RomRun> &runs) {
+  auto golden{read_golden(options)};
+  if (!golden) {
+    std::cerr << golden.error().message() << '\n';
+    return EXIT_FAILURE;
+  }
+
+  int failures{0};
+  for (const auto &run : runs) {
+    const auto it{golden->find(run.name)};
+    if (it == golden->end()) {
+      std::cerr << std::format("NEW  {} (not in golden file)\n", run.name);
+      ++failures;
+      continue;
+    }
+    const auto &expected{it->second};
+    if (run == expected)
+      continue;
+
+    ++failures;
+    std::size_t first{0};
+    while (first < run.hashes.size() && first < expected.hashes.size() &&
+           run.hashes[first] == expected.hashes[first])
+      ++first;
+    std::cerr << std::format(
+        "FAIL {} diverges by frame {}{}\n", run.name,
+        (first + 1) * options.interval,
+        run.fault != expected.fault
+            ? std::format(", fault {} (expected {})",
+                          run.fault.empty() ? "none" : run.fault,
+                          expected.fault.empty() ? "none" : expected.fault)
+            : "");
+    if (!options.diff_dir.empty())
+      write_diff(options, expected, run);
+  }
+  for (const auto &[name, expected] : *golden)
+    if (std::ranges::find(runs, name, &RomRun::name) == runs.end()) {
+      std::cerr << std::format("GONE {} (in golden file only)\n", name);
+      ++failures;
+    }
+
+  return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+std::optional<Options> parse_options(int argc, char *argv[]) {
+  Options options;
+  for (int i{1}; i < argc; ++i) {
+    const std::string_view arg{argv[i]};
+    const auto value{[&]() -> const char * {
+      return i + 1 < argc ? argv[++i] : nullptr;
+    }};
+
+    if (arg == "--update") {
+      options.update = true;
+    } else if (arg == "--golden" || arg == "--diff" || arg == "--frames" ||
+               arg == "--interval" || arg == "--threads") {
+      const char *v{value()};
+      if (!v) {
+        std::cerr << std::format("Error: {} requires a value\n", arg);
+        return std::nullopt;
+      }
+      if (arg == "--golden")
+        options.golden = v;
+      else if (arg == "--diff")
+        options.diff_dir = v;
+      else if (arg == "--frames")
+        options.frames = std::strtoull(v, nullptr, 10);
+      else if (arg == "--interval")
+        options.interval = std::max<std::uint64_t>(
+            1, std::strtoull(v, nullptr, 10));
+      else
+        options.threads = static_cast<unsigned>(std::strtoul(v, nullptr, 10));
+    } else if (arg[0] == '-') {
+      std::cerr << std::format("Error: unknown option {}\n", arg);
+      return std::nullopt;
+    } else {
+      options.root = arg;
+    }
+  }
+
+  if (options.root.empty() || options.golden.empty()) {
+    std::cerr << "usage: chip8_corpus [--update] [--frames N] [--interval N]"
+                 " [--threads N] [--diff dir] --golden <file> <rom dir>\n";
+    return std::nullopt;
+  }
+  return options;
+}
+
+}
+
+int main(int argc, char *argv[]) {
+  const auto options{parse_options(argc, argv)};
+  if (!options)
+    return EXIT_FAILURE;
+
+  const auto start{std::chrono::steady_clock::now()};
+  const auto runs{run_corpus(*options)};
+  const auto elapsed{std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start)};
+  std::cout << std::format("{} roms x {} frames in {:.2f} s\n", runs.size(),
+                           options->frames, elapsed.count());
+
+  if (runs.empty()) {
+    std::cerr << "no roms found under " << options->root.string() << '\n';
+    return EXIT_FAILURE;
+  }
+
+  if (options->update) {
+    if (auto result{write_golden(*options, runs)}; !result) {
+      std::cerr << result.error().message() << '\n';
+      return EXIT_FAILURE;
+    }
+    std::cout << std::format("wrote {}\n", options->golden.string());
+    return EXIT_SUCCESS;
+  }
+  return check(*options, runs);
+}
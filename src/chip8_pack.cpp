@@ -0,0 +1,39 @@
+#include "utils/rom_catalog.hpp"
+#include "utils/rom_pack.hpp"
+
+#include <cstdlib>
+#include <iostream>
+
+// bundles every rom under a directory into one chip8-pack archive
+// usage: chip8-pack <rom dir> <output.c8pk>
+
+int main(int argc, char *argv[]) {
+  using namespace chip8;
+
+  if (argc != 3) {
+    std::cerr << "usage: chip8-pack <rom dir> <output.c8pk>\n";
+    return EXIT_FAILURE;
+  }
+
+  const std::filesystem::path root{argv[1]};
+  const std::filesystem::path output{argv[2]};
+
+  auto catalog{RomCatalog::scan(root)};
+  if (!catalog) {
+    std::cerr << catalog.error().message() << '\n';
+    return EXIT_FAILURE;
+  }
+
+  RomPackWriter writer;
+  if (auto result{writer.add_catalog(*catalog)}; !result) {
+    std::cerr << result.error().message() << '\n';
+    return EXIT_FAILURE;
+  }
+  if (auto result{writer.write(output)}; !result) {
+    std::cerr << result.error().message() << '\n';
+    return EXIT_FAILURE;
+  }
+
+  std::cout << std::format("{}: {} roms\n", output.string(), writer.size());
+  return EXIT_SUCCESS;
+}
@@ -1,10 +1,148 @@
 #include "audio/beeper.hpp"
 #include "core/emulator.hpp"
 #include "utils/argument_parser.hpp"
+#include "utils/rom_catalog.hpp"
+#include "utils/rom_pack.hpp"
 
+#include <fstream>
 #include <iostream>
+#include <memory>
+#include <optional>
+#include <ranges>
 #include <raylib.h>
 
+namespace {
+
+void export_heatmap(const chip8::AccessHeatmap &heatmap,
+                    const std::filesystem::path &prefix) {
+  using namespace chip8;
+
+  const auto with_suffix{[&](std::string_view suffix) {
+    auto path{prefix};
+    path += suffix;
+    return path;
+  }};
+
+  if (auto result{heatmap.export_csv(with_suffix(".csv"))}; !result)
+    LOG_ERROR("Heatmap export failed: {}", result.error().message());
+
+  for (const auto kind : {AccessKind::Fetch, AccessKind::Read,
+                          AccessKind::Write}) {
+    const auto path{with_suffix(std::format("_{}.ppm",
+                                            access_kind_string(kind)))};
+    if (auto result{heatmap.export_image(path, kind)}; !result)
+      LOG_ERROR("Heatmap export failed: {}", result.error().message());
+  }
+
+  LOG_INFO("Heatmap written: {} self modified bytes",
+           heatmap.self_modified_count());
+}
+
+void export_call_profile(const chip8::CallProfiler &profiler,
+                         const std::filesystem::path &path) {
+  using namespace chip8;
+
+  if (auto result{profiler.export_collapsed(path)}; !result) {
+    LOG_ERROR("Call graph export failed: {}", result.error().message());
+    return;
+  }
+
+  const auto total{profiler.total_cycles()};
+  for (const auto &sub : profiler.subroutines() | std::views::take(10))
+    LOG_INFO("sub_{:03X}: {} calls, {} incl, {} excl ({:.1f}%)",
+             sub.entry.get(), sub.calls, sub.inclusive_cycles,
+             sub.exclusive_cycles,
+             total ? 100.0 * static_cast<double>(sub.inclusive_cycles) /
+                     static_cast<double>(total)
+                   : 0.0);
+}
+
+void export_zones(const std::filesystem::path &path) {
+  using namespace chip8;
+
+  const auto &profiler{ZoneProfiler::instance()};
+  if (auto result{profiler.export_chrome(path)}; !result) {
+    LOG_ERROR("Zone export failed: {}", result.error().message());
+    return;
+  }
+  LOG_INFO("Zones written: {} threads to {}", profiler.thread_count(),
+           path.string());
+}
+
+void report_perf(const chip8::PerfCounters &perf) {
+  using namespace chip8;
+
+  LOG_INFO("Perf counters: {} frames, {} instructions{}", perf.frames(),
+           perf.instructions(),
+           perf.multiplexed() ? ", multiplexed" : "");
+  for (std::size_t p{0}; p < PERF_PHASE_COUNT; ++p) {
+    const auto phase{static_cast<PerfPhase>(p)};
+    for (std::size_t e{0}; e < PERF_EVENT_COUNT; ++e) {
+      const auto event{static_cast<PerfEvent>(e)};
+      if (perf.supported(event))
+        LOG_INFO("{} {}: {:.1f} per frame, {:.2f} per instruction",
+                 PERF_PHASE_NAMES[p], PERF_EVENT_NAMES[e],
+                 perf.per_frame(phase, event),
+                 perf.per_instruction(phase, event));
+    }
+  }
+}
+
+void export_trace(const chip8::TraceRing &trace,
+                  const std::filesystem::path &path) {
+  std::ofstream file(path);
+  if (!file) {
+    LOG_ERROR("Trace export failed: cannot open {}", path.string());
+    return;
+  }
+  chip8::dump_trace(trace, file);
+  LOG_INFO("Trace written: {} of {} instructions", trace.size(),
+           trace.total_recorded());
+}
+
+chip8::Result<void> load_rom(chip8::Emulator &emulator,
+                             const chip8::Config &config,
+                             const std::string &rom) {
+  using namespace chip8;
+
+  if (config.rom_pack.empty())
+    return emulator.load_rom(rom);
+
+  auto pack{RomPack::open(config.rom_pack)};
+  if (!pack)
+    return pack.error();
+  auto packed{load_packed_rom(*pack, rom)};
+  if (!packed)
+    return packed.error();
+
+  LOG_INFO("Loading ROM: {} from {}", packed->name,
+           config.rom_pack.string());
+  return emulator.load_rom(packed->data, packed->name);
+}
+
+int print_catalog(const std::filesystem::path &dir) {
+  using namespace chip8;
+
+  auto catalog{RomCatalog::scan(dir, dir / RomCatalog::DEFAULT_INDEX_NAME)};
+  if (!catalog) {
+    std::cerr << catalog.error().message() << '\n';
+    return EXIT_FAILURE;
+  }
+
+  for (const auto &entry : catalog->entries())
+    std::cout << std::format("{:016X}  {:>5}  {:<5}  {}\n", entry.hash,
+                             entry.size, rom_platform_string(entry.platform),
+                             entry.path);
+
+  const auto &stats{catalog->stats()};
+  std::cout << std::format("{} ROMs ({} cached, {} hashed, {} failed)\n",
+                           catalog->size(), stats.reused, stats.hashed,
+                           stats.failed);
+  return EXIT_SUCCESS;
+}
+
+}
+
 int main(int argc, char *argv[]) {
   using namespace chip8;
 
@@ -22,6 +160,8 @@ int main(int argc, char *argv[]) {
     ArgumentParser::print_version();
     return EXIT_SUCCESS;
   }
+  if (!args->catalog_dir.empty())
+    return print_catalog(args->catalog_dir);
 
   Config config{args->config};
 
@@ -30,6 +170,7 @@ int main(int argc, char *argv[]) {
   log_config.show_timestamp = true;
   log_config.show_level = true;
   log_config.show_location = args->config.debug_mode;
+  log_config.async = true; // never block the emulation thread on stderr
   chip8::Logger::instance().configure(log_config);
 
   LOG_INFO("Starting {} v{}", "1.0", "something");
@@ -41,20 +182,78 @@ int main(int argc, char *argv[]) {
     return EXIT_FAILURE;
   }
 
-  if (auto result{emulator.load_rom(args->rom_path)}; !result) {
+  if (auto result{load_rom(emulator, config, args->rom_path)}; !result) {
     LOG_ERROR("ROM load failed: {}", result.error().message());
     return EXIT_FAILURE;
   }
 
+  std::unique_ptr<AccessHeatmap> heatmap;
+  if (!config.heatmap_prefix.empty()) {
+    heatmap = std::make_unique<AccessHeatmap>();
+    emulator.set_heatmap(heatmap.get());
+  }
+
+  std::unique_ptr<CallProfiler> call_profiler;
+  if (!config.callgraph_path.empty()) {
+    call_profiler = std::make_unique<CallProfiler>();
+    emulator.set_call_profiler(call_profiler.get());
+  }
+
+  std::unique_ptr<TraceRing> trace;
+  if (!config.trace_path.empty()) {
+    trace = std::make_unique<TraceRing>(config.trace_size);
+    emulator.set_trace(trace.get());
+  }
+
+  if (!config.zones_path.empty()) {
+    if constexpr (ZONES_ENABLED)
+      ZoneProfiler::instance().name_thread("emulation");
+    else
+      LOG_WARNING("--zones ignored, built without CHIP8_ENABLE_ZONES");
+  }
+
+  std::optional<PerfCounters> perf;
+  if (config.perf_counters) {
+    if (auto counters{PerfCounters::open()}; counters) {
+      perf.emplace(std::move(counters.value()));
+      emulator.set_perf_counters(&*perf);
+    } else {
+      LOG_WARNING("Perf counters disabled: {}", counters.error().message());
+    }
+  }
+
   emulator.run();
 
   while (!emulator.should_quit()) {
     if (auto result{emulator.update()}; !result) {
       LOG_ERROR("Error: {}", result.error().message());
+      if (trace)
+        export_trace(*trace, config.trace_path);
       return EXIT_FAILURE;
     }
   }
 
+  if (const auto &stats{emulator.stats()}; stats.latency_samples > 0)
+    LOG_INFO("Input latency: {:.1f} ms average over {} presses, run-ahead {}",
+             stats.average_latency_ms(), stats.latency_samples,
+             config.run_ahead);
+
+  if (AllocCounter::installed())
+    LOG_INFO("Heap allocations: {} in {} frames, {} in total",
+             emulator.stats().update_allocations,
+             emulator.stats().frames_rendered, AllocCounter::allocations());
+
+  if (perf)
+    report_perf(*perf);
+  if (ZONES_ENABLED && !config.zones_path.empty())
+    export_zones(config.zones_path);
+  if (heatmap)
+    export_heatmap(*heatmap, config.heatmap_prefix);
+  if (call_profiler)
+    export_call_profile(*call_profiler, config.callgraph_path);
+  if (trace)
+    export_trace(*trace, config.trace_path);
+
   return EXIT_SUCCESS;
 
   return 0;
@@ -0,0 +1,36 @@
+#pragma once
+#include "graphics/i_renderer.hpp"
+
+
+namespace chip8::test {
+
+class MockRenderer : public IRenderer {
+public:
+  bool initialize() override { return true; }
+  void shutdown() override {}
+  bool should_close() const override { return m_Should_close; }
+
+  void begin_frame() override {}
+  void render(const DisplayBuffer &buffer) override { m_Last_frame = buffer; }
+  void end_frame() override { ++m_Frames; }
+
+  void set_scale(int scale) override { m_Scale = scale; }
+  int get_scale() const override { return m_Scale; }
+
+  int get_window_width() const override { return 0; }
+  int get_window_height() const override { return 0; }
+  void set_title(const char *) override {}
+  void toggle_fullscreen() override {}
+
+  void set_should_close(bool close) { m_Should_close = close; }
+  int frames() const { return m_Frames; }
+  const DisplayBuffer &last_frame() const { return m_Last_frame; }
+
+private:
+  DisplayBuffer m_Last_frame{};
+  int m_Frames{0};
+  int m_Scale{1};
+  bool m_Should_close{false};
+};
+
+}
@@ -0,0 +1,111 @@
+// the test binary links src/alloc_counter.cpp, so operator new counts
+#include "catch2/catch_test_macros.hpp"
+#include "core/emulator.hpp"
+#include "core/machine.hpp"
+#include "input/input_script.hpp"
+#include "mocks/mock_key_provider.hpp"
+#include "mocks/mock_renderer.hpp"
+#include "utils/alloc_counter.hpp"
+#include "utils/rom_loader.hpp"
+
+#include <array>
+#include <memory>
+#include <vector>
+
+using namespace chip8;
+
+namespace {
+
+constexpr std::uint64_t WARMUP_FRAMES{120};
+constexpr std::uint64_t STEADY_FRAMES{3'000};
+
+const std::vector<std::filesystem::path> ROMS{
+    "roms/games/Pong [Paul Vervalin, 1990].ch8",
+    "roms/games/Tetris [Fran Dachille, 1991].ch8",
+    "roms/games/Space Invaders [David Winter].ch8",
+    "roms/games/Blitz [David Winter].ch8",
+    "roms/demos/Maze [David Winter, 199x].ch8",
+    "roms/programs/Clock Program [Bill Fisher, 1981].ch8",
+};
+
+}
+
+TEST_CASE("Allocation counter sees the heap", "[alloc]") {
+  REQUIRE(AllocCounter::installed());
+
+  const AllocScope scope;
+  auto block{std::make_unique<std::array<Byte, 64>>()};
+  REQUIRE(scope.allocations() == 1);
+  REQUIRE(AllocCounter::bytes() >= 64);
+}
+
+TEST_CASE("Machine frames never allocate after warm-up", "[alloc]") {
+  const auto input{InputScript::key_sweep(WARMUP_FRAMES + STEADY_FRAMES)};
+
+  for (const auto &path : ROMS) {
+    auto rom{RomLoader::load(path)};
+    REQUIRE(rom.is_ok());
+
+    Machine machine{CpuConfig{.frequency_hz = 700.0}};
+    REQUIRE(machine.load_rom(rom->as_span()).is_ok());
+    std::uint64_t frame{0};
+    for (; frame < WARMUP_FRAMES; ++frame) {
+      machine.set_keys(input.keys_at(frame));
+      REQUIRE(machine.run_frame().is_ok());
+    }
+
+    const AllocScope scope;
+    bool ok{true};
+    for (; frame < WARMUP_FRAMES + STEADY_FRAMES; ++frame) {
+      machine.set_keys(input.keys_at(frame));
+      ok = ok && machine.run_frame().is_ok();
+    }
+    // REQUIRE itself may allocate, check after the loop
+    const auto allocations{scope.allocations()};
+    REQUIRE(ok);
+    REQUIRE(allocations == 0);
+  }
+}
+
+TEST_CASE("Emulator update never allocates after warm-up", "[alloc]") {
+  Config config;
+  config.audio_enabled = false;
+  config.run_ahead = 1;
+
+  auto keys{std::make_shared<test::MockKeyProvider>()};
+  // every key is in the mock's map before counting starts
+  for (const auto &mapping : DEFAULT_KEY_MAP)
+    keys->set_key_down(mapping.platform_key, false);
+
+  auto renderer{std::make_unique<test::MockRenderer>()};
+  const auto *const frames{renderer.get()};
+  Emulator emulator{config, std::move(renderer), keys};
+  REQUIRE(emulator.initialize().is_ok());
+  REQUIRE(emulator.load_rom(ROMS.front()).is_ok());
+  emulator.run();
+
+  const auto press{[&](std::uint64_t frame) {
+    const auto &mapping{DEFAULT_KEY_MAP[(frame / 30) % DEFAULT_KEY_MAP.size()]};
+    keys->set_key_down(mapping.platform_key, frame % 30 < 6);
+  }};
+
+  std::uint64_t frame{0};
+  for (; frame < WARMUP_FRAMES; ++frame) {
+    press(frame);
+    REQUIRE(emulator.update().is_ok());
+  }
+
+  const auto before{emulator.stats().update_allocations};
+  const AllocScope scope;
+  bool ok{true};
+  for (; frame < WARMUP_FRAMES + STEADY_FRAMES; ++frame) {
+    press(frame);
+    ok = ok && emulator.update().is_ok();
+  }
+  const auto allocations{scope.allocations()};
+  REQUIRE(ok);
+  REQUIRE(allocations == 0);
+  REQUIRE(emulator.stats().update_allocations == before);
+  REQUIRE(frames->frames() ==
+          static_cast<int>(WARMUP_FRAMES + STEADY_FRAMES));
+}
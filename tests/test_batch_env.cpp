@@ -0,0 +1,157 @@
+#include "catch2/catch_test_macros.hpp"
+#include "core/batch_env.hpp"
+#include "utils/hash.hpp"
+#include "utils/rom_loader.hpp"
+
+#include <vector>
+
+using namespace chip8;
+
+namespace {
+
+// draws a "0" at the origin, then counts V1 up into 0x301 forever
+const std::vector<Byte> COUNTER_ROM{
+    0xF0, 0x29, // LD F, V0
+    0xD0, 0x05, // DRW V0, V0, 5
+    0x71, 0x01, // ADD V1, 1
+    0xA3, 0x00, // LD I, 300
+    0xF1, 0x55, // LD [I], V0..V1
+    0x12, 0x04  // JP 204
+};
+
+// one life in 0x300, lost as soon as key 0 is held
+const std::vector<Byte> KEY_ROM{
+    0xA3, 0x00, // LD I, 300
+    0x60, 0x01, // LD V0, 1
+    0xF0, 0x55, // LD [I], V0
+    0x60, 0x00, // LD V0, 0
+    0xE0, 0x9E, // SKP V0
+    0x12, 0x08, // JP 208
+    0xA3, 0x00, // LD I, 300
+    0xF0, 0x55, // LD [I], V0
+    0x12, 0x10  // JP 210
+};
+
+}
+
+TEST_CASE("Batch env writes packed observations and score rewards",
+          "[batch_env]") {
+  const BatchEnvConfig config{.envs = 3, .sticky_actions = 0.0f};
+  auto env{BatchEnv::create(COUNTER_ROM, config,
+                            RewardSpec{.score = Address{0x301}})};
+  REQUIRE(env.is_ok());
+  auto &batch{*env.value()};
+
+  std::vector<Byte> obs(batch.size() * BatchEnv::OBSERVATION_BYTES, 0xAA);
+  REQUIRE(batch.reset(obs).is_ok());
+  REQUIRE(obs[0] == 0x00); // nothing drawn before the first frame
+
+  const std::vector<KeyMask> actions(batch.size(), 0);
+  std::vector<float> rewards(batch.size());
+  std::vector<std::uint8_t> dones(batch.size());
+  REQUIRE(batch.step(actions, obs, rewards, dones).is_ok());
+
+  for (std::size_t i{0}; i < batch.size(); ++i) {
+    const auto *frame{obs.data() + i * BatchEnv::OBSERVATION_BYTES};
+    REQUIRE(frame[0] == 0xF0); // top row of the font "0"
+    REQUIRE(frame[8] == 0x90); // second row, 64 pixels = 8 bytes later
+    REQUIRE(frame[1] == 0x00);
+    REQUIRE(rewards[i] > 0.0f);
+    REQUIRE(rewards[i] == rewards[0]);
+    REQUIRE(dones[i] == 0);
+  }
+  REQUIRE(batch.steps() == 3);
+
+  // wrong buffer sizes are rejected
+  std::vector<Byte> short_obs(BatchEnv::OBSERVATION_BYTES);
+  REQUIRE(batch.step(actions, short_obs, rewards, dones).is_err());
+}
+
+TEST_CASE("Batch env ends episodes and honours sticky actions",
+          "[batch_env]") {
+  const RewardSpec reward{.lives = Address{0x300}};
+  std::vector<Byte> obs(BatchEnv::OBSERVATION_BYTES);
+  const std::vector<KeyMask> press{0x0001};
+  std::vector<float> rewards(1);
+  std::vector<std::uint8_t> dones(1);
+
+  auto env{BatchEnv::create(
+      KEY_ROM, BatchEnvConfig{.envs = 1, .sticky_actions = 0.0f}, reward)};
+  REQUIRE(env.is_ok());
+  REQUIRE(env.value()->reset(obs).is_ok());
+  REQUIRE(env.value()->step(press, obs, rewards, dones).is_ok());
+  REQUIRE(dones[0] == 1);
+  // auto reset, the next episode starts from the pool image
+  REQUIRE(env.value()->machine(0).frame_count() == 0);
+
+  // always sticky, the first action (no keys) is never replaced
+  auto sticky{BatchEnv::create(
+      KEY_ROM, BatchEnvConfig{.envs = 1, .sticky_actions = 1.0f}, reward)};
+  REQUIRE(sticky.is_ok());
+  REQUIRE(sticky.value()->reset(obs).is_ok());
+  for (int i{0}; i < 10; ++i) {
+    REQUIRE(sticky.value()->step(press, obs, rewards, dones).is_ok());
+    REQUIRE(dones[0] == 0);
+  }
+}
+
+TEST_CASE("Batch env validates its config", "[batch_env]") {
+  REQUIRE(BatchEnv::create(COUNTER_ROM, BatchEnvConfig{.envs = 0}).is_err());
+  REQUIRE(BatchEnv::create(COUNTER_ROM, BatchEnvConfig{.frame_skip = 0})
+          .is_err());
+  REQUIRE(BatchEnv::create({}, BatchEnvConfig{}).is_err());
+  REQUIRE(BatchEnv::create(COUNTER_ROM, BatchEnvConfig{},
+                           RewardSpec{.score = Address{0xFFE},
+                                      .score_bytes = 3})
+          .is_err());
+  REQUIRE(BatchEnv::create(COUNTER_ROM, BatchEnvConfig{},
+                           RewardSpec{.lives = Address{0x1000}})
+          .is_err());
+}
+
+TEST_CASE("Batch env reports rom faults", "[batch_env]") {
+  const std::vector<Byte> faulting{0xFF, 0xFF};
+  auto env{BatchEnv::create(faulting, BatchEnvConfig{.envs = 2})};
+  REQUIRE(env.is_ok());
+
+  std::vector<Byte> obs(2 * BatchEnv::OBSERVATION_BYTES);
+  const std::vector<KeyMask> actions(2);
+  std::vector<float> rewards(2);
+  std::vector<std::uint8_t> dones(2);
+  REQUIRE(env.value()->reset(obs).is_ok());
+  const auto result{env.value()->step(actions, obs, rewards, dones)};
+  REQUIRE(result.is_err());
+  REQUIRE(result.error().category() == Error::Category::InvalidOpcode);
+}
+
+TEST_CASE("Known reward specs score Brix", "[batch_env]") {
+  const std::filesystem::path brix{
+      "roms/games/Brix [Andreas Gustafsson, 1990].ch8"};
+  auto rom{RomLoader::load(brix)};
+  REQUIRE(rom.is_ok());
+  const auto *known{find_reward(rom_hash(rom->as_span()))};
+  REQUIRE(known != nullptr);
+  REQUIRE(known->spec.valid());
+  REQUIRE(find_reward(0) == nullptr);
+
+  auto env{BatchEnv::create(rom->as_span(),
+                            BatchEnvConfig{.envs = 1, .sticky_actions = 0.0f},
+                            known->spec)};
+  REQUIRE(env.is_ok());
+  auto &batch{*env.value()};
+
+  std::vector<Byte> obs(BatchEnv::OBSERVATION_BYTES);
+  const std::vector<KeyMask> actions(1, 0);
+  std::vector<float> rewards(1);
+  std::vector<std::uint8_t> dones(1);
+  REQUIRE(batch.reset(obs).is_ok());
+
+  // every brick is worth one point, V5 holds the score
+  float total{0.0f};
+  for (int i{0}; i < 2'000 && total == 0.0f; ++i) {
+    REQUIRE(batch.step(actions, obs, rewards, dones).is_ok());
+    total += rewards[0];
+  }
+  REQUIRE(total == 1.0f);
+  REQUIRE(batch.machine(0).cpu().reg(RegisterIndex{5}).get() == 1);
+}
@@ -0,0 +1,97 @@
+#include "catch2/catch_test_macros.hpp"
+#include "core/cpu.hpp"
+#include "profiling/call_profiler.hpp"
+
+using namespace chip8;
+
+class CallProfilerTestClass {
+protected:
+  Memory memory;
+  Timers timers;
+  Cpu cpu{memory, timers};
+  CallProfiler profiler;
+
+  CallProfilerTestClass() { cpu.set_call_profiler(&profiler); }
+
+  void load_program(std::initializer_list<Byte> bytes) {
+    std::vector<Byte> data(bytes);
+    memory.load_rom(data);
+  }
+
+  void run(int n) {
+    for (int i{0}; i < n; ++i)
+      cpu.step();
+  }
+};
+
+TEST_CASE_METHOD(CallProfilerTestClass, "Call profiler tracks the call stack",
+                 "[profiler]") {
+  load_program({
+      0x22, 0x04, // 0x200 CALL 0x204
+      0x12, 0x02, // 0x202 JP 0x202
+      0x60, 0x01, // 0x204 LD V0, 1
+      0x00, 0xEE, // 0x206 RET
+  });
+
+  run(1);
+  REQUIRE(profiler.depth() == 1);
+  run(2);
+  REQUIRE(profiler.depth() == 0);
+}
+
+TEST_CASE_METHOD(CallProfilerTestClass,
+                 "Call profiler splits inclusive and exclusive cycles",
+                 "[profiler]") {
+  load_program({
+      0x22, 0x06, // 0x200 CALL 0x206
+      0x12, 0x02, // 0x202 JP 0x202
+      0x00, 0x00, // 0x204
+      0x22, 0x0C, // 0x206 CALL 0x20C
+      0x00, 0xEE, // 0x208 RET
+      0x00, 0x00, // 0x20A
+      0x60, 0x01, // 0x20C LD V0, 1
+      0x61, 0x02, // 0x20E LD V1, 2
+      0x00, 0xEE, // 0x210 RET
+  });
+
+  run(7); // outer CALL, inner CALL, 2x LD, RET, RET, JP
+  const auto subs{profiler.subroutines()};
+  REQUIRE(subs.size() == 2);
+
+  // outer: its own CALL + RET, inner: 2x LD + RET
+  REQUIRE(subs[0].entry == Address{0x206});
+  REQUIRE(subs[0].exclusive_cycles == 2);
+  REQUIRE(subs[0].inclusive_cycles == 5);
+  REQUIRE(subs[1].entry == Address{0x20C});
+  REQUIRE(subs[1].exclusive_cycles == 3);
+  REQUIRE(subs[1].inclusive_cycles == 3);
+  REQUIRE(profiler.total_cycles() == 7);
+}
+
+TEST_CASE_METHOD(CallProfilerTestClass,
+                 "Call profiler exports collapsed stacks", "[profiler]") {
+  load_program({
+      0x22, 0x04, // 0x200 CALL 0x204
+      0x12, 0x02, // 0x202 JP 0x202
+      0x00, 0xEE, // 0x204 RET
+  });
+
+  run(3);
+  const auto stacks{profiler.collapsed_stacks()};
+  REQUIRE(stacks.find("main 2\n") != std::string::npos);
+  REQUIRE(stacks.find("main;sub_204 1\n") != std::string::npos);
+}
+
+TEST_CASE_METHOD(CallProfilerTestClass,
+                 "Call profiler reuses nodes for repeated calls",
+                 "[profiler]") {
+  load_program({
+      0x22, 0x04, // 0x200 CALL 0x204
+      0x12, 0x00, // 0x202 JP 0x200
+      0x00, 0xEE, // 0x204 RET
+  });
+
+  run(30);
+  REQUIRE(profiler.nodes().size() == 2);
+  REQUIRE(profiler.nodes()[1].calls == 10);
+}
@@ -79,4 +79,28 @@ TEST_CASE("Display dirty flag", "[display]") {
 
   display.set_pixel(0, 0, true);
   REQUIRE(display.is_dirty());
-}
\ No newline at end of file
+}
+
+TEST_CASE("Sprite clipping at the screen edge", "[display]") {
+  Display display;
+  std::array<Byte, 2> sprite = {0b11111111, 0b11111111};
+
+  // wraps by default
+  display.draw_sprite(60, 31, sprite);
+  REQUIRE(display.get_pixel(63, 31) == true);
+  REQUIRE(display.get_pixel(0, 31) == true);
+  REQUIRE(display.get_pixel(60, 0) == true);
+
+  display.clear();
+  display.set_clip_sprites(true);
+  display.draw_sprite(60, 31, sprite);
+  REQUIRE(display.get_pixel(63, 31) == true);
+  REQUIRE(display.get_pixel(0, 31) == false);
+  REQUIRE(display.get_pixel(60, 0) == false);
+  REQUIRE(display.count_on_pixels() == 4);
+
+  // the start position still wraps
+  display.clear();
+  display.draw_sprite(64 + 2, 32 + 3, sprite);
+  REQUIRE(display.get_pixel(2, 3) == true);
+}
@@ -0,0 +1,71 @@
+#include "catch2/catch_test_macros.hpp"
+#include "core/cpu.hpp"
+#include "profiling/heatmap.hpp"
+
+using namespace chip8;
+
+TEST_CASE("Heatmap counts fetches at PC", "[heatmap]") {
+  Memory memory;
+  Timers timers;
+  Cpu cpu{memory, timers};
+  AccessHeatmap heatmap;
+  memory.set_heatmap(&heatmap);
+
+  std::vector<Byte> prog{0x12, 0x00}; // JP 0x200, tight loop
+  memory.load_rom(prog);
+
+  for (int i{0}; i < 10; ++i)
+    cpu.step();
+
+  REQUIRE(heatmap.count(AccessKind::Fetch, Address{0x200}) == 10);
+  REQUIRE(heatmap.total(AccessKind::Fetch) == 10);
+}
+
+TEST_CASE("Heatmap counts reads and writes", "[heatmap]") {
+  Memory memory;
+  AccessHeatmap heatmap;
+  memory.set_heatmap(&heatmap);
+
+  memory.write(Address{0x300}, 0xAA);
+  memory.write(Address{0x300}, 0xBB);
+  (void)memory.read(Address{0x300});
+  (void)memory.sprite_data(Address{0x310}, 5);
+
+  REQUIRE(heatmap.count(AccessKind::Write, Address{0x300}) == 2);
+  REQUIRE(heatmap.count(AccessKind::Read, Address{0x300}) == 1);
+  REQUIRE(heatmap.total(AccessKind::Read) == 6);
+}
+
+TEST_CASE("Heatmap detects self modifying code", "[heatmap]") {
+  Memory memory;
+  Timers timers;
+  Cpu cpu{memory, timers};
+  AccessHeatmap heatmap;
+  memory.set_heatmap(&heatmap);
+
+  std::vector<Byte> prog{
+      0x60, 0x12, // LD V0, 0x12
+      0xA2, 0x08, // LD I, 0x208
+      0xF0, 0x55, // LD [I], V0   overwrites the instruction at 0x208
+      0x12, 0x08, // JP 0x208
+      0x00, 0xE0, // patched to 0x12E0 before it runs
+  };
+  memory.load_rom(prog);
+  cpu.set_clear_display([] {});
+
+  for (int i{0}; i < 5; ++i)
+    cpu.step();
+
+  REQUIRE(heatmap.is_self_modified(Address{0x208}));
+  REQUIRE(heatmap.self_modified_count() == 1);
+}
+
+TEST_CASE("Heatmap CSV has one row per address", "[heatmap]") {
+  AccessHeatmap heatmap;
+  heatmap.record_fetch(Address{0x200});
+
+  const auto csv{heatmap.to_csv()};
+  REQUIRE(std::count(csv.begin(), csv.end(), '\n') ==
+      constants::MEMORY_SIZE + 1);
+  REQUIRE(csv.find("0x200,1,0,0\n") != std::string::npos);
+}
@@ -0,0 +1,77 @@
+#include "catch2/catch_test_macros.hpp"
+#include "profiling/latency_probe.hpp"
+
+using namespace chip8;
+using namespace std::chrono_literals;
+
+namespace {
+
+using Clock = LatencyProbe::Clock;
+
+void mark_all(LatencyProbe &probe, Clock::time_point input,
+              Clock::duration step) {
+  for (std::size_t s{0}; s < LATENCY_STAGE_COUNT; ++s)
+    probe.mark(static_cast<LatencyStage>(s),
+               input + step * static_cast<int>(s + 1));
+}
+
+}
+
+TEST_CASE("Latency probe completes an event at end drawing", "[latency]") {
+  LatencyProbe probe;
+  const Clock::time_point input{};
+  probe.begin(input);
+  REQUIRE(probe.pending());
+
+  // out of order stages are ignored until their turn
+  probe.mark(LatencyStage::Render, input + 1ms);
+  probe.mark(LatencyStage::KeyboardUpdate, input + 1ms);
+  probe.mark(LatencyStage::KeyboardUpdate, input + 9ms);
+  probe.mark(LatencyStage::CpuExecute, input + 2ms);
+  probe.mark(LatencyStage::DisplayChange, input + 3ms);
+  probe.mark(LatencyStage::Render, input + 4ms);
+  REQUIRE(probe.pending());
+  probe.mark(LatencyStage::EndDrawing, input + 20ms);
+
+  REQUIRE_FALSE(probe.pending());
+  REQUIRE(probe.samples() == 1);
+  const auto &sample{probe.raw().front()};
+  REQUIRE(sample[0] == 1ms);
+  REQUIRE(sample[3] == 4ms);
+  REQUIRE(sample[4] == 20ms);
+
+  // nothing is recorded without an open event
+  probe.mark(LatencyStage::KeyboardUpdate);
+  REQUIRE(probe.samples() == 1);
+}
+
+TEST_CASE("Latency probe percentiles use nearest rank", "[latency]") {
+  LatencyProbe probe;
+  REQUIRE(probe.percentile(LatencyStage::EndDrawing, 50).count() == 0.0);
+
+  const Clock::time_point input{};
+  for (int i{1}; i <= 10; ++i) {
+    probe.begin(input);
+    mark_all(probe, input, std::chrono::milliseconds{i});
+  }
+  REQUIRE(probe.samples() == 10);
+
+  // end drawing is the fifth stage, event i ends at 5 * i ms
+  REQUIRE(probe.percentile(LatencyStage::EndDrawing, 50).count() == 25.0);
+  REQUIRE(probe.percentile(LatencyStage::EndDrawing, 90).count() == 45.0);
+  REQUIRE(probe.percentile(LatencyStage::EndDrawing, 100).count() == 50.0);
+  REQUIRE(probe.percentile(LatencyStage::KeyboardUpdate, 0).count() == 1.0);
+}
+
+TEST_CASE("Latency probe counts dropped events", "[latency]") {
+  LatencyProbe probe;
+  probe.begin();
+  probe.mark(LatencyStage::KeyboardUpdate);
+  probe.begin(); // the first press never reached the screen
+  probe.abandon();
+  probe.abandon(); // nothing open, nothing dropped
+
+  REQUIRE(probe.dropped() == 2);
+  REQUIRE(probe.samples() == 0);
+  REQUIRE_FALSE(probe.pending());
+}
@@ -1,6 +1,11 @@
 #include "catch2/catch_test_macros.hpp"
 #include "utils/logger.hpp"
 
+#include <algorithm>
+#include <sstream>
+#include <thread>
+#include <vector>
+
 TEST_CASE("Logger respects log level", "[logger]") {
   std::ostringstream output;
 
@@ -33,4 +38,116 @@ TEST_CASE("Logger formats messages correctly", "[logger]") {
 
   LOG_INFO("Value: {}", 42);
   REQUIRE(output.str().find("Value: 42") != std::string::npos);
-}
\ No newline at end of file
+}
+
+TEST_CASE("Async logger writes after flush", "[logger]") {
+  std::ostringstream output;
+
+  chip8::Logger::instance().configure({
+      .min_level = chip8::LogLevel::Trace,
+      .show_timestamp = false,
+      .show_level = true,
+      .show_location = false,
+      .output = &output,
+      .async = true});
+
+  REQUIRE(chip8::Logger::instance().is_async());
+  LOG_INFO("Async value: {}", 7);
+  chip8::Logger::instance().flush();
+
+  REQUIRE(output.str() == "[INFO] Async value: 7\n");
+  chip8::Logger::instance().configure({});
+}
+
+TEST_CASE("Async logger collects messages from many threads", "[logger]") {
+  std::ostringstream output;
+
+  chip8::Logger::instance().configure({
+      .min_level = chip8::LogLevel::Trace,
+      .show_timestamp = false,
+      .show_level = false,
+      .show_location = false,
+      .output = &output,
+      .async = true});
+
+  constexpr int THREADS{4};
+  constexpr int MESSAGES{200};
+  {
+    std::vector<std::jthread> threads;
+    for (int t{0}; t < THREADS; ++t)
+      threads.emplace_back([t] {
+        for (int i{0}; i < MESSAGES; ++i)
+          LOG_INFO("t{} m{}", t, i);
+      });
+  }
+  chip8::Logger::instance().flush();
+
+  const auto text{output.str()};
+  const auto lines{std::count(text.begin(), text.end(), '\n')};
+  REQUIRE(lines + static_cast<long>(chip8::Logger::instance().dropped()) ==
+      THREADS * MESSAGES);
+  REQUIRE(text.find("t3 m199\n") != std::string::npos);
+  chip8::Logger::instance().configure({});
+}
+
+TEST_CASE("Async logger marks truncated messages", "[logger]") {
+  std::ostringstream output;
+
+  chip8::Logger::instance().configure({
+      .min_level = chip8::LogLevel::Trace,
+      .show_timestamp = false,
+      .show_level = false,
+      .show_location = false,
+      .output = &output,
+      .async = true});
+
+  const std::string fits(chip8::LogRecord::MAX_MESSAGE, 'a');
+  const std::string too_long(chip8::LogRecord::MAX_MESSAGE + 1, 'b');
+  LOG_INFO("{}", fits);
+  LOG_INFO("{}", too_long);
+  chip8::Logger::instance().flush();
+
+  const auto kept{chip8::LogRecord::MAX_MESSAGE -
+                  chip8::LogRecord::TRUNCATED.size()};
+  REQUIRE(output.str() ==
+          fits + "\n" + std::string(kept, 'b') + "...\n");
+  chip8::Logger::instance().configure({});
+}
+
+TEST_CASE("Log level floor is a compile time constant", "[logger]") {
+  STATIC_REQUIRE(chip8::COMPILE_TIME_LOG_LEVEL ==
+      static_cast<chip8::LogLevel>(CHIP8_LOG_MIN_LEVEL));
+}
+
+TEST_CASE("Timestamp provider formats wall clock time", "[logger]") {
+  chip8::TimestampProvider timestamps{chip8::TimestampMode::WallClock};
+  const auto now{chip8::TimestampProvider::now()};
+
+  std::string out;
+  timestamps.append(out, now);
+  REQUIRE(out.size() == 13); // "HH:MM:SS.mmm "
+  REQUIRE(out[2] == ':');
+  REQUIRE(out[5] == ':');
+  REQUIRE(out[8] == '.');
+  REQUIRE(out.back() == ' ');
+
+  // same second reuses the cached prefix
+  out.clear();
+  timestamps.append(out, now + std::chrono::microseconds{1});
+  REQUIRE(timestamps.cache_misses() == 1);
+  timestamps.append(out, now + std::chrono::seconds{2});
+  REQUIRE(timestamps.cache_misses() == 2);
+}
+
+TEST_CASE("Timestamp provider formats relative time", "[logger]") {
+  const auto origin{chip8::TimestampProvider::now()};
+  chip8::TimestampProvider timestamps{chip8::TimestampMode::Relative, origin};
+
+  std::string out;
+  timestamps.append(out, origin + std::chrono::milliseconds{1500});
+  REQUIRE(out == "+1.500 ");
+
+  out.clear();
+  timestamps.append(out, origin + std::chrono::milliseconds{62'007});
+  REQUIRE(out == "+62.007 ");
+}
@@ -0,0 +1,384 @@
+#include "catch2/catch_test_macros.hpp"
+#include "core/machine.hpp"
+#include "core/quirk_detector.hpp"
+#include "core/cycle_detector.hpp"
+#include "core/reset_pool.hpp"
+#include "core/run_ahead.hpp"
+#include "core/state_forker.hpp"
+#include "input/input_script.hpp"
+
+#include <vector>
+
+using namespace chip8;
+
+namespace {
+
+// V0 = 0, V1 = 4, 8106. only the shift quirk leaves V1 == 2 and skips the
+// invalid opcode, then the rom idles
+const std::vector<Byte> SHIFT_ROM{0x60, 0x00, 0x61, 0x04, 0x81, 0x06,
+                                  0x31, 0x02, 0xFF, 0xFF, 0x12, 0x0A};
+
+}
+
+TEST_CASE("Machine runs a fixed number of cycles per frame", "[machine]") {
+  Machine machine{CpuConfig{.frequency_hz = 600.0}};
+  const std::vector<Byte> rom{0x70, 0x01, 0x12, 0x00}; // ADD V0, 1; JP 200
+  REQUIRE(machine.load_rom(rom).is_ok());
+
+  REQUIRE(machine.cycles_per_frame() == 10);
+  REQUIRE(machine.run_frame().is_ok());
+  REQUIRE(machine.frame_count() == 1);
+  REQUIRE(machine.cycle_count() == 10);
+  REQUIRE(machine.cpu().reg(RegisterIndex{0}).get() == 5);
+
+  machine.reset();
+  REQUIRE(machine.cycle_count() == 0);
+  REQUIRE(machine.cpu().reg(RegisterIndex{0}).get() == 0);
+  REQUIRE(machine.memory().read(Address{0x200}) == 0x70);
+}
+
+TEST_CASE("Machine runs are deterministic for a seed", "[machine]") {
+  // RND V0..V3 in a loop
+  const std::vector<Byte> rom{0xC0, 0xFF, 0xC1, 0xFF, 0xC2, 0xFF,
+                              0xC3, 0xFF, 0x12, 0x00};
+  const auto run{[&](std::uint32_t seed) {
+    Machine machine;
+    REQUIRE(machine.load_rom(rom).is_ok());
+    machine.seed(seed);
+    for (int i{0}; i < 7; ++i)
+      REQUIRE(machine.run_frame().is_ok());
+    return machine.cpu().state().registers;
+  }};
+
+  REQUIRE(run(1234) == run(1234));
+  REQUIRE(run(1234) != run(4321));
+}
+
+TEST_CASE("Machine key wait completes on a new press", "[machine]") {
+  Machine machine;
+  const std::vector<Byte> rom{0xF5, 0x0A, 0x12, 0x00}; // LD V5, K; loop
+  REQUIRE(machine.load_rom(rom).is_ok());
+
+  REQUIRE(machine.run_frame().is_ok());
+  REQUIRE(machine.cpu().state().waiting_for_key);
+
+  machine.set_keys(1u << 3);
+  REQUIRE(machine.run_frame().is_ok());
+  REQUIRE(machine.cpu().reg(RegisterIndex{5}).get() == 3);
+
+  // a key still held from the last frame doesn't count
+  REQUIRE(machine.run_frame().is_ok());
+  REQUIRE(machine.cpu().state().waiting_for_key);
+
+  machine.set_keys((1u << 3) | (1u << 9) | (1u << 7));
+  REQUIRE(machine.run_frame().is_ok());
+  REQUIRE(machine.cpu().reg(RegisterIndex{5}).get() == 7);
+}
+
+TEST_CASE("Machine reports memory faults as errors", "[machine]") {
+  Machine machine;
+  const std::vector<Byte> rom{0xAF, 0xFF, 0xF1, 0x65}; // LD I, FFF; LD V1, [I]
+  REQUIRE(machine.load_rom(rom).is_ok());
+
+  auto result{machine.run_frame()};
+  REQUIRE(result.is_err());
+  REQUIRE(result.error().category() == Error::Category::Memory);
+  // coded, allocates nothing
+  REQUIRE(result.error().code() == Error::Code::MemoryOutOfRange);
+  REQUIRE(result.error().payload() == 0x1000);
+  REQUIRE(result.error().address() == 0x202);
+  REQUIRE(result.error().message() ==
+          "Memory access out of bounds: $1000 at $202");
+
+  // the fault is taken, the next frame starts clean
+  machine.reset();
+  REQUIRE_FALSE(machine.memory().has_fault());
+}
+
+TEST_CASE("Stray memory faults are not charged to the cpu", "[machine]") {
+  Machine machine;
+  const std::vector<Byte> rom{0x12, 0x00}; // JP 200
+  REQUIRE(machine.load_rom(rom).is_ok());
+  const auto snapshot{machine.snapshot()};
+
+  // e.g. a debugger peeking past the end of memory
+  REQUIRE(machine.memory().read(Address{0x1000}) == 0);
+  REQUIRE(machine.memory().has_fault());
+  REQUIRE(machine.run_frame().is_ok());
+
+  (void)machine.memory().read(Address{0x1000});
+  machine.restore(snapshot);
+  REQUIRE_FALSE(machine.memory().has_fault());
+}
+
+TEST_CASE("InputScript holds keys until the next event", "[machine][input]") {
+  InputScript script;
+  script.add(10, 0x0002);
+  script.add(4, 0x0001);
+  script.add(12, 0);
+
+  REQUIRE(script.keys_at(0) == 0);
+  REQUIRE(script.keys_at(4) == 0x0001);
+  REQUIRE(script.keys_at(9) == 0x0001);
+  REQUIRE(script.keys_at(10) == 0x0002);
+  REQUIRE(script.keys_at(100) == 0);
+
+  const auto sweep{InputScript::key_sweep(200, 6, 24)};
+  REQUIRE(sweep.keys_at(23) == 0);
+  REQUIRE(sweep.keys_at(24) == 0x0001);
+  REQUIRE(sweep.keys_at(30) == 0);
+  REQUIRE(sweep.keys_at(54) == 0x0002);
+}
+
+TEST_CASE("InputScript parses recorded input", "[machine][input]") {
+  const auto script{InputScript::parse("# title screen\n"
+                                       "30 0020\n"
+                                       "\n"
+                                       "36 0   # release\r\n"
+                                       "90\t8001\n")};
+  REQUIRE(script.is_ok());
+  REQUIRE(script.value().events().size() == 3);
+  REQUIRE(script.value().keys_at(29) == 0);
+  REQUIRE(script.value().keys_at(30) == 0x0020);
+  REQUIRE(script.value().keys_at(36) == 0);
+  REQUIRE(script.value().keys_at(90) == 0x8001);
+
+  REQUIRE(InputScript::parse("30\n").is_err());
+  REQUIRE(InputScript::parse("30 zz\n").is_err());
+  REQUIRE(InputScript::parse("30 1 2\n").is_err());
+}
+
+TEST_CASE("Machine frame timing splits cpu and display time", "[machine]") {
+  // CLS; DRW V0, V0, 5; JP 200
+  const std::vector<Byte> rom{0x00, 0xE0, 0xD0, 0x05, 0x12, 0x00};
+  Machine machine{CpuConfig{.frequency_hz = 600.0}};
+  REQUIRE(machine.load_rom(rom).is_ok());
+
+  FrameTiming timing;
+  machine.set_frame_timing(&timing);
+  for (int i{0}; i < 10; ++i)
+    REQUIRE(machine.run_frame().is_ok());
+  REQUIRE(timing.display.count() > 0);
+  REQUIRE(timing.cpu.count() > 0);
+  REQUIRE(timing.total() == timing.cpu + timing.display + timing.timers);
+
+  const auto before{timing.total()};
+  machine.set_frame_timing(nullptr);
+  REQUIRE(machine.run_frame().is_ok());
+  REQUIRE(timing.total() == before);
+}
+
+TEST_CASE("Quirk detector prefers runs that don't fault", "[machine][quirks]") {
+  const QuirkDetector detector{QuirkDetectorConfig{.frames = 30}};
+  const auto scores{detector.score_all(SHIFT_ROM)};
+
+  for (std::size_t i{0}; i < QuirkDetector::COMBINATIONS; ++i) {
+    const auto &score{scores[i]};
+    REQUIRE(score.profile.shift_quirk == ((i & 1) != 0));
+    REQUIRE(score.fault.has_value() != score.profile.shift_quirk);
+  }
+
+  const auto detected{detector.detect(SHIFT_ROM)};
+  REQUIRE(detected.shift_quirk);
+  REQUIRE_FALSE(detected.load_store_quirk);
+  REQUIRE_FALSE(detected.jump_quirk);
+  REQUIRE_FALSE(detected.clip_sprites);
+}
+
+TEST_CASE("Reset pool restores the post warm-up image", "[machine]") {
+  const std::vector<Byte> rom{0x70, 0x01, 0x12, 0x00}; // ADD V0, 1; JP 200
+  ResetPool pool{3};
+
+  Machine first{CpuConfig{.frequency_hz = 600.0}};
+  REQUIRE(first.load_rom(rom).is_ok());
+  pool.reset(first);
+  REQUIRE(pool.size() == 1);
+  REQUIRE(first.frame_count() == 3);
+  REQUIRE(first.cpu().reg(RegisterIndex{0}).get() == 15);
+
+  // a second machine reuses the image instead of warming up again
+  Machine second{CpuConfig{.frequency_hz = 600.0}};
+  REQUIRE(second.load_rom(rom).is_ok());
+  for (int i{0}; i < 5; ++i)
+    REQUIRE(second.run_frame().is_ok());
+  pool.reset(second);
+  REQUIRE(pool.size() == 1);
+  REQUIRE(second.frame_count() == 3);
+  REQUIRE(second.cpu().state().registers == first.cpu().state().registers);
+  REQUIRE(&pool.image(second) == &pool.image(first));
+}
+
+TEST_CASE("Reset pool warm-up is reproducible", "[machine]") {
+  const std::vector<Byte> rom{0xC0, 0xFF, 0x12, 0x00}; // RND V0, FF; JP 200
+
+  const auto warm_up{[&](std::uint32_t seed) {
+    ResetPool pool{2, 0, seed};
+    Machine machine{CpuConfig{.frequency_hz = 600.0}};
+    REQUIRE(machine.load_rom(rom).is_ok());
+    return pool.image(machine).cpu;
+  }};
+
+  // machines start from random_device, the pool seeds them first
+  REQUIRE(warm_up(7).registers == warm_up(7).registers);
+  REQUIRE(warm_up(7).rng == warm_up(7).rng);
+  REQUIRE(warm_up(7).rng != warm_up(8).rng);
+}
+
+TEST_CASE("State forker shares pages and folds identical children",
+          "[machine][fork]") {
+  // key 0 bumps V1, key 5 writes to 0x300, every other key does nothing
+  const std::vector<Byte> rom{
+      0x60, 0x00, 0xE0, 0x9E, 0x12, 0x0A, 0x71, 0x01, 0x12, 0x08,
+      0x60, 0x05, 0xE0, 0xA1, 0x12, 0x14, 0x12, 0x10, 0x00, 0x00,
+      0xA3, 0x00, 0xF0, 0x55, 0x12, 0x18};
+  const CpuConfig config{.frequency_hz = 600.0};
+
+  Machine machine{config};
+  REQUIRE(machine.load_rom(rom).is_ok());
+  const auto parent{machine.snapshot()};
+
+  StateForker forker{config};
+  const auto children{forker.expand(parent)};
+  REQUIRE(children.size() == 16);
+  REQUIRE(forker.unique_children() == 3);
+  REQUIRE_FALSE(children[0].is_duplicate(0));
+  REQUIRE_FALSE(children[1].is_duplicate(1));
+  REQUIRE_FALSE(children[5].is_duplicate(5));
+  REQUIRE(children[9].duplicate_of == 1);
+  REQUIRE(children[0].pages == 0);
+  REQUIRE(children[5].pages == 1u << 3);
+
+  // applying a child matches running the frame for real
+  auto state{parent};
+  forker.apply(5, state);
+  machine.set_keys(1u << 5);
+  REQUIRE(machine.run_frame().is_ok());
+  REQUIRE(state.memory == machine.memory().data());
+  REQUIRE(state.memory[0x300] == 5);
+  REQUIRE(state.cpu.program_counter == machine.cpu().state().program_counter);
+  REQUIRE(state.frames == machine.frame_count());
+
+  StateHasher hasher;
+  REQUIRE(hasher.hash(machine, Memory::ALL_PAGES) == children[5].hash);
+
+  // the forker left the parent untouched
+  auto again{parent};
+  forker.apply(0, again);
+  REQUIRE(again.cpu.registers[1].get() == 1);
+  REQUIRE(parent.cpu.registers[1].get() == 0);
+}
+
+namespace {
+
+// reads key 0 after drawing, so a press shows up one iteration late like
+// most games. one loop is about one frame at 600 Hz
+const std::vector<Byte> LAGGY_ROM{
+    0x00, 0xE0, // CLS
+    0xF0, 0x29, // LD F, V0
+    0xD2, 0x35, // DRW V2, V3, 5
+    0x62, 0x00, // LD V2, 0
+    0xE4, 0xA1, // SKNP V4
+    0x62, 0x08, // LD V2, 8
+    0x6F, 0x00, // LD VF, 0
+    0x6F, 0x00, // LD VF, 0
+    0x6F, 0x00, // LD VF, 0
+    0x12, 0x00  // JP 200
+};
+
+// frames from pressing key 0 until the presented frame shows the sprite
+int measure_latency(int run_ahead) {
+  Machine machine{CpuConfig{.frequency_hz = 600.0}};
+  REQUIRE(machine.load_rom(LAGGY_ROM).is_ok());
+  RunAhead ahead{run_ahead};
+  for (int i{0}; i < 5; ++i)
+    REQUIRE(ahead.run_frame(machine).is_ok());
+
+  machine.set_keys(0x0001);
+  for (int frame{1}; frame <= 10; ++frame) {
+    REQUIRE(ahead.run_frame(machine).is_ok());
+    if (ahead.presented()[8])
+      return frame;
+  }
+  return -1;
+}
+
+}
+
+TEST_CASE("Run-ahead presents input a frame sooner", "[machine]") {
+  // the press is seen on the frame it happens at best, run-ahead can't
+  // go below that
+  const auto base{measure_latency(0)};
+  REQUIRE(base == 2);
+  REQUIRE(measure_latency(1) == 1);
+  REQUIRE(measure_latency(2) == 1);
+
+  // the real machine never sees the speculative frames
+  Machine plain{CpuConfig{.frequency_hz = 600.0}};
+  Machine ahead_machine{CpuConfig{.frequency_hz = 600.0}};
+  REQUIRE(plain.load_rom(LAGGY_ROM).is_ok());
+  REQUIRE(ahead_machine.load_rom(LAGGY_ROM).is_ok());
+  RunAhead ahead{2};
+  for (int i{0}; i < 8; ++i) {
+    plain.set_keys(i > 3 ? 1 : 0);
+    ahead_machine.set_keys(i > 3 ? 1 : 0);
+    REQUIRE(plain.run_frame().is_ok());
+    REQUIRE(ahead.run_frame(ahead_machine).is_ok());
+  }
+  REQUIRE(ahead_machine.memory().data() == plain.memory().data());
+  REQUIRE(ahead_machine.display().buffer() == plain.display().buffer());
+  REQUIRE(ahead_machine.frame_count() == plain.frame_count());
+}
+
+TEST_CASE("Cycle detector finds a self jump", "[machine][cycle]") {
+  Machine machine;
+  const std::vector<Byte> rom{0x12, 0x00}; // JP 200
+  REQUIRE(machine.load_rom(rom).is_ok());
+
+  CycleDetector detector;
+  const auto summary{run_until(machine, 1'000'000, detector)};
+  REQUIRE(summary.is_ok());
+  REQUIRE(summary->cycle.has_value());
+  REQUIRE(summary->cycle->period == 1);
+  REQUIRE(summary->frames_emulated < 5);
+  REQUIRE(machine.frame_count() == 1'000'000);
+  REQUIRE(machine.cycle_count() ==
+          1'000'000 * static_cast<std::uint64_t>(machine.cycles_per_frame()));
+}
+
+TEST_CASE("Cycle detector fast-forward matches a full run",
+          "[machine][cycle]") {
+  // blink a digit every 5 frames, the state repeats every 2 blinks
+  const std::vector<Byte> rom{
+      0x60, 0x05, // LD V0, 5
+      0xF0, 0x15, // LD DT, V0
+      0xF1, 0x07, // LD V1, DT
+      0x31, 0x00, // SE V1, 0
+      0x12, 0x04, // JP 204
+      0xF3, 0x29, // LD F, V3
+      0xD3, 0x35, // DRW V3, V3, 5
+      0x12, 0x00  // JP 200
+  };
+
+  Machine full;
+  Machine skipped;
+  REQUIRE(full.load_rom(rom).is_ok());
+  REQUIRE(skipped.load_rom(rom).is_ok());
+
+  for (int i{0}; i < 1003; ++i)
+    REQUIRE(full.run_frame().is_ok());
+
+  CycleDetector detector;
+  const auto summary{run_until(skipped, 1003, detector)};
+  REQUIRE(summary.is_ok());
+  REQUIRE(summary->cycle.has_value());
+  REQUIRE(summary->frames_emulated < 100);
+
+  REQUIRE(skipped.frame_count() == full.frame_count());
+  REQUIRE(skipped.cycle_count() == full.cycle_count());
+  REQUIRE(skipped.memory().data() == full.memory().data());
+  REQUIRE(skipped.display().buffer() == full.display().buffer());
+  REQUIRE(skipped.cpu().state().program_counter ==
+          full.cpu().state().program_counter);
+  REQUIRE(skipped.timers().state().delay_timer ==
+          full.timers().state().delay_timer);
+}
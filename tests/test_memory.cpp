@@ -72,4 +72,26 @@ TEST_CASE("Memory view returns correct span", "[memory]") {
   REQUIRE(span[0] == 0xAA);
   REQUIRE(span[1] == 0xBB);
   REQUIRE(span[2] == 0xCC);
-}
\ No newline at end of file
+}
+
+TEST_CASE("Memory tracks dirty pages", "[memory]") {
+  Memory mem;
+  REQUIRE(mem.dirty_pages() == Memory::ALL_PAGES);
+  mem.clear_dirty_pages();
+
+  mem.write(Address{0x300}, 0x01);
+  REQUIRE(mem.dirty_pages() == 1u << 3);
+
+  // a range straddling a page boundary marks both pages
+  const std::array<Byte, 4> data{1, 2, 3, 4};
+  mem.write_range(Address{0x4FE}, data);
+  REQUIRE(mem.dirty_pages() == ((1u << 3) | (1u << 4) | (1u << 5)));
+
+  const auto original{mem.data()};
+  mem.clear_dirty_pages();
+  mem.write(Address{0x300}, 0xFF);
+  mem.write(Address{0xA00}, 0xFF);
+  mem.restore_pages(original, 1u << 3);
+  REQUIRE(mem.read(Address{0x300}) == 0x01);
+  REQUIRE(mem.read(Address{0xA00}) == 0xFF);
+}
@@ -0,0 +1,85 @@
+#include "catch2/catch_test_macros.hpp"
+#include "core/machine.hpp"
+#include "core/run_ahead.hpp"
+#include "profiling/perf_counters.hpp"
+
+#include <array>
+
+using namespace chip8;
+
+namespace {
+
+// clears the screen and draws the font's 0 forever
+constexpr std::array<Byte, 10> DRAW_LOOP{
+    0x00, 0xE0, // 00E0
+    0xF0, 0x29, // F029 I = font 0
+    0xD0, 0x05, // D005
+    0x12, 0x00, // JP 200
+};
+
+}
+
+TEST_CASE("Perf counters open or explain why not", "[perf]") {
+  auto counters{PerfCounters::open()};
+  if (!counters) {
+    // no pmu, a container or perf_event_paranoid, the caller carries on
+    REQUIRE(counters.error().category() == Error::Category::Runtime);
+    REQUIRE_FALSE(counters.error().message().empty());
+    SKIP(counters.error().message());
+  }
+
+  auto &perf{counters.value()};
+  perf.switch_to(PerfPhase::Cpu);
+  volatile std::uint64_t sum{0};
+  for (std::uint64_t i{0}; i < 100'000; ++i)
+    sum = sum + i;
+  perf.switch_to(PerfPhase::Idle);
+  perf.end_frame(1'000);
+
+  if (perf.supported(PerfEvent::Instructions)) {
+    REQUIRE(perf.total(PerfPhase::Cpu, PerfEvent::Instructions) > 100'000);
+    REQUIRE(perf.per_instruction(PerfPhase::Cpu, PerfEvent::Instructions) >
+            100.0);
+  }
+  REQUIRE(perf.total(PerfPhase::Render, PerfEvent::Instructions) == 0);
+  REQUIRE(perf.frames() == 1);
+}
+
+TEST_CASE("Machine charges perf counters to cpu and display", "[perf]") {
+  auto counters{PerfCounters::open()};
+  if (!counters)
+    SKIP(counters.error().message());
+  auto &perf{counters.value()};
+  if (!perf.supported(PerfEvent::Instructions))
+    SKIP("no instruction counter");
+
+  Machine machine{CpuConfig{.frequency_hz = 700.0}};
+  REQUIRE(machine.load_rom(DRAW_LOOP).is_ok());
+  machine.set_perf_counters(&perf);
+  for (int frame{0}; frame < 60; ++frame)
+    REQUIRE(machine.run_frame().is_ok());
+  perf.end_frame(machine.cycle_count());
+
+  REQUIRE(perf.total(PerfPhase::Cpu, PerfEvent::Instructions) > 0);
+  REQUIRE(perf.total(PerfPhase::Display, PerfEvent::Instructions) > 0);
+  // run_frame hands the counters back to whoever ran before it
+  REQUIRE(perf.switch_to(PerfPhase::Idle) == PerfPhase::Idle);
+}
+
+TEST_CASE("Run-ahead frames are not charged to perf counters", "[perf]") {
+  auto counters{PerfCounters::open()};
+  if (!counters)
+    SKIP(counters.error().message());
+  auto &perf{counters.value()};
+
+  Machine machine{CpuConfig{.frequency_hz = 700.0}};
+  REQUIRE(machine.load_rom(DRAW_LOOP).is_ok());
+  machine.set_perf_counters(&perf);
+  RunAhead run_ahead{RunAhead::MAX_FRAMES};
+  perf.switch_to(PerfPhase::Cpu);
+  REQUIRE(run_ahead.run_frame(machine).is_ok());
+
+  // counting resumes in the caller's phase, the machine keeps its counters
+  REQUIRE(perf.switch_to(PerfPhase::Idle) == PerfPhase::Cpu);
+  REQUIRE(machine.perf_counters() == &perf);
+}
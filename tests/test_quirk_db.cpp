@@ -0,0 +1,60 @@
+#include "catch2/catch_test_macros.hpp"
+#include "utils/hash.hpp"
+#include "utils/quirk_db.hpp"
+#include "utils/quirk_profiles.hpp"
+#include "utils/rom_loader.hpp"
+
+using namespace chip8;
+
+TEST_CASE("Quirk database is a perfect hash", "[quirks]") {
+  // every entry resolves to itself, at compile time too
+  STATIC_REQUIRE(find_quirks(KNOWN_QUIRKS[0].hash) == &QUIRK_DB.entries()[0]);
+  for (const auto &entry : KNOWN_QUIRKS) {
+    const auto *found{find_quirks(entry.hash)};
+    REQUIRE(found != nullptr);
+    REQUIRE(found->name == entry.name);
+  }
+
+  REQUIRE(find_quirks(0) == nullptr);
+  REQUIRE(find_quirks(0xDEADBEEFCAFEF00DULL) == nullptr);
+}
+
+TEST_CASE("Quirk database matches the ROMs it names", "[quirks]") {
+  const std::filesystem::path blitz{"roms/games/Blitz [David Winter].ch8"};
+  auto rom{RomLoader::load(blitz)};
+  REQUIRE(rom.is_ok());
+
+  const auto *entry{find_quirks(rom_hash(rom->as_span()))};
+  REQUIRE(entry != nullptr);
+  REQUIRE(entry->profile.clip_sprites);
+
+  const std::filesystem::path pong{"roms/games/Pong [Paul Vervalin, 1990].ch8"};
+  auto unknown{RomLoader::load(pong)};
+  REQUIRE(unknown.is_ok());
+  REQUIRE(find_quirks(rom_hash(unknown->as_span())) == nullptr);
+}
+
+TEST_CASE("Quirk profiles round trip through the store", "[quirks]") {
+  const auto dir{std::filesystem::temp_directory_path() /
+                 "chip8_test_profiles"};
+  std::filesystem::remove_all(dir);
+  const QuirkProfileStore store{dir};
+
+  REQUIRE_FALSE(store.load(0x1234).has_value());
+
+  const QuirkProfile profile{.shift_quirk = true,
+                             .jump_quirk = true,
+                             .frequency_hz = 1000.0};
+  REQUIRE(store.save(0x1234, profile).is_ok());
+  REQUIRE(store.path_for(0x1234).filename() == "0000000000001234.quirks");
+
+  const auto loaded{store.load(0x1234)};
+  REQUIRE(loaded.has_value());
+  REQUIRE(loaded->shift_quirk);
+  REQUIRE_FALSE(loaded->load_store_quirk);
+  REQUIRE(loaded->jump_quirk);
+  REQUIRE_FALSE(loaded->clip_sprites);
+  REQUIRE(loaded->frequency_hz == 1000.0);
+
+  std::filesystem::remove_all(dir);
+}
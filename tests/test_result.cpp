@@ -93,4 +93,35 @@ TEST_CASE("Result::inspect_err calls function on Error", "[result]") {
   bad.inspect_err([&](const chip8::Error &e) { captured = e.message(); });
 
   REQUIRE(captured == "something broke");
-}
\ No newline at end of file
+}
+
+TEST_CASE("Interpreter errors format their message on demand", "[result]") {
+  static_assert(std::is_trivially_copyable_v<chip8::Fault>);
+
+  const chip8::StepResult bad{chip8::Fault::unknown_opcode(0xF0FF, 0x2A4)};
+  REQUIRE(bad.is_err());
+  REQUIRE(bad.error().category() == chip8::Fault::Category::InvalidOpcode);
+  REQUIRE(bad.error().code() == chip8::Fault::Code::UnknownOpcode);
+  REQUIRE(bad.error().payload() == 0xF0FF);
+  REQUIRE(bad.error().address() == 0x2A4);
+  REQUIRE(bad.error().message() == "Unknown opcode: $F0FF at $2A4");
+
+  const chip8::Error overflow{chip8::Fault::stack_overflow(0x300)};
+  REQUIRE(overflow.message() == "Stack overflow on CALL at $300");
+  REQUIRE(overflow.file().empty());
+  REQUIRE(overflow.line() != 0);
+
+  const chip8::Result<void> widened{bad};
+  REQUIRE(widened.error().code() == chip8::Error::Code::UnknownOpcode);
+}
+
+TEST_CASE("Free form error messages are owned by the error", "[result]") {
+  const auto error{chip8::Error::config("first")};
+  for (int i{0}; i < 1000; ++i)
+    (void)chip8::Error::io("filler");
+
+  const auto copy{error};
+  REQUIRE(copy.message() == "first");
+  REQUIRE_FALSE(copy.file().empty());
+  REQUIRE(copy.category() == chip8::Error::Category::Config);
+}
@@ -0,0 +1,96 @@
+#include "catch2/catch_test_macros.hpp"
+#include "utils/rom_catalog.hpp"
+
+#include <fstream>
+
+using namespace chip8;
+
+namespace {
+
+void write_file(const std::filesystem::path &path,
+                std::initializer_list<Byte> bytes) {
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  for (const auto b : bytes)
+    file.put(static_cast<char>(b));
+}
+
+class RomCatalogTestClass {
+protected:
+  std::filesystem::path root{std::filesystem::temp_directory_path() /
+                             "chip8_catalog_test"};
+  std::filesystem::path index{root / RomCatalog::DEFAULT_INDEX_NAME};
+
+  RomCatalogTestClass() {
+    std::filesystem::remove_all(root);
+    std::filesystem::create_directories(root / "hires");
+    write_file(root / "pong.ch8", {0x6A, 0x02, 0x6B, 0x0C});
+    write_file(root / "hires" / "maze.ch8", {0x12, 0x60, 0x01, 0x7A});
+    std::ofstream{root / "pong.txt"} << "Pong\twith a tab\n\n";
+    std::ofstream{root / "notes.md"} << "not a rom";
+  }
+
+  ~RomCatalogTestClass() { std::filesystem::remove_all(root); }
+};
+
+}
+
+TEST_CASE("Xxh64 matches the reference vectors", "[catalog]") {
+  STATIC_REQUIRE(Xxh64::hash(std::string_view{""}) == 0xEF46DB3751D8E999ULL);
+  STATIC_REQUIRE(Xxh64::hash(std::string_view{"abc"}) ==
+      0x44BC2CF5AD770999ULL);
+
+  // the 32 byte stripe loop
+  constexpr std::string_view long_text{
+      "The quick brown fox jumps over the lazy dog"};
+  const std::vector<Byte> bytes(long_text.begin(), long_text.end());
+  REQUIRE(Xxh64::hash(bytes) == Xxh64::hash(long_text));
+}
+
+TEST_CASE_METHOD(RomCatalogTestClass, "Catalog scans and describes ROMs",
+                 "[catalog]") {
+  auto catalog{RomCatalog::scan(root, index, 2)};
+  REQUIRE(catalog.is_ok());
+  REQUIRE(catalog->size() == 2);
+  REQUIRE(catalog->stats().hashed == 2);
+  REQUIRE(catalog->stats().index_written);
+
+  const auto *pong{catalog->find_by_path("pong.ch8")};
+  REQUIRE(pong != nullptr);
+  REQUIRE(pong->size == 4);
+  REQUIRE(pong->platform == RomPlatform::Chip8);
+  REQUIRE(pong->description == "Pong\twith a tab");
+
+  const std::vector<Byte> pong_bytes{0x6A, 0x02, 0x6B, 0x0C};
+  REQUIRE(catalog->find_by_hash(rom_hash(pong_bytes)) == pong);
+
+  const auto *maze{catalog->find_by_path("hires/maze.ch8")};
+  REQUIRE(maze != nullptr);
+  REQUIRE(maze->platform == RomPlatform::VipHires);
+}
+
+TEST_CASE_METHOD(RomCatalogTestClass, "Catalog reuses a warm index",
+                 "[catalog]") {
+  REQUIRE(RomCatalog::scan(root, index).is_ok());
+
+  auto warm{RomCatalog::scan(root, index)};
+  REQUIRE(warm.is_ok());
+  REQUIRE(warm->stats().reused == 2);
+  REQUIRE(warm->stats().hashed == 0);
+  REQUIRE_FALSE(warm->stats().index_written);
+  REQUIRE(warm->find_by_path("pong.ch8")->description == "Pong\twith a tab");
+
+  // a changed size invalidates the entry
+  write_file(root / "pong.ch8", {0x6A, 0x02, 0x6B, 0x0C, 0x00, 0xE0});
+  auto rescanned{RomCatalog::scan(root, index)};
+  REQUIRE(rescanned.is_ok());
+  REQUIRE(rescanned->stats().reused == 1);
+  REQUIRE(rescanned->stats().hashed == 1);
+  REQUIRE(rescanned->find_by_path("pong.ch8")->size == 6);
+}
+
+TEST_CASE("Catalog rejects a corrupt index", "[catalog]") {
+  REQUIRE(RomCatalog::parse_index("something else\n").is_err());
+  REQUIRE(RomCatalog::parse_index(
+      "chip8-catalog\t1\na.ch8\tnot a number\t0\t0\t0\t\n").is_err());
+  REQUIRE(RomCatalog::parse_index("chip8-catalog\t1\n").is_ok());
+}
@@ -1,6 +1,10 @@
 #include "catch2/catch_test_macros.hpp"
+#include "core/memory.hpp"
 #include "utils/rom_loader.hpp"
 
+#include <fstream>
+#include <iterator>
+
 TEST_CASE("RomLoader loads valid ROM file", "[rom]") {
   std::filesystem::path path{"roms/programs/Chip8 Picture.ch8"};
   auto result{chip8::RomLoader::load(path)};
@@ -16,4 +20,63 @@ TEST_CASE("RomLoader loads non existant ROM file", "[rom]") {
 
   REQUIRE(result.is_err());
   REQUIRE(result.error().category() == chip8::Error::Category::IO);
-}
\ No newline at end of file
+}
+
+
+TEST_CASE("RomLoader maps the file contents", "[rom]") {
+  std::filesystem::path path{"roms/programs/Chip8 Picture.ch8"};
+  auto result{chip8::RomLoader::load(path)};
+  REQUIRE(result.is_ok());
+
+  std::ifstream file(path, std::ios::binary);
+  const std::vector<chip8::Byte> expected{std::istreambuf_iterator<char>(file),
+                                          std::istreambuf_iterator<char>()};
+  REQUIRE(std::ranges::equal(result->as_span(), expected));
+
+  // owned copies outlive the mapping
+  const auto owned{result->to_owned()};
+  REQUIRE_FALSE(owned.is_mapped());
+  REQUIRE(std::ranges::equal(owned.as_span(), expected));
+}
+
+TEST_CASE("RomLoader rejects empty ROM file", "[rom]") {
+  const auto path{std::filesystem::temp_directory_path() / "chip8_empty.ch8"};
+  std::ofstream{path}.close();
+
+  auto result{chip8::RomLoader::load(path)};
+  REQUIRE(result.is_err());
+  REQUIRE(result.error().category() == chip8::Error::Category::IO);
+  std::filesystem::remove(path);
+}
+
+TEST_CASE("Memory loads a mapped ROM and clears the rest", "[rom]") {
+  chip8::Memory memory;
+  const std::vector<chip8::Byte> junk(512, 0xAA);
+  REQUIRE(memory.load_rom(junk).is_ok());
+
+  std::filesystem::path path{"roms/programs/Chip8 Picture.ch8"};
+  auto rom{chip8::RomLoader::load(path)};
+  REQUIRE(rom.is_ok());
+  REQUIRE(memory.load_rom(rom->as_span()).is_ok());
+
+  REQUIRE(memory.rom_size() == rom->size());
+  REQUIRE(memory.read(chip8::Address{0x200}) == rom->data()[0]);
+  const chip8::Address after_rom{
+      static_cast<std::uint16_t>(0x200 + rom->size())};
+  REQUIRE(memory.read(after_rom) == 0);
+}
+
+TEST_CASE("Embedded ROMs match the files they were built from", "[rom]") {
+  for (const auto &rom : chip8::EMBEDDED_ROMS) {
+    auto file{chip8::RomLoader::load(std::filesystem::path{"roms"} / rom.name)};
+    REQUIRE(file.is_ok());
+    REQUIRE(std::ranges::equal(file->as_span(), rom.data));
+
+    const auto found{chip8::RomLoader::find_embedded(
+        std::filesystem::path{"./roms"} / rom.name)};
+    REQUIRE(found.has_value());
+    REQUIRE(found->data.data() == rom.data.data());
+  }
+
+  REQUIRE_FALSE(chip8::RomLoader::find_embedded("roms/not embedded.ch8"));
+}
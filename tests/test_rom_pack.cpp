@@ -0,0 +1,84 @@
+#include "catch2/catch_test_macros.hpp"
+#include "utils/rom_pack.hpp"
+
+#include <fstream>
+
+using namespace chip8;
+
+namespace {
+
+class RomPackTestClass {
+protected:
+  std::filesystem::path path{std::filesystem::temp_directory_path() /
+                             "chip8_test.c8pk"};
+  std::vector<Byte> pong{0x6A, 0x02, 0x6B, 0x0C, 0x6C, 0x3F};
+  std::vector<Byte> maze{0x12, 0x60, 0x01, 0x7A};
+
+  RomPackTestClass() {
+    RomPackWriter writer;
+    writer.add("games/pong.ch8", pong);
+    writer.add("hires/maze.ch8", maze);
+    writer.add("a.ch8", std::vector<Byte>(33, 0xEE));
+    REQUIRE(writer.write(path).is_ok());
+  }
+
+  ~RomPackTestClass() { std::filesystem::remove(path); }
+};
+
+}
+
+TEST_CASE_METHOD(RomPackTestClass, "Rom pack finds roms by name and hash",
+                 "[pack]") {
+  auto pack{RomPack::open(path)};
+  REQUIRE(pack.is_ok());
+  REQUIRE(pack->size() == 3);
+
+  const auto by_name{pack->find_by_name("games/pong.ch8")};
+  REQUIRE(by_name.has_value());
+  REQUIRE(std::ranges::equal(by_name->data, pong));
+  REQUIRE(by_name->platform == RomPlatform::Chip8);
+
+  const auto by_hash{pack->find_by_hash(rom_hash(maze))};
+  REQUIRE(by_hash.has_value());
+  REQUIRE(by_hash->name == "hires/maze.ch8");
+  REQUIRE(by_hash->platform == RomPlatform::VipHires);
+
+  REQUIRE_FALSE(pack->find_by_name("games/tetris.ch8").has_value());
+  REQUIRE_FALSE(pack->find_by_hash(0).has_value());
+}
+
+TEST_CASE_METHOD(RomPackTestClass, "Rom pack aligns rom data", "[pack]") {
+  auto pack{RomPack::open(path)};
+  REQUIRE(pack.is_ok());
+  for (std::size_t i{0}; i < pack->size(); ++i) {
+    const auto offset{(*pack)[i].data.data() - (*pack)[0].data.data()};
+    REQUIRE(offset % RomPack::DATA_ALIGNMENT == 0);
+  }
+}
+
+TEST_CASE_METHOD(RomPackTestClass, "Packed roms resolve by name or hash", "[pack]") {
+  auto pack{RomPack::open(path)};
+  REQUIRE(pack.is_ok());
+
+  auto named{load_packed_rom(*pack, "hires/maze.ch8")};
+  REQUIRE(named.is_ok());
+  REQUIRE(named->data.size() == maze.size());
+
+  const auto key{std::format("{:016X}", rom_hash(pong))};
+  auto hashed{load_packed_rom(*pack, key)};
+  REQUIRE(hashed.is_ok());
+  REQUIRE(hashed->name == "games/pong.ch8");
+
+  auto missing{load_packed_rom(*pack, "nope.ch8")};
+  REQUIRE(missing.is_err());
+  REQUIRE(missing.error().category() == Error::Category::IO);
+}
+
+TEST_CASE("Rom pack rejects other files", "[pack]") {
+  const auto path{std::filesystem::temp_directory_path() / "chip8_bad.c8pk"};
+  std::ofstream{path} << "definitely not a rom pack, just some text";
+
+  auto pack{RomPack::open(path)};
+  REQUIRE(pack.is_err());
+  std::filesystem::remove(path);
+}
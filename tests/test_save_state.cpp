@@ -0,0 +1,98 @@
+#include "catch2/catch_test_macros.hpp"
+#include "core/machine.hpp"
+#include "core/save_state.hpp"
+
+#include <filesystem>
+#include <vector>
+
+using namespace chip8;
+
+namespace {
+
+// draws random sprites forever, exercises rng, memory, timers and display
+const std::vector<Byte> NOISE_ROM{
+    0xC0, 0x3F, // RND V0, 3F
+    0xC1, 0x1F, // RND V1, 1F
+    0xA2, 0x10, // LD I, 210
+    0xC2, 0xFF, // RND V2, FF
+    0xF2, 0x55, // LD [I], V0..V2
+    0xD0, 0x13, // DRW V0, V1, 3
+    0xF2, 0x18, // LD ST, V2
+    0x12, 0x00  // JP 200
+};
+
+}
+
+TEST_CASE("Save states round trip through bytes", "[save_state]") {
+  Machine machine;
+  REQUIRE(machine.load_rom(NOISE_ROM).is_ok());
+  machine.seed(42);
+  for (int i{0}; i < 10; ++i)
+    REQUIRE(machine.run_frame().is_ok());
+
+  const auto snapshot{machine.snapshot()};
+  const auto bytes{SaveState::serialize(snapshot, 0xABCD)};
+  REQUIRE(bytes.size() == SaveState::HEADER_SIZE + SaveState::PAYLOAD_SIZE);
+
+  const auto state{SaveState::parse(bytes)};
+  REQUIRE(state.is_ok());
+  REQUIRE(state->rom_hash == 0xABCD);
+  REQUIRE(SaveState::serialize(state->snapshot, 0xABCD) == bytes);
+
+  // a restored machine continues exactly like the original
+  Machine restored;
+  REQUIRE(restored.load_rom(NOISE_ROM).is_ok());
+  restored.restore(state->snapshot);
+  for (int i{0}; i < 10; ++i) {
+    REQUIRE(machine.run_frame().is_ok());
+    REQUIRE(restored.run_frame().is_ok());
+  }
+  REQUIRE(restored.cpu().state().registers == machine.cpu().state().registers);
+  REQUIRE(restored.display().buffer() == machine.display().buffer());
+  REQUIRE(restored.memory().data() == machine.memory().data());
+  REQUIRE(restored.frame_count() == 20);
+}
+
+TEST_CASE("Save states reject damaged files", "[save_state]") {
+  Machine machine;
+  REQUIRE(machine.load_rom(NOISE_ROM).is_ok());
+  const auto bytes{SaveState::serialize(machine.snapshot(), 1)};
+
+  auto flipped{bytes};
+  flipped[SaveState::HEADER_SIZE + 100] ^= 0x01;
+  REQUIRE(SaveState::parse(flipped).is_err());
+
+  auto version{bytes};
+  version[4] = 99;
+  REQUIRE(SaveState::parse(version).is_err());
+
+  REQUIRE(SaveState::parse(std::span{bytes}.first(bytes.size() - 1))
+          .is_err());
+  REQUIRE(SaveState::parse({}).is_err());
+}
+
+TEST_CASE("Save state writer works in the background", "[save_state]") {
+  const auto dir{std::filesystem::temp_directory_path() /
+                 "chip8_test_states"};
+  std::filesystem::remove_all(dir);
+  const auto path{dir / "test.state"};
+
+  Machine machine;
+  REQUIRE(machine.load_rom(NOISE_ROM).is_ok());
+  machine.seed(7);
+  REQUIRE(machine.run_frame().is_ok());
+
+  SaveStateWriter writer;
+  writer.submit(path, machine.snapshot(), 0x1234);
+  writer.wait_idle();
+  REQUIRE(writer.failures() == 0);
+
+  const auto state{SaveState::load(path)};
+  REQUIRE(state.is_ok());
+  REQUIRE(state->rom_hash == 0x1234);
+  REQUIRE(state->snapshot.memory == machine.memory().data());
+  REQUIRE(state->snapshot.cpu.rng == machine.cpu().state().rng);
+  REQUIRE(SaveState::load(dir / "missing.state").is_err());
+
+  std::filesystem::remove_all(dir);
+}
@@ -0,0 +1,67 @@
+#include "catch2/catch_test_macros.hpp"
+#include "core/cpu.hpp"
+#include "profiling/trace.hpp"
+
+#include <sstream>
+
+using namespace chip8;
+
+TEST_CASE("Trace ring rounds capacity to a power of two", "[trace]") {
+  TraceRing ring{100};
+  REQUIRE(ring.capacity() == 128);
+  REQUIRE(ring.empty());
+}
+
+TEST_CASE("Trace ring records executed instructions", "[trace]") {
+  Memory memory;
+  Timers timers;
+  Cpu cpu{memory, timers};
+  TraceRing ring{16};
+  cpu.set_trace(&ring);
+
+  std::vector<Byte> prog{0x6A, 0x42, 0xA3, 0x00, 0x12, 0x04};
+  memory.load_rom(prog);
+  cpu.step();
+  cpu.step();
+  cpu.step();
+
+  REQUIRE(ring.size() == 3);
+  REQUIRE(ring[0].pc == 0x200);
+  REQUIRE(ring[0].opcode == 0x6A42);
+  REQUIRE(ring[0].changed_reg == 0xA);
+  REQUIRE(ring[0].value == 0x42);
+  REQUIRE(ring[1].index == 0x300);
+  REQUIRE(ring[1].changed_reg == TraceRing::NO_REGISTER);
+  REQUIRE(ring.newest().cycle == 2);
+}
+
+TEST_CASE("Trace ring keeps only the newest records", "[trace]") {
+  TraceRing ring{4};
+  RegisterFile regs{};
+
+  for (Word i{0}; i < 10; ++i)
+    ring.record(Address{static_cast<Word>(0x200 + i * 2)}, Opcode{0x1200},
+                Address{0}, regs, regs);
+
+  REQUIRE(ring.size() == 4);
+  REQUIRE(ring.total_recorded() == 10);
+  REQUIRE(ring[0].cycle == 6);
+  REQUIRE(ring[3].pc == 0x212);
+}
+
+TEST_CASE("Trace dump decodes mnemonics", "[trace]") {
+  TraceRing ring{4};
+  RegisterFile before{};
+  RegisterFile after{};
+  after[3] = RegisterValue{0x7F};
+  ring.record(Address{0x200}, Opcode{0x637F}, Address{0x050}, before, after);
+
+  std::ostringstream out;
+  dump_trace(ring, out);
+
+  const auto text{out.str()};
+  REQUIRE(text.find("$200") != std::string::npos);
+  REQUIRE(text.find("637F") != std::string::npos);
+  REQUIRE(text.find("LD") != std::string::npos);
+  REQUIRE(text.find("V3=7F") != std::string::npos);
+}
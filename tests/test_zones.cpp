@@ -0,0 +1,72 @@
+#include "catch2/catch_test_macros.hpp"
+#include "profiling/zones.hpp"
+
+#include <sstream>
+#include <string>
+#include <thread>
+
+using namespace chip8;
+
+namespace {
+
+std::size_t count(const std::string &text, std::string_view needle) {
+  std::size_t found{0};
+  for (auto at{text.find(needle)}; at != std::string::npos;
+       at = text.find(needle, at + needle.size()))
+    ++found;
+  return found;
+}
+
+}
+
+TEST_CASE("Zones nest and export as Chrome trace events", "[zones]") {
+  auto &profiler{ZoneProfiler::instance()};
+  profiler.clear();
+  {
+    const ZoneScope outer{"outer"};
+    const ZoneScope inner{"inner \"quoted\""};
+  }
+
+  // inner closes first
+  const auto records{profiler.thread_ring().records()};
+  REQUIRE(records.size() == 2);
+  REQUIRE(std::string_view{records[1].name} == "outer");
+  REQUIRE(records[1].begin <= records[0].begin);
+  REQUIRE(records[0].end <= records[1].end);
+
+  std::ostringstream out;
+  profiler.write_chrome(out);
+  const auto json{out.str()};
+  REQUIRE(json.starts_with("{\"displayTimeUnit\":\"ns\",\"traceEvents\":["));
+  REQUIRE(count(json, "\"ph\":\"X\"") == 2);
+  REQUIRE(count(json, "\"name\":\"inner \\\"quoted\\\"\"") == 1);
+  REQUIRE(json.ends_with("]}\n"));
+}
+
+TEST_CASE("Zone rings keep the newest records per thread", "[zones]") {
+  auto &profiler{ZoneProfiler::instance()};
+  profiler.clear();
+  profiler.set_capacity(4);
+
+  const ZoneRing *worker_ring{nullptr};
+  std::thread worker{[&] {
+    profiler.name_thread("worker");
+    for (int i{0}; i < 10; ++i) {
+      const ZoneScope zone{"work"};
+    }
+    worker_ring = &profiler.thread_ring();
+  }};
+  worker.join();
+  profiler.set_capacity(ZoneProfiler::DEFAULT_CAPACITY);
+
+  REQUIRE(worker_ring->total_recorded() == 10);
+  REQUIRE(worker_ring->records().size() == 4);
+
+  // the ring outlives its thread
+  REQUIRE(worker_ring->thread_id() != profiler.thread_ring().thread_id());
+  std::ostringstream out;
+  profiler.write_chrome(out);
+  const auto json{out.str()};
+  REQUIRE(count(json, "\"name\":\"work\"") == 4);
+  REQUIRE(count(json, "\"args\":{\"name\":\"worker\"}") == 1);
+}